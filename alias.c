@@ -0,0 +1,90 @@
+#include <stdlib.h>
+#include "alias.h"
+
+/**
+ * Build an alias table (Vose's method, integer version).
+ *
+ * Each weight is scaled by `count` so the average column holds exactly
+ * total_weight. Under-full columns are topped up from over-full ones; each
+ * column ends up with at most two entries: itself and its alias.
+ */
+int alias_build(AliasTable *t, const int *weights, int count) {
+    t->count = 0;
+    t->total_weight = 0;
+    t->threshold = NULL;
+    t->alias = NULL;
+
+    if (count < 1) return -1;
+
+    int64_t total = 0;
+    for (int i = 0; i < count; i++) {
+        if (weights[i] < 0) return -1;
+        total += weights[i];
+    }
+    if (total <= 0) return -1;
+
+    int64_t *scaled = malloc(sizeof(int64_t) * (size_t)count);
+    int *work = malloc(sizeof(int) * (size_t)count);  // small from the front, large from the back
+    t->threshold = malloc(sizeof(int64_t) * (size_t)count);
+    t->alias = malloc(sizeof(int) * (size_t)count);
+    if (!scaled || !work || !t->threshold || !t->alias) {
+        free(scaled);
+        free(work);
+        alias_free(t);
+        return -1;
+    }
+
+    int n_small = 0, n_large = 0;
+    for (int i = 0; i < count; i++) {
+        scaled[i] = (int64_t)weights[i] * count;
+        if (scaled[i] < total) {
+            work[n_small++] = i;
+        } else {
+            work[count - 1 - n_large++] = i;
+        }
+    }
+
+    while (n_small > 0 && n_large > 0) {
+        int s = work[--n_small];
+        int l = work[count - n_large];  // Peek; may move to the small side below
+
+        t->threshold[s] = scaled[s];
+        t->alias[s] = l;
+        scaled[l] -= total - scaled[s];
+
+        if (scaled[l] < total) {
+            n_large--;
+            work[n_small++] = l;
+        }
+    }
+
+    // Whatever is left is (up to rounding) exactly full
+    while (n_large > 0) {
+        int l = work[count - n_large--];
+        t->threshold[l] = total;
+        t->alias[l] = l;
+    }
+    while (n_small > 0) {
+        int s = work[--n_small];
+        t->threshold[s] = total;
+        t->alias[s] = s;
+    }
+
+    free(scaled);
+    free(work);
+    t->count = count;
+    t->total_weight = total;
+    return 0;
+}
+
+/**
+ * Release a table built by alias_build
+ */
+void alias_free(AliasTable *t) {
+    free(t->threshold);
+    free(t->alias);
+    t->threshold = NULL;
+    t->alias = NULL;
+    t->count = 0;
+    t->total_weight = 0;
+}
@@ -0,0 +1,33 @@
+#ifndef ALIAS_H
+#define ALIAS_H
+
+#include <stdint.h>
+
+/*
+ * Walker/Vose alias table - constant-time weighted sampling.
+ *
+ * Built once from integer weights; every sample is one column pick plus
+ * one biased coin flip, regardless of how many entries the table has.
+ * Integer arithmetic throughout, so the sampled distribution is exact.
+ */
+typedef struct {
+    int count;
+    int64_t total_weight;   // Sum of the input weights
+    int64_t *threshold;     // Coin threshold per column, in [0, total_weight]
+    int *alias;             // Entry used when the coin is above the threshold
+} AliasTable;
+
+// Build from `count` non-negative weights (at least one must be positive).
+// Returns 0 on success, -1 on bad input or allocation failure.
+int alias_build(AliasTable *t, const int *weights, int count);
+void alias_free(AliasTable *t);
+
+// Pick an entry index. column_roll and coin_roll are independent random
+// values (e.g. two rand() calls); they are reduced modulo count and
+// total_weight respectively.
+static inline int alias_pick(const AliasTable *t, unsigned int column_roll, unsigned int coin_roll) {
+    int i = (int)(column_roll % (unsigned int)t->count);
+    return (int64_t)(coin_roll % (uint64_t)t->total_weight) < t->threshold[i] ? i : t->alias[i];
+}
+
+#endif
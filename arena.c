@@ -0,0 +1,66 @@
+#define _DEFAULT_SOURCE  // MAP_ANONYMOUS, MAP_NORESERVE
+
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include "arena.h"
+
+int arena_init(Arena *arena, size_t capacity) {
+    memset(arena, 0, sizeof(*arena));
+    // Reserve address space only; pages are backed as they are first touched
+    void *base = mmap(NULL, capacity, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (base == MAP_FAILED) return -1;
+    arena->base = base;
+    arena->capacity = capacity;
+    return 0;
+}
+
+void arena_destroy(Arena *arena) {
+    if (arena->base) {
+        munmap(arena->base, arena->capacity);
+    }
+    memset(arena, 0, sizeof(*arena));
+}
+
+void *arena_alloc(Arena *arena, size_t size, size_t align) {
+    uintptr_t start = (uintptr_t)arena->base + arena->used;
+    uintptr_t aligned = (start + align - 1) & ~(uintptr_t)(align - 1);
+    size_t pad = (size_t)(aligned - start);
+
+    if (pad > arena->capacity - arena->used || size > arena->capacity - arena->used - pad) {
+        arena->failures++;
+        return NULL;
+    }
+    arena->used += pad + size;
+    arena->padding += pad;
+    arena->allocations++;
+    if (arena->used > arena->peak) arena->peak = arena->used;
+    return (void *)aligned;
+}
+
+void *arena_alloc_zero(Arena *arena, size_t size, size_t align) {
+    void *ptr = arena_alloc(arena, size, align);
+    if (ptr) memset(ptr, 0, size);
+    return ptr;
+}
+
+void arena_discard(Arena *arena, void *ptr, size_t size) {
+    if (!ptr) return;
+    if ((unsigned char *)ptr + size == arena->base + arena->used) {
+        arena->used -= size;  // Top of the arena: just move the bump pointer back
+    } else {
+        arena->abandoned += size;
+    }
+}
+
+void arena_reset(Arena *arena) {
+    arena->used = 0;
+    arena->padding = 0;
+    arena->abandoned = 0;
+}
+
+double arena_fragmentation(const Arena *arena) {
+    if (arena->used == 0) return 0.0;
+    return (double)(arena->padding + arena->abandoned) / (double)arena->used;
+}
@@ -0,0 +1,54 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+/*
+ * Arena allocator - one reserved block that all game-lifetime state is
+ * carved from (map layers, event log, the map's content table).
+ *
+ * Allocation is a pointer bump: no headers, no free lists, nothing to do
+ * on the hot path. Everything goes away at once with arena_reset() (new
+ * game, same memory) or arena_destroy(). The block is reserved up front
+ * with mmap, so only the pages actually touched count against the
+ * device's memory; `peak` shows how far that got.
+ */
+
+typedef struct {
+    unsigned char *base;
+    size_t capacity;     // Bytes reserved
+    size_t used;         // Bump offset, including padding and abandoned blocks
+    size_t peak;         // High-water mark of `used`
+    size_t padding;      // Bytes skipped to satisfy alignment
+    size_t abandoned;    // Bytes given back with arena_discard() that can't be reused
+    size_t allocations;  // Successful arena_alloc() calls
+    size_t failures;     // Requests that did not fit
+} Arena;
+
+// Reserve `capacity` bytes. Returns 0 on success, -1 if the mapping failed.
+int arena_init(Arena *arena, size_t capacity);
+
+// Release the reservation. The arena can be initialised again afterwards.
+void arena_destroy(Arena *arena);
+
+// Allocate `size` bytes aligned to `align` (a power of two).
+// Returns NULL when the arena is full. Memory is not zeroed.
+void *arena_alloc(Arena *arena, size_t size, size_t align);
+
+// Allocate and zero `size` bytes
+void *arena_alloc_zero(Arena *arena, size_t size, size_t align);
+
+// Typed helper: ARENA_NEW(arena, Map) -> Map * (not zeroed)
+#define ARENA_NEW(arena, type) ((type *)arena_alloc((arena), sizeof(type), _Alignof(type)))
+
+// Give back a block. The most recent allocation is reclaimed; anything
+// older stays allocated and is counted as abandoned (fragmentation).
+void arena_discard(Arena *arena, void *ptr, size_t size);
+
+// Free every allocation at once. Keeps the reservation and the peak.
+void arena_reset(Arena *arena);
+
+// Share of `used` that holds no live data (padding plus abandoned), 0..1
+double arena_fragmentation(const Arena *arena);
+
+#endif
@@ -0,0 +1,507 @@
+/**
+ * bench.c - Seeded microbenchmarks for the game's hot paths.
+ *
+ * Usage: bench [--filter TEXT] [--json FILE] [--baseline FILE]
+ *   --filter    only run benchmarks whose name contains TEXT (or any of
+ *               a comma-separated list, e.g. map_,ui_render_game)
+ *   --json      append one JSON object per benchmark to FILE (JSON Lines)
+ *   --baseline  compare medians with a previous --json file and flag
+ *               regressions (threshold: $BENCH_THRESHOLD percent, default 20)
+ *
+ * Every benchmark reseeds rand() first, so runs are repeatable. Results
+ * are reported as median and p99 nanoseconds per operation, plus MB/s
+ * for the ones that process a known number of bytes. The map size
+ * and storage layout are fixed at build time; `make bench` builds one
+ * binary per size plus a tiled-layout binary to compare against.
+ *
+ * Exit status is 1 if any benchmark regressed against the baseline.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <fcntl.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "dungeon.h"
+#include "enemies.h"
+#include "eventlog.h"
+#include "gamedata.h"
+#include "history.h"
+#include "player.h"
+#include "rle.h"
+#include "ui.h"
+#include "zobrist.h"
+
+#define BENCH_SEED 12345u
+
+typedef struct {
+    const char *name;
+    int samples;               // Timed samples
+    int batch;                 // Operations per sample
+    void (*setup)(void);       // Once before sampling (untimed)
+    void (*reset)(void);       // Before each sample (untimed)
+    void (*op)(void);          // The operation being measured
+    int null_stdout;           // Send stdout to /dev/null while sampling
+    int param;                 // Passed to the op through bench_param
+    size_t bytes;              // Bytes processed per operation (reported as MB/s)
+} Bench;
+
+typedef struct {
+    char name[64];
+    int map_size;
+    char layout[16];
+    double median_ns;
+} BaselineEntry;
+
+// ---------------------------------------------------------------------------
+// Shared fixture
+// ---------------------------------------------------------------------------
+
+static Map *map;
+static Player player, player_start;
+static Position pos;
+static BattleState battle;
+static GameState state;
+static EventLog events;
+static int running;
+static volatile int sink;  // Keeps results alive so the compiler can't drop the work
+
+static Position probes[4096];
+static unsigned int probe_next;
+
+static int bench_param;  // Bench.param of the running benchmark
+
+static void fixture_init(void) {
+    map = malloc(sizeof(Map));
+    if (!map) {
+        fprintf(stderr, "out of memory (Map is %zu bytes)\n", sizeof(Map));
+        exit(1);
+    }
+    map_init(map, NULL);
+    srand(BENCH_SEED);
+    map_generate(map);
+    player_init(&player, CLASS_WARRIOR);
+    player_start = player;
+    eventlog_init(&events);
+}
+
+// ---------------------------------------------------------------------------
+// Benchmarks
+// ---------------------------------------------------------------------------
+
+static void op_nothing(void) {
+}
+
+static void op_map_generate(void) {
+    map_generate(map);
+}
+
+static void setup_probes(void) {
+    for (int i = 0; i < 4096; i++) {
+        probes[i].x = rand() % (MAP_SIZE + 2) - 1;  // Include out-of-bounds probes
+        probes[i].y = rand() % (MAP_SIZE + 2) - 1;
+    }
+    probe_next = 0;
+}
+
+static void op_map_can_move(void) {
+    const Position *p = &probes[probe_next++ & 4095];
+    sink += map_can_move(map, p->x, p->y);
+}
+
+// Read every tile of a square viewport (side bench_param) around a probe
+static void op_map_viewport(void) {
+    const Position *p = &probes[probe_next++ & 4095];
+    int radius = bench_param / 2;
+    int count = 0;
+    for (int y = p->y - radius; y <= p->y + radius; y++) {
+        for (int x = p->x - radius; x <= p->x + radius; x++) {
+            count += map_get_tile(map, x, y) != TILE_WALL;
+        }
+    }
+    sink += count;
+}
+
+// Probe the four neighbours of a tile, as carve_maze and movement do
+static void op_map_neighbours(void) {
+    const Position *p = &probes[probe_next++ & 4095];
+    sink += map_can_move(map, p->x, p->y - 1) + map_can_move(map, p->x + 1, p->y)
+          + map_can_move(map, p->x, p->y + 1) + map_can_move(map, p->x - 1, p->y);
+}
+
+static void op_map_tile_content(void) {
+    const Position *p = &probes[probe_next++ & 4095];
+    TileData tile;
+    map_tile_content(map, p->x, p->y, &tile);
+    sink += tile.content;
+}
+
+// Fingerprint the whole game state (compare: map_explore_stats scans it)
+static void op_zobrist_state(void) {
+    sink += (int)zobrist_state(map, &player, pos);
+}
+
+static void op_map_explore_stats(void) {
+    MapStats stats;
+    map_explore_stats(map, &stats);
+    sink += stats.visited;
+}
+
+// search_room: put the content under a tile next to the start and step on it
+static void reset_search_room(void) {
+    pos = (Position){MAP_CENTER + 1, MAP_CENTER};
+    TileData tile = {
+        (TileContent)bench_param,
+        bench_param == CONTENT_BOSS ? DIFFICULTY_BOSS : DIFFICULTY_MEDIUM,
+        80,
+        0
+    };
+    map_set_content(map, pos.x, pos.y, &tile);
+    player = player_start;
+    battle.is_active = 0;
+}
+
+static void op_search_room(void) {
+    search_room(&player, &pos, &events, map, &battle);
+}
+
+// One battle round against a monster that can't die, by a player who can't
+static void reset_battle(void) {
+    player = player_start;
+    player.health = player.max_health = 1 << 30;
+    battle_start(&battle, monster_spawn(DIFFICULTY_MEDIUM, player.level));
+    battle.monster_hp = 1 << 30;
+    state = STATE_BATTLE;
+}
+
+static void op_battle_round(void) {
+    handle_command((char)bench_param, &running, &pos, &player, &events, map, &state, &battle);
+}
+
+// history_branch/<turns>: a simulator trying one line of play from a shared
+// state and rewinding it again
+static History history;
+
+static void reset_history_branch(void) {
+    history_init(&history);
+    player = player_start;
+    player.health = player.max_health = 1 << 30;
+    pos = (Position){MAP_CENTER, MAP_CENTER};
+    state = STATE_EXPLORING;
+    battle.is_active = 0;
+}
+
+static void op_history_branch(void) {
+    map->history = &history;
+    HistoryMark mark = history_mark(&history);
+    for (int i = 0; i < bench_param; i++) {
+        char command = "NSEWA"[rand() % 5];
+        history_begin_turn(&history, &player, pos, state, &battle);
+        handle_command(command, &running, &pos, &player, &events, map, &state, &battle);
+        history_end_turn(&history, &player, pos, state, &battle);
+    }
+    sink += history_rewind_to(&history, map, mark, &player, &pos, &state, &battle);
+    map->history = NULL;
+}
+
+// rle_encode/rle_decode of a map-sized bit layer (as saves store visited
+// and looted tiles): a winding explored trail, or noise (the raw fallback)
+#define LAYER_BITS (MAP_SIZE * MAP_SIZE)
+#define LAYER_BYTES ((LAYER_BITS + 7) / 8)
+
+static uint8_t layer[LAYER_BYTES], layer_out[LAYER_BYTES];
+static uint8_t layer_encoded[RLE_MAX_BYTES(LAYER_BITS)];
+static size_t layer_encoded_len;
+
+static void setup_layer(void) {
+    memset(layer, 0, sizeof(layer));
+    if (bench_param) {
+        for (int i = 0; i < LAYER_BYTES; i++) layer[i] = (uint8_t)rand();
+    } else {
+        // 5000 random steps through the maze from the spawn point
+        Position p = {MAP_CENTER, MAP_CENTER};
+        for (int i = 0; i < 5000; i++) {
+            static const int dx[4] = {0, 1, 0, -1}, dy[4] = {-1, 0, 1, 0};
+            int d = rand() % 4;
+            if (map_can_move(map, p.x + dx[d], p.y + dy[d])) {
+                p.x += dx[d];
+                p.y += dy[d];
+                int bit = p.y * MAP_SIZE + p.x;
+                layer[bit >> 3] |= (uint8_t)(1u << (bit & 7));
+            }
+        }
+    }
+    layer_encoded_len = rle_encode(layer, LAYER_BITS, layer_encoded);
+}
+
+static void op_layer_encode(void) {
+    sink += (int)rle_encode(layer, LAYER_BITS, layer_encoded);
+}
+
+static void op_layer_decode(void) {
+    sink += rle_decode(layer_encoded, layer_encoded_len, layer_out, LAYER_BITS);
+}
+
+static void setup_render(void) {
+    player = player_start;
+    pos = (Position){MAP_CENTER, MAP_CENTER};
+    battle_start(&battle, monster_spawn(DIFFICULTY_MEDIUM, player.level));
+    eventlog_begin_turn(&events);
+    eventlog_push(&events, EV_PLAYER_HIT, battle.monster.name, 12, 0, 0);
+    eventlog_push(&events, EV_MONSTER_HIT, battle.monster.name, 4, 0, 0);
+}
+
+static void op_render_game(void) {
+    ui_render_game(&player, &pos, &events, map);
+}
+
+static void op_render_battle(void) {
+    ui_render_battle(&player, &battle, &events);
+}
+
+static void op_render_inventory(void) {
+    ui_render_inventory(&player, &events);
+}
+
+static void op_render_log(void) {
+    ui_render_log(&events, 20);
+}
+
+// Content names for the search_room/<content> benchmarks, by TileContent
+static const char *const content_names[] = {
+    "empty", "monster", "treasure", "trap", "fountain", "boss", "shrine",
+};
+
+// ---------------------------------------------------------------------------
+// Runner
+// ---------------------------------------------------------------------------
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static int cmp_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static double percentile(const double *sorted, int n, double p) {
+    int i = (int)ceil(p * n) - 1;
+    if (i < 0) i = 0;
+    if (i >= n) i = n - 1;
+    return sorted[i];
+}
+
+static int load_baseline(const char *path, BaselineEntry **out) {
+    FILE *f = fopen(path, "r");
+    if (!f) return 0;
+
+    int count = 0, cap = 0;
+    BaselineEntry *entries = NULL;
+    char line[512];
+    while (fgets(line, sizeof(line), f)) {
+        BaselineEntry e;
+        if (sscanf(line, "{\"name\":\"%63[^\"]\",\"map_size\":%d,\"layout\":\"%15[^\"]\",",
+                   e.name, &e.map_size, e.layout) != 3) continue;
+        const char *m = strstr(line, "\"median_ns\":");
+        if (!m || sscanf(m, "\"median_ns\":%lf", &e.median_ns) != 1) continue;
+        if (count == cap) {
+            cap = cap ? cap * 2 : 32;
+            BaselineEntry *grown = realloc(entries, sizeof(*entries) * (size_t)cap);
+            if (!grown) break;
+            entries = grown;
+        }
+        entries[count++] = e;
+    }
+    fclose(f);
+    *out = entries;
+    return count;
+}
+
+static const BaselineEntry *find_baseline(const BaselineEntry *entries, int count, const char *name) {
+    for (int i = 0; i < count; i++) {
+        if (entries[i].map_size == MAP_SIZE && strcmp(entries[i].layout, MAP_LAYOUT_NAME) == 0 &&
+            strcmp(entries[i].name, name) == 0) {
+            return &entries[i];
+        }
+    }
+    return NULL;
+}
+
+// Does `name` contain any of the comma-separated parts of `filter`?
+static int matches_filter(const char *name, const char *filter) {
+    while (*filter) {
+        size_t len = strcspn(filter, ",");
+        char part[64];
+        if (len > 0 && len < sizeof(part)) {
+            memcpy(part, filter, len);
+            part[len] = '\0';
+            if (strstr(name, part)) return 1;
+        }
+        filter += len;
+        if (*filter == ',') filter++;
+    }
+    return 0;
+}
+
+/**
+ * Run one benchmark. Returns 1 if it regressed against the baseline.
+ */
+static int run_bench(const Bench *b, FILE *json, const BaselineEntry *baseline, int baseline_count,
+                     double threshold) {
+    srand(BENCH_SEED);
+    if (b->setup) b->setup();
+
+    double *ns = malloc(sizeof(double) * (size_t)b->samples);
+    if (!ns) return 0;
+
+    int saved_stdout = -1;
+    if (b->null_stdout) {
+        fflush(stdout);
+        saved_stdout = dup(STDOUT_FILENO);
+        int devnull = open("/dev/null", O_WRONLY);
+        dup2(devnull, STDOUT_FILENO);
+        close(devnull);
+    }
+
+    for (int s = 0; s < b->samples; s++) {
+        if (b->reset) b->reset();
+        uint64_t start = now_ns();
+        for (int i = 0; i < b->batch; i++) {
+            b->op();
+        }
+        if (b->null_stdout) fflush(stdout);
+        ns[s] = (double)(now_ns() - start) / b->batch;
+    }
+
+    if (saved_stdout >= 0) {
+        fflush(stdout);
+        dup2(saved_stdout, STDOUT_FILENO);
+        close(saved_stdout);
+    }
+
+    qsort(ns, (size_t)b->samples, sizeof(double), cmp_double);
+    double median = percentile(ns, b->samples, 0.5);
+    double p99 = percentile(ns, b->samples, 0.99);
+    free(ns);
+
+    int regressed = 0;
+    char verdict[64] = "";
+    const BaselineEntry *base = find_baseline(baseline, baseline_count, b->name);
+    if (base && base->median_ns > 0) {
+        double change = (median - base->median_ns) / base->median_ns * 100.0;
+        regressed = change > threshold;
+        snprintf(verdict, sizeof(verdict), "%+7.1f%%%s", change, regressed ? "  REGRESSION" : "");
+    }
+    // Throughput at the median: bytes per ns * 1000 = MB/s
+    double mb_per_s = b->bytes && median > 0 ? (double)b->bytes / median * 1000.0 : 0.0;
+    char rate[32] = "";
+    if (mb_per_s > 0) snprintf(rate, sizeof(rate), "%9.1f MB/s  ", mb_per_s);
+    printf("%-28s %5d  %-6s %12.1f  %12.1f  %s%s\n", b->name, MAP_SIZE, MAP_LAYOUT_NAME, median, p99,
+           rate, verdict);
+    fflush(stdout);
+
+    if (json) {
+        fprintf(json, "{\"name\":\"%s\",\"map_size\":%d,\"layout\":\"%s\",\"samples\":%d,\"batch\":%d,"
+                      "\"median_ns\":%.1f,\"p99_ns\":%.1f",
+                b->name, MAP_SIZE, MAP_LAYOUT_NAME, b->samples, b->batch, median, p99);
+        if (b->bytes) fprintf(json, ",\"mb_per_s\":%.1f", mb_per_s);
+        fprintf(json, "}\n");
+    }
+    return regressed;
+}
+
+int main(int argc, char **argv) {
+    const char *filter = NULL, *json_path = NULL, *baseline_path = NULL;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "--filter") == 0) filter = argv[i + 1];
+        else if (strcmp(argv[i], "--json") == 0) json_path = argv[i + 1];
+        else if (strcmp(argv[i], "--baseline") == 0) baseline_path = argv[i + 1];
+        else {
+            fprintf(stderr, "usage: %s [--filter TEXT] [--json FILE] [--baseline FILE]\n", argv[0]);
+            return 2;
+        }
+    }
+    const char *threshold_env = getenv("BENCH_THRESHOLD");
+    double threshold = threshold_env ? atof(threshold_env) : 20.0;
+
+    char err[256];
+    if (gamedata_init(getenv("ADVENTURE_DATA"), err, sizeof(err)) != 0) {
+        fprintf(stderr, "Failed to load game data: %s\n", err);
+        return 1;
+    }
+    fixture_init();
+
+    BaselineEntry *baseline = NULL;
+    int baseline_count = baseline_path ? load_baseline(baseline_path, &baseline) : 0;
+
+    FILE *json = NULL;
+    if (json_path) {
+        json = fopen(json_path, "a");
+        if (!json) {
+            perror(json_path);
+            return 1;
+        }
+    }
+
+    // Big maps take a while to generate; keep the total time roughly constant
+    int map_samples = 4000000 / (MAP_SIZE * MAP_SIZE);
+    if (map_samples < 5) map_samples = 5;
+
+    char search_names[7][32];
+    Bench benches[32];
+    int n = 0;
+    benches[n++] = (Bench){"timer_overhead", 100000, 1, NULL, NULL, op_nothing, 0, 0, 0};
+    benches[n++] = (Bench){"map_generate", map_samples, 1, NULL, NULL, op_map_generate, 0, 0, 0};
+    benches[n++] = (Bench){"map_can_move", 2000, 1000, setup_probes, NULL, op_map_can_move, 0, 0, 0};
+    benches[n++] = (Bench){"map_viewport/15", 2000, 100, setup_probes, NULL, op_map_viewport, 0, 15, 0};
+    benches[n++] = (Bench){"map_viewport/25", 2000, 100, setup_probes, NULL, op_map_viewport, 0, 25, 0};
+    benches[n++] = (Bench){"map_neighbours", 2000, 1000, setup_probes, NULL, op_map_neighbours, 0, 0, 0};
+    benches[n++] = (Bench){"map_tile_content", 2000, 1000, setup_probes, NULL, op_map_tile_content, 0, 0, 0};
+    benches[n++] = (Bench){"map_explore_stats", 200, 1, NULL, NULL, op_map_explore_stats, 0, 0, 0};
+    benches[n++] = (Bench){"zobrist_state", 20000, 10, NULL, NULL, op_zobrist_state, 0, 0, 0};
+    for (int c = 0; c < 7; c++) {
+        snprintf(search_names[c], sizeof(search_names[c]), "search_room/%s", content_names[c]);
+        benches[n++] = (Bench){search_names[c], 20000, 1, NULL, reset_search_room, op_search_room, 0, c, 0};
+    }
+    benches[n++] = (Bench){"battle_round/attack", 50000, 1, NULL, reset_battle, op_battle_round, 0, 'A', 0};
+    benches[n++] = (Bench){"battle_round/flee", 50000, 1, NULL, reset_battle, op_battle_round, 0, 'Q', 0};
+    benches[n++] = (Bench){"history_branch/1", 20000, 1, NULL, reset_history_branch, op_history_branch, 1, 1, 0};
+    benches[n++] = (Bench){"history_branch/32", 2000, 1, NULL, reset_history_branch, op_history_branch, 1, 32, 0};
+    benches[n++] = (Bench){"rle_encode/trail", 2000, 1, setup_layer, NULL, op_layer_encode, 0, 0, LAYER_BYTES};
+    benches[n++] = (Bench){"rle_decode/trail", 2000, 1, setup_layer, NULL, op_layer_decode, 0, 0, LAYER_BYTES};
+    benches[n++] = (Bench){"rle_encode/noise", 2000, 1, setup_layer, NULL, op_layer_encode, 0, 1, LAYER_BYTES};
+    benches[n++] = (Bench){"rle_decode/noise", 2000, 1, setup_layer, NULL, op_layer_decode, 0, 1, LAYER_BYTES};
+    benches[n++] = (Bench){"ui_render_game", 2000, 1, setup_render, NULL, op_render_game, 1, 0, 0};
+    benches[n++] = (Bench){"ui_render_battle", 2000, 1, setup_render, NULL, op_render_battle, 1, 0, 0};
+    benches[n++] = (Bench){"ui_render_inventory", 2000, 1, setup_render, NULL, op_render_inventory, 1, 0, 0};
+    benches[n++] = (Bench){"ui_render_log", 2000, 1, setup_render, NULL, op_render_log, 1, 0, 0};
+
+    printf("%-28s %5s  %-6s %12s  %12s  %s\n", "benchmark", "map", "layout", "median ns", "p99 ns",
+           baseline_count ? "vs baseline" : "");
+
+    int regressions = 0;
+    for (int i = 0; i < n; i++) {
+        const Bench *b = &benches[i];
+        if (filter && !matches_filter(b->name, filter)) continue;
+        bench_param = b->param;
+        regressions += run_bench(b, json, baseline, baseline_count, threshold);
+    }
+
+    if (json) fclose(json);
+    free(baseline);
+    free(map);
+    gamedata_shutdown();
+
+    if (regressions) {
+        printf("\n%d benchmark(s) more than %.0f%% slower than the baseline\n", regressions, threshold);
+        return 1;
+    }
+    return 0;
+}
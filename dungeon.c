@@ -5,12 +5,20 @@
 #include <string.h>
 #include "dungeon.h"
 #include "enemies.h"
+#include "history.h"
+#include "loot.h"
+#include "metrics.h"
 #include "player.h"
+#include "rng.h"
+#include "trace.h"
 #include "ui.h"
+#include "world.h"
+#include "zobrist.h"
 
-// Direction arrays for maze generation
-static const int dx[] = {0, 1, 0, -1};
-static const int dy[] = {-1, 0, 1, 0};
+// Let the undo history copy the tile's chunk before its first change this turn
+static inline void map_touch(Map *map, int x, int y) {
+    if (map->history) history_touch(map->history, map, x, y);
+}
 
 // Calculate distance from center (difficulty scaling)
 static int distance_from_center(const Position *pos) {
@@ -19,198 +27,309 @@ static int distance_from_center(const Position *pos) {
     return (int)sqrt(dx * dx + dy * dy);
 }
 
-// Check if position is a special location
-__attribute__((unused))
-static int is_special_location(const Position *pos) {
-    // Corners of the map
-    if ((pos->x == 0 && pos->y == 0) ||
-        (pos->x == 0 && pos->y == MAP_SIZE - 1) ||
-        (pos->x == MAP_SIZE - 1 && pos->y == 0) ||
-        (pos->x == MAP_SIZE - 1 && pos->y == MAP_SIZE - 1)) {
-        return 1; // Boss location
-    }
-    
-    // Special locations at cardinal directions from center
-    if ((pos->x == MAP_CENTER && pos->y == 0) ||
-        (pos->x == MAP_CENTER && pos->y == MAP_SIZE - 1) ||
-        (pos->x == 0 && pos->y == MAP_CENTER) ||
-        (pos->x == MAP_SIZE - 1 && pos->y == MAP_CENTER)) {
-        return 2; // Shrine location
+// ============================================================================
+// CONTENT TABLE - sparse store for placed and consumed tiles
+// ============================================================================
+
+#define CONTENT_TABLE_MIN 64
+
+// Home bucket of a key. Fibonacci hashing: the top bits of the product
+// spread neighbouring tiles.
+static uint32_t content_home(const Map *map, uint32_t key) {
+    return (key * 0x9E3779B1u) >> (32 - __builtin_ctz(map->content_capacity));
+}
+
+// Slot holding tile `index`, or the free slot where it would go
+static TileSlot *content_find(const Map *map, uint32_t index) {
+    uint32_t mask = map->content_capacity - 1;
+    uint32_t key = index + 1;
+    uint32_t i = content_home(map, key);
+    while (map->content[i].key != 0 && map->content[i].key != key) {
+        i = (i + 1) & mask;
+    }
+    return &map->content[i];
+}
+
+// Zeroed table of `capacity` slots from the map's arena, or the heap
+static TileSlot *content_alloc(Map *map, uint32_t capacity) {
+    if (map->arena) {
+        return arena_alloc_zero(map->arena, capacity * sizeof(TileSlot), _Alignof(TileSlot));
     }
-    
-    return 0;
+    return calloc(capacity, sizeof(TileSlot));
 }
 
-// Recursive backtracking maze generation
-static void carve_maze(Map *map, int x, int y) {
-    map->visited[y][x] = 1;
-    map->tiles[y][x] = TILE_FLOOR;
-    
-    // Create array of directions and shuffle them
-    int dirs[4] = {0, 1, 2, 3};
-    for (int i = 3; i > 0; i--) {
-        int j = rand() % (i + 1);
-        int temp = dirs[i];
-        dirs[i] = dirs[j];
-        dirs[j] = temp;
+static void content_release(Map *map, TileSlot *table, uint32_t capacity) {
+    if (map->arena) {
+        arena_discard(map->arena, table, capacity * sizeof(TileSlot));
+    } else {
+        free(table);
     }
-    
-    // Try each direction
-    for (int i = 0; i < 4; i++) {
-        int dir = dirs[i];
-        int nx = x + dx[dir] * 2;  // Move 2 cells at a time
-        int ny = y + dy[dir] * 2;
+}
+
+/**
+ * Return the slot for tile `index`, inserting an empty one if needed.
+ * Grows the table (doubling) to stay at most 3/4 full.
+ * Returns NULL if memory runs out.
+ */
+static TileSlot *content_slot(Map *map, uint32_t index) {
+    if (map->content) {
+        TileSlot *slot = content_find(map, index);
+        if (slot->key != 0) return slot;
+    }
+    
+    if ((map->content_count + 1) * 4 > map->content_capacity * 3) {
+        uint32_t capacity = map->content_capacity ? map->content_capacity * 2 : CONTENT_TABLE_MIN;
+        TileSlot *table = content_alloc(map, capacity);
+        if (!table) return NULL;
         
-        // Check if valid and unvisited
-        if (nx >= 0 && nx < MAP_SIZE && ny >= 0 && ny < MAP_SIZE && 
-            !map->visited[ny][nx]) {
-            // Carve the corridor between current and next cell
-            int mx = x + dx[dir];
-            int my = y + dy[dir];
-            map->tiles[my][mx] = TILE_CORRIDOR;
-            
-            // Recursively carve from the new cell
-            carve_maze(map, nx, ny);
+        TileSlot *old = map->content;
+        uint32_t old_capacity = map->content_capacity;
+        map->content = table;
+        map->content_capacity = capacity;
+        for (uint32_t i = 0; i < old_capacity; i++) {
+            if (old[i].key != 0) {
+                *content_find(map, old[i].key - 1) = old[i];
+            }
         }
+        content_release(map, old, old_capacity);
     }
+    
+    TileSlot *slot = content_find(map, index);
+    *slot = (TileSlot){index + 1, 0, CONTENT_EMPTY, 0};
+    map->content_count++;
+    return slot;
 }
 
-// Generate procedural maze
-void map_generate(Map *map) {
-    // Initialize all to walls
-    for (int y = 0; y < MAP_SIZE; y++) {
-        for (int x = 0; x < MAP_SIZE; x++) {
-            map->tiles[y][x] = TILE_WALL;
-            map->visited[y][x] = 0;
-            // Initialize tile data
-            map->data[y][x].content = CONTENT_EMPTY;
-            map->data[y][x].difficulty = DIFFICULTY_EASY;
-            map->data[y][x].treasure_value = 0;
-            map->data[y][x].is_looted = 0;
+/**
+ * Remove an occupied slot. Later slots of the probe run are shifted back
+ * so lookups never need tombstones.
+ */
+static void content_remove(Map *map, TileSlot *slot) {
+    uint32_t mask = map->content_capacity - 1;
+    uint32_t hole = (uint32_t)(slot - map->content);
+    for (uint32_t i = (hole + 1) & mask; map->content[i].key != 0; i = (i + 1) & mask) {
+        uint32_t home = content_home(map, map->content[i].key);
+        // Move it into the hole unless its home bucket lies between the hole and i
+        if (((i - home) & mask) >= ((i - hole) & mask)) {
+            map->content[hole] = map->content[i];
+            hole = i;
         }
     }
-    
-    // Start maze generation from center
-    carve_maze(map, MAP_CENTER, MAP_CENTER);
-    
-    // Ensure special locations are accessible
-    map->tiles[0][0] = TILE_FLOOR;  // Top-left boss
-    map->tiles[0][MAP_SIZE - 1] = TILE_FLOOR;  // Bottom-left boss
-    map->tiles[MAP_SIZE - 1][0] = TILE_FLOOR;  // Top-right boss
-    map->tiles[MAP_SIZE - 1][MAP_SIZE - 1] = TILE_FLOOR;  // Bottom-right boss
-    
-    map->tiles[0][MAP_CENTER] = TILE_FLOOR;  // Left shrine
-    map->tiles[MAP_SIZE - 1][MAP_CENTER] = TILE_FLOOR;  // Right shrine
-    map->tiles[MAP_CENTER][0] = TILE_FLOOR;  // Top shrine
-    map->tiles[MAP_CENTER][MAP_SIZE - 1] = TILE_FLOOR;  // Bottom shrine
-    
-    // Add some random connections to make maze less linear (20% chance)
-    for (int y = 1; y < MAP_SIZE - 1; y++) {
-        for (int x = 1; x < MAP_SIZE - 1; x++) {
-            if (map->tiles[y][x] == TILE_WALL && rand() % 100 < 20) {
-                map->tiles[y][x] = TILE_CORRIDOR;
-            }
-        }
+    map->content[hole].key = 0;
+    map->content_count--;
+}
+
+void map_init(Map *map, Arena *arena) {
+    map->seed = 0;
+    map->world = NULL;
+    map->tiles = NULL;
+    map->content = NULL;
+    map->content_capacity = 0;
+    map->content_count = 0;
+    map->arena = arena;
+    map->history = NULL;
+    map->hash = 0;
+}
+
+void map_free(Map *map) {
+    world_release(map->world);
+    content_release(map, map->content, map->content_capacity);
+    map_init(map, map->arena);
+}
+
+// Generate procedural maze with a seed drawn from rng_rand()
+int map_generate(Map *map) {
+    return map_generate_seeded(map, (uint32_t)rng_rand());
+}
+
+/**
+ * Generate a private world for `seed` and start this map on it. Uses no
+ * global state, so it is safe to run on a worker thread while the main
+ * thread keeps going (see worldgen.h).
+ * Returns 0, or -1 (map unchanged) if the world could not be created.
+ */
+int map_generate_seeded(Map *map, uint32_t seed) {
+    World *world = world_create(seed, NULL);
+    if (!world) return -1;
+    map_attach(map, world);
+    world_release(world);  // The map holds its own reference
+    return 0;
+}
+
+/**
+ * Start this map fresh on `world` (which it keeps a reference to):
+ * nothing visited, consumed or placed yet. The content table keeps its
+ * size for the new game.
+ */
+void map_attach(Map *map, World *world) {
+    world_retain(world);
+    world_release(map->world);
+    map->world = world;
+    map->tiles = world->base->tiles;
+    map->seed = world->base->seed;
+    if (map->content) {
+        memset(map->content, 0, map->content_capacity * sizeof(TileSlot));
+    }
+    map->content_count = 0;
+    map->hash = zobrist_world(map->seed);
+}
+
+/**
+ * Look up what is on a tile: content placed there if any, otherwise what
+ * the world started with (world_tile_content). Walls, the starting tile
+ * and positions off the map are empty.
+ */
+void map_tile_content(const Map *map, int x, int y, TileData *out) {
+    *out = (TileData){CONTENT_EMPTY, DIFFICULTY_EASY, 0, 0};
+    if (x < 0 || x >= MAP_SIZE || y < 0 || y >= MAP_SIZE) {
+        return;
     }
     
-    // ========================================================================
-    // PRE-POPULATE DUNGEON WITH CONTENT
-    // ========================================================================
-    
-    // Place bosses at corners
-    map->data[0][0].content = CONTENT_BOSS;
-    map->data[0][MAP_SIZE - 1].content = CONTENT_BOSS;
-    map->data[MAP_SIZE - 1][0].content = CONTENT_BOSS;
-    map->data[MAP_SIZE - 1][MAP_SIZE - 1].content = CONTENT_BOSS;
-    map->data[0][0].difficulty = DIFFICULTY_BOSS;
-    map->data[0][MAP_SIZE - 1].difficulty = DIFFICULTY_BOSS;
-    map->data[MAP_SIZE - 1][0].difficulty = DIFFICULTY_BOSS;
-    map->data[MAP_SIZE - 1][MAP_SIZE - 1].difficulty = DIFFICULTY_BOSS;
-    
-    // Place shrines at cardinal directions
-    map->data[0][MAP_CENTER].content = CONTENT_SHRINE;
-    map->data[MAP_SIZE - 1][MAP_CENTER].content = CONTENT_SHRINE;
-    map->data[MAP_CENTER][0].content = CONTENT_SHRINE;
-    map->data[MAP_CENTER][MAP_SIZE - 1].content = CONTENT_SHRINE;
-    
-    // Populate the dungeon with monsters, treasures, and traps
-    for (int y = 0; y < MAP_SIZE; y++) {
-        for (int x = 0; x < MAP_SIZE; x++) {
-            // Only populate walkable tiles
-            if (map->tiles[y][x] == TILE_WALL) continue;
-            
-            // Skip center starting position
-            if (x == MAP_CENTER && y == MAP_CENTER) continue;
-            
-            // Skip already assigned special locations
-            if (map->data[y][x].content != CONTENT_EMPTY) continue;
-            
-            // Calculate distance from center for difficulty scaling
-            int dx = x - MAP_CENTER;
-            int dy = y - MAP_CENTER;
-            int dist = (int)sqrt(dx * dx + dy * dy);
-            
-            // Random chance to populate this tile
-            int roll = rand() % 100;
-            
-            // Close to center: safer, more healing and treasure
-            if (dist < 10) {
-                if (roll < 15) {  // 15% monster
-                    map->data[y][x].content = CONTENT_MONSTER;
-                    map->data[y][x].difficulty = DIFFICULTY_EASY;
-                } else if (roll < 30) {  // 15% treasure
-                    map->data[y][x].content = CONTENT_TREASURE;
-                    map->data[y][x].treasure_value = 20 + rand() % 40;
-                } else if (roll < 40) {  // 10% healing fountain
-                    map->data[y][x].content = CONTENT_HEALING_FOUNTAIN;
-                } else if (roll < 45) {  // 5% trap
-                    map->data[y][x].content = CONTENT_TRAP;
-                }
-            }
-            // Mid range: balanced danger
-            else if (dist < 20) {
-                if (roll < 30) {  // 30% monster
-                    map->data[y][x].content = CONTENT_MONSTER;
-                    map->data[y][x].difficulty = (rand() % 2) ? DIFFICULTY_EASY : DIFFICULTY_MEDIUM;
-                } else if (roll < 45) {  // 15% treasure
-                    map->data[y][x].content = CONTENT_TREASURE;
-                    map->data[y][x].treasure_value = 40 + rand() % 60;
-                } else if (roll < 53) {  // 8% healing fountain
-                    map->data[y][x].content = CONTENT_HEALING_FOUNTAIN;
-                } else if (roll < 63) {  // 10% trap
-                    map->data[y][x].content = CONTENT_TRAP;
-                }
-            }
-            // Far from center: dangerous
-            else {
-                if (roll < 40) {  // 40% monster
-                    map->data[y][x].content = CONTENT_MONSTER;
-                    int diff_roll = rand() % 100;
-                    if (diff_roll < 40) {
-                        map->data[y][x].difficulty = DIFFICULTY_MEDIUM;
-                    } else if (diff_roll < 80) {
-                        map->data[y][x].difficulty = DIFFICULTY_HARD;
-                    } else {
-                        map->data[y][x].difficulty = DIFFICULTY_EASY;  // Still some easy ones
-                    }
-                } else if (roll < 55) {  // 15% treasure
-                    map->data[y][x].content = CONTENT_TREASURE;
-                    map->data[y][x].treasure_value = 60 + rand() % 100;
-                } else if (roll < 60) {  // 5% healing fountain
-                    map->data[y][x].content = CONTENT_HEALING_FOUNTAIN;
-                } else if (roll < 75) {  // 15% trap
-                    map->data[y][x].content = CONTENT_TRAP;
-                }
+    if (map->content_count) {
+        const TileSlot *slot = content_find(map, (uint32_t)(y * MAP_SIZE + x));
+        if (slot->key != 0) {
+            out->is_looted = (slot->flags & TILE_LOOTED) != 0;
+            if (slot->flags & TILE_PLACED) {
+                out->content = (TileContent)slot->content;
+                out->difficulty = (MonsterDifficulty)(slot->flags & TILE_DIFFICULTY_MASK);
+                out->treasure_value = slot->treasure_value;
+                return;
             }
         }
     }
     
-    // Reset visited array for player exploration tracking
-    for (int y = 0; y < MAP_SIZE; y++) {
-        for (int x = 0; x < MAP_SIZE; x++) {
-            map->visited[y][x] = 0;
-        }
+    int looted = out->is_looted;
+    world_tile_content(map->world->base, x, y, out);
+    out->is_looted = looted;
+}
+
+/**
+ * Mark a tile's content as consumed.
+ * Returns 0 on success, -1 if off the map or out of memory.
+ */
+int map_consume(Map *map, int x, int y) {
+    if (x < 0 || x >= MAP_SIZE || y < 0 || y >= MAP_SIZE) {
+        return -1;
+    }
+    map_touch(map, x, y);
+    uint32_t index = (uint32_t)(y * MAP_SIZE + x);
+    TileSlot *slot = content_slot(map, index);
+    if (!slot) return -1;
+    if (!(slot->flags & TILE_LOOTED)) map->hash ^= zobrist_tile(index, ZOBRIST_LOOTED);
+    slot->flags |= TILE_LOOTED;
+    return 0;
+}
+
+/**
+ * Place fixed content on a tile, replacing whatever was derived or placed
+ * there before and clearing its consumed flag.
+ * Returns 0 on success, -1 if off the map or out of memory.
+ */
+int map_set_content(Map *map, int x, int y, const TileData *data) {
+    if (x < 0 || x >= MAP_SIZE || y < 0 || y >= MAP_SIZE) {
+        return -1;
+    }
+    map_touch(map, x, y);
+    uint32_t index = (uint32_t)(y * MAP_SIZE + x);
+    TileSlot *slot = content_slot(map, index);
+    if (!slot) return -1;
+    if (slot->flags & TILE_LOOTED) map->hash ^= zobrist_tile(index, ZOBRIST_LOOTED);
+    int value = data->treasure_value;
+    slot->treasure_value = (uint16_t)(value < 0 ? 0 : (value > UINT16_MAX ? UINT16_MAX : value));
+    slot->content = (uint8_t)data->content;
+    slot->flags = (uint8_t)((data->difficulty & TILE_DIFFICULTY_MASK) | TILE_PLACED |
+                            (slot->flags & TILE_VISITED));
+    return 0;
+}
+
+// Has the tile's content been consumed? (No content derivation needed.)
+int map_is_looted(const Map *map, int x, int y) {
+    if (!map->content_count || x < 0 || x >= MAP_SIZE || y < 0 || y >= MAP_SIZE) {
+        return 0;
+    }
+    const TileSlot *slot = content_find(map, (uint32_t)(y * MAP_SIZE + x));
+    return slot->key != 0 && (slot->flags & TILE_LOOTED);
+}
+
+int map_is_visited(const Map *map, int x, int y) {
+    if (!map->content_count || x < 0 || x >= MAP_SIZE || y < 0 || y >= MAP_SIZE) {
+        return 0;
     }
+    const TileSlot *slot = content_find(map, (uint32_t)(y * MAP_SIZE + x));
+    return slot->key != 0 && (slot->flags & TILE_VISITED);
+}
+
+// Drop a slot that no longer differs from the world
+static void content_trim(Map *map, TileSlot *slot) {
+    if (!(slot->flags & (TILE_PLACED | TILE_LOOTED | TILE_VISITED))) {
+        content_remove(map, slot);
+    }
+}
+
+/**
+ * Set or clear a tile's visited flag (keeps the map hash in step). Like
+ * map_set_looted(), this is not recorded in the history.
+ */
+void map_set_visited(Map *map, int x, int y, int visited) {
+    if (x < 0 || x >= MAP_SIZE || y < 0 || y >= MAP_SIZE) return;
+    uint32_t index = (uint32_t)(y * MAP_SIZE + x);
+    if (visited) {
+        TileSlot *slot = content_slot(map, index);
+        if (!slot || (slot->flags & TILE_VISITED)) return;
+        slot->flags |= TILE_VISITED;
+    } else {
+        if (!map->content_count) return;
+        TileSlot *slot = content_find(map, index);
+        if (slot->key == 0 || !(slot->flags & TILE_VISITED)) return;
+        slot->flags &= (uint8_t)~TILE_VISITED;
+        content_trim(map, slot);
+    }
+    map->hash ^= zobrist_tile(index, ZOBRIST_VISITED);
+}
+
+/**
+ * Set or clear a tile's consumed flag without recording it in the history
+ * (used to undo). Clearing drops the slot entirely unless it still holds
+ * placed content or the visited flag. Returns 0 on success, -1 if off the map or out of memory.
+ */
+int map_set_looted(Map *map, int x, int y, int looted) {
+    if (x < 0 || x >= MAP_SIZE || y < 0 || y >= MAP_SIZE) {
+        return -1;
+    }
+    uint32_t index = (uint32_t)(y * MAP_SIZE + x);
+    if (looted) {
+        TileSlot *slot = content_slot(map, index);
+        if (!slot) return -1;
+        if (!(slot->flags & TILE_LOOTED)) map->hash ^= zobrist_tile(index, ZOBRIST_LOOTED);
+        slot->flags |= TILE_LOOTED;
+        return 0;
+    }
+    if (!map->content_count) return 0;
+    TileSlot *slot = content_find(map, index);
+    if (slot->key == 0 || !(slot->flags & TILE_LOOTED)) return 0;
+    map->hash ^= zobrist_tile(index, ZOBRIST_LOOTED);
+    slot->flags &= (uint8_t)~TILE_LOOTED;
+    content_trim(map, slot);
+    return 0;
+}
+
+/**
+ * Put back a slot copied out of a content table (a hibernated session's
+ * overlay), flags and placed content as they were, keeping the hash in
+ * step. Returns 0 on success, -1 for a bad key or out of memory.
+ */
+int map_restore_slot(Map *map, const TileSlot *saved) {
+    uint32_t index = saved->key - 1;
+    if (saved->key == 0 || index >= (uint32_t)MAP_SIZE * MAP_SIZE) {
+        return -1;
+    }
+    TileSlot *slot = content_slot(map, index);
+    if (!slot) return -1;
+    uint8_t changed = slot->flags ^ saved->flags;
+    if (changed & TILE_VISITED) map->hash ^= zobrist_tile(index, ZOBRIST_VISITED);
+    if (changed & TILE_LOOTED) map->hash ^= zobrist_tile(index, ZOBRIST_LOOTED);
+    *slot = *saved;
+    return 0;
 }
 
 // Check if position is walkable
@@ -218,7 +337,7 @@ int map_can_move(const Map *map, int x, int y) {
     if (x < 0 || x >= MAP_SIZE || y < 0 || y >= MAP_SIZE) {
         return 0;
     }
-    return map->tiles[y][x] != TILE_WALL;
+    return map->tiles[map_index(x, y)] != TILE_WALL;
 }
 
 // Get tile type at position
@@ -226,285 +345,183 @@ TileType map_get_tile(const Map *map, int x, int y) {
     if (x < 0 || x >= MAP_SIZE || y < 0 || y >= MAP_SIZE) {
         return TILE_WALL;
     }
-    return map->tiles[y][x];
+    return (TileType)map->tiles[map_index(x, y)];
 }
 
-void search_room(Player *player, Position *pos, char *message, Map *map, BattleState *battle)
+void search_room(Player *player, Position *pos, EventLog *log, Map *map, BattleState *battle)
 {
+    TRACE_SCOPE("search_room");
+    
     // Mark room as visited for map display
-    map->visited[pos->y][pos->x] = 1;
+    map_touch(map, pos->x, pos->y);
+    map_set_visited(map, pos->x, pos->y, 1);
     
-    // Get the pre-placed content of this tile
-    TileData *tile = &map->data[pos->y][pos->x];
+    // Look up the content of this tile
+    TileData tile;
+    map_tile_content(map, pos->x, pos->y, &tile);
     
     // If already looted, nothing happens
-    if (tile->is_looted) {
-        snprintf(message, 256, "This area has already been explored. Nothing new here.");
+    if (tile.is_looted) {
+        eventlog_note(log, "This area has already been explored. Nothing new here.");
         return;
     }
     
-    // Process the content based on what was pre-placed
-    switch (tile->content) {
+    // Whatever is here is used up by this visit (monsters won't respawn)
+    map_consume(map, pos->x, pos->y);
+    
+    switch (tile.content) {
     case CONTENT_BOSS: {
-        snprintf(message, 256, "*** BOSS LAIR! An Ancient Dragon appears! ***");
-        battle->is_active = 1;
-        battle->monster = (Monster){
-            .name = "Ancient Dragon",
-            .level = 20,
-            .hp = 250,
-            .attack = 30,
-            .defense = 12,
-            .min_loot = 150,
-            .max_loot = 300,
-            .exp_reward = 500
-        };
-        battle->monster_hp = battle->monster.hp;
-        tile->is_looted = 1;  // Mark as encountered
+        battle_start(battle, monster_spawn(DIFFICULTY_BOSS, player->level));
+        eventlog_push(log, EV_BOSS_APPEARS, battle->monster.name, 0, 0, 0);
         return;
     }
     
     case CONTENT_SHRINE: {
-        int choice = rand() % 3;
+        int choice = rng_rand() % 3;
         if (choice == 0) {
-            int heal = 50 + rand() % 50;
+            int heal = 50 + rng_rand() % 50;
             player->health += heal;
             if (player->health > player->max_health) player->health = player->max_health;
-            snprintf(message, 256, "✦ Found Ancient Shrine! Restored %d HP.", heal);
+            eventlog_push(log, EV_SHRINE_HEAL, NULL, heal, 0, 0);
         } else if (choice == 1) {
-            int gold = 75 + rand() % 75;
+            int gold = 75 + rng_rand() % 75;
             player->gold += gold;
-            snprintf(message, 256, "✦ Found Ancient Shrine! Received %d gold in offerings.", gold);
+            eventlog_push(log, EV_SHRINE_GOLD, NULL, gold, 0, 0);
         } else {
-            int exp = 50 + rand() % 100;
-            player_gain_exp(player, exp);
-            snprintf(message, 256, "✦ Found Ancient Shrine! Gained wisdom (+%d XP).", exp);
+            int exp = 50 + rng_rand() % 100;
+            eventlog_push(log, EV_SHRINE_EXP, NULL, exp, 0, 0);
+            player_gain_exp(player, exp, log);
         }
-        tile->is_looted = 1;
         return;
     }
     
     case CONTENT_MONSTER: {
-        // Monster encounter - use pre-determined difficulty
-        static const Monster easy_monsters[] = {
-            {.name = "Goblin", .level = 1, .hp = 30, .attack = 7, .defense = 1, .min_loot = 8, .max_loot = 20, .exp_reward = 25},
-            {.name = "Skeleton", .level = 2, .hp = 40, .attack = 9, .defense = 2, .min_loot = 12, .max_loot = 26, .exp_reward = 35},
-            {.name = "Giant Rat", .level = 1, .hp = 25, .attack = 6, .defense = 1, .min_loot = 5, .max_loot = 15, .exp_reward = 20},
-        };
-        static const Monster medium_monsters[] = {
-            {.name = "Orc Warrior", .level = 4, .hp = 60, .attack = 13, .defense = 4, .min_loot = 20, .max_loot = 35, .exp_reward = 60},
-            {.name = "Giant Spider", .level = 3, .hp = 50, .attack = 11, .defense = 3, .min_loot = 15, .max_loot = 30, .exp_reward = 45},
-            {.name = "Zombie", .level = 3, .hp = 55, .attack = 10, .defense = 3, .min_loot = 18, .max_loot = 28, .exp_reward = 50},
-        };
-        static const Monster hard_monsters[] = {
-            {.name = "Troll", .level = 6, .hp = 80, .attack = 16, .defense = 5, .min_loot = 30, .max_loot = 45, .exp_reward = 80},
-            {.name = "Dark Knight", .level = 8, .hp = 100, .attack = 20, .defense = 7, .min_loot = 40, .max_loot = 60, .exp_reward = 120},
-            {.name = "Demon", .level = 7, .hp = 90, .attack = 18, .defense = 6, .min_loot = 35, .max_loot = 55, .exp_reward = 100},
-        };
-        
-        Monster m;
-        switch (tile->difficulty) {
-        case DIFFICULTY_EASY:
-            m = easy_monsters[rand() % 3];
-            break;
-        case DIFFICULTY_MEDIUM:
-            m = medium_monsters[rand() % 3];
-            break;
-        case DIFFICULTY_HARD:
-            m = hard_monsters[rand() % 3];
-            break;
-        default:
-            m = easy_monsters[0];
-        }
+        // Monster encounter - draw from the pre-determined difficulty bucket
+        Monster m = monster_spawn(tile.difficulty, player->level);
         
-        battle->is_active = 1;
-        battle->monster = m;
-        battle->monster_hp = m.hp;
-        snprintf(message, 256, "⚔ A %s appears! Prepare for battle!", m.name);
-        tile->is_looted = 1;  // Monster won't respawn
+        battle_start(battle, m);
+        eventlog_push(log, EV_MONSTER_APPEARS, m.name, 0, 0, 0);
         return;
     }
     
     case CONTENT_TREASURE: {
-        int gold = tile->treasure_value;
+        int gold = tile.treasure_value;
         player->gold += gold;
         
-        // Chance for bonus item (30%)
-        if (rand() % 100 < 30) {
-            Item drop;
-            int drop_type = rand() % 100;
-            
-            if (drop_type < 40) {
-                drop = (Item){10, ITEM_CONSUMABLE, "Health Potion", 1, {0, 0}, 10};
-            } else if (drop_type < 70) {
-                const char *weapon_names[] = {"Iron Sword", "Steel Axe", "War Hammer", "Enchanted Blade"};
-                int wpn_idx = rand() % 4;
-                int dmg_bonus = 5 + rand() % 8 + (tile->treasure_value / 20);
-                drop = (Item){20 + wpn_idx, ITEM_WEAPON, weapon_names[wpn_idx], 1, {dmg_bonus, 0}, 20 + dmg_bonus * 2};
-            } else {
-                const char *armor_names[] = {"Leather Armor", "Chain Mail", "Plate Armor", "Dragon Scale"};
-                int arm_idx = rand() % 4;
-                int def_bonus = 3 + rand() % 6 + (tile->treasure_value / 25);
-                drop = (Item){30 + arm_idx, ITEM_ARMOR, armor_names[arm_idx], 1, {0, def_bonus}, 15 + def_bonus * 2};
-            }
-            
-            player_add_item(player, &drop);
-            snprintf(message, 256, "💰 Found treasure chest with %d gold and %s!", gold, drop.name);
-        } else {
-            snprintf(message, 256, "💰 Found treasure chest with %d gold!", gold);
-        }
-        tile->is_looted = 1;
+        // Chance for bonus item from the "treasure" loot table (chest value = quality)
+        LootDrop drop;
+        int item_id = loot_give(player, "treasure", tile.treasure_value, &drop, log) ? drop.item_id : 0;
+        eventlog_push(log, EV_TREASURE, NULL, gold, item_id, 0);
         return;
     }
     
     case CONTENT_TRAP: {
         int dist = distance_from_center(pos);
-        int dmg = 10 + rand() % 20 + (dist / 3);
+        int dmg = 10 + rng_rand() % 20 + (dist / 3);
         player->health -= dmg;
         if (player->health < 0) player->health = 0;
-        snprintf(message, 256, "💥 Trap triggered! Took %d damage.", dmg);
-        tile->is_looted = 1;
+        eventlog_push(log, EV_TRAP, NULL, dmg, 0, 0);
         return;
     }
     
     case CONTENT_HEALING_FOUNTAIN: {
-        int heal = 20 + rand() % 30;
+        int heal = 20 + rng_rand() % 30;
         player->health += heal;
         if (player->health > player->max_health) player->health = player->max_health;
-        snprintf(message, 256, "⛲ Found a healing fountain! Recovered %d HP.", heal);
-        tile->is_looted = 1;
+        eventlog_push(log, EV_FOUNTAIN, NULL, heal, 0, 0);
         return;
     }
     
     case CONTENT_EMPTY:
     default:
         // Empty room - small chance for random events
-        if (rand() % 100 < 10) {
-            int event = rand() % 3;
+        if (rng_rand() % 100 < 10) {
+            int event = rng_rand() % 3;
             if (event == 0) {
-                int gold = 5 + rand() % 10;
+                int gold = 5 + rng_rand() % 10;
                 player->gold += gold;
-                snprintf(message, 256, "Found %d gold coins on the ground.", gold);
+                eventlog_push(log, EV_GOLD_FOUND, NULL, gold, 0, 0);
             } else if (event == 1) {
-                snprintf(message, 256, "You hear distant echoes through the corridors...");
+                eventlog_note(log, "You hear distant echoes through the corridors...");
             } else {
-                snprintf(message, 256, "Strange markings on the walls catch your eye.");
+                eventlog_note(log, "Strange markings on the walls catch your eye.");
             }
         } else {
-            snprintf(message, 256, "Nothing of interest found in this area.");
+            eventlog_note(log, "Nothing of interest found in this area.");
         }
-        tile->is_looted = 1;
         return;
     }
 }
 
 // Handle battle commands
-static void handle_battle_command(char command, Player *player, BattleState *battle, char *message, GameState *state) {
+static void handle_battle_command(char command, Player *player, BattleState *battle, EventLog *log, GameState *state) {
+    TRACE_SCOPE("handle_battle_command");
     command = (char)toupper((unsigned char)command);
     
     switch (command) {
-    case 'A': {
-        // Player attacks
-        int p_roll = rand() % 6;
-        int p_attack = player->total_damage + p_roll;
-        int dmg_to_mon = p_attack - battle->monster.defense;
-        if (dmg_to_mon < 1) dmg_to_mon = 1;
-        
-        battle->monster_hp -= dmg_to_mon;
-        if (battle->monster_hp < 0) battle->monster_hp = 0;
-        
-        snprintf(message, 256, "You hit the %s for %d damage!", battle->monster.name, dmg_to_mon);
-        
-        // Check if monster died
-        if (battle->monster_hp <= 0) {
-            int loot = battle->monster.min_loot + (rand() % (battle->monster.max_loot - battle->monster.min_loot + 1));
-            player->gold += loot;
-            player_gain_exp(player, battle->monster.exp_reward);
-            
-            char temp[256];
-            snprintf(temp, 256, "%s Victory! Defeated %s! Gained %d gold and %d XP.", 
-                    message, battle->monster.name, loot, battle->monster.exp_reward);
-            strcpy(message, temp);
-            
-            // Random item drops (15% chance)
-            if (rand() % 100 < 15) {
-                Item drop;
-                int drop_type = rand() % 100;
-                
-                if (drop_type < 40) {
-                    drop = (Item){10, ITEM_CONSUMABLE, "Health Potion", 1, {0, 0}, 10};
-                } else if (drop_type < 70) {
-                    const char *weapon_names[] = {"Iron Sword", "Steel Axe", "War Hammer", "Enchanted Blade"};
-                    int wpn_idx = rand() % 4;
-                    int dmg_bonus = 8 + rand() % 10;
-                    drop = (Item){20 + wpn_idx, ITEM_WEAPON, weapon_names[wpn_idx], 1, {dmg_bonus, 0}, 20 + dmg_bonus * 2};
-                } else {
-                    const char *armor_names[] = {"Leather Armor", "Chain Mail", "Plate Armor", "Dragon Scale"};
-                    int arm_idx = rand() % 4;
-                    int def_bonus = 4 + rand() % 8;
-                    drop = (Item){30 + arm_idx, ITEM_ARMOR, armor_names[arm_idx], 1, {0, def_bonus}, 15 + def_bonus * 2};
-                }
-                
-                player_add_item(player, &drop);
-                char temp2[256];
-                snprintf(temp2, 256, "%s Also received %s!", message, drop.name);
-                strcpy(message, temp2);
-            }
-            
-            battle->is_active = 0;
+    case 'A':
+        // Player attacks; the rules in enemies.c report the round to the log
+        if (battle_attack(player, battle, log)) {
             *state = STATE_EXPLORING;
-            return;
         }
-        
-        // Monster counterattacks
-        int m_roll = rand() % 4;
-        int m_attack = battle->monster.attack + m_roll;
-        int dmg_to_player = m_attack - player->total_defense;
-        if (dmg_to_player < 1) dmg_to_player = 1;
-        
-        player->health -= dmg_to_player;
-        if (player->health < 0) player->health = 0;
-        
-        char temp[256];
-        snprintf(temp, 256, "%s The %s counters for %d damage!", 
-                message, battle->monster.name, dmg_to_player);
-        strcpy(message, temp);
         break;
-    }
     
-    case 'Q': {
-        if (rand() % 100 < 30) {  // 30% flee chance
-            snprintf(message, 256, "You successfully fled from the %s!", battle->monster.name);
-            battle->is_active = 0;
+    case 'Q':
+        if (battle_flee(player, battle, log)) {
             *state = STATE_EXPLORING;
-        } else {
-            // Failed flee - monster gets free hit
-            int m_roll = rand() % 4;
-            int m_attack = battle->monster.attack + m_roll;
-            int dmg_to_player = m_attack - player->total_defense;
-            if (dmg_to_player < 1) dmg_to_player = 1;
-            
-            player->health -= dmg_to_player;
-            if (player->health < 0) player->health = 0;
-            
-            snprintf(message, 256, "Failed to flee! The %s punishes you for %d damage!", 
-                    battle->monster.name, dmg_to_player);
         }
         break;
-    }
     
     case 'I': {
         // TODO: Implement item use in battle
-        snprintf(message, 256, "Item use in battle - coming soon!");
+        eventlog_note(log, "Item use in battle - coming soon!");
         break;
     }
     
     default:
-        snprintf(message, 256, "Invalid command! Use A to attack, I for item, Q to flee.");
+        eventlog_note(log, "Invalid command! Use A to attack, I for item, Q to flee.");
         break;
     }
 }
 
-void handle_inventory_command(Player *player, char *message, GameState *state, char first_char)
+// Carry out an inventory command once it has been read
+static void run_inventory_command(Player *player, EventLog *log, GameState *state, char command, int slot)
+{
+    // Handle commands
+    switch (command) {
+    case 'Q':
+        // Exit inventory
+        *state = STATE_EXPLORING;
+        eventlog_note(log, "Exited inventory.");
+        return;
+        
+    case 'U':
+        // Use consumable - requires a slot number
+        if (slot < 0) {
+            eventlog_note(log, "Invalid slot number! Use: U <slot>  (e.g., U 1)");
+            return;
+        }
+        
+        player_use_item(player, slot, log);
+        return;
+        
+    case 'E':
+        // Equip item - requires a slot number
+        if (slot < 0) {
+            eventlog_note(log, "Invalid slot number! Use: E <slot>  (e.g., E 0)");
+            return;
+        }
+        
+        player_equip_item(player, slot, log);
+        return;
+        
+    default:
+        eventlog_push(log, EV_BAD_COMMAND, NULL, command, 0, 0);
+        return;
+    }
+}
+
+void handle_inventory_command(Player *player, EventLog *log, GameState *state, char first_char)
 {
     char input_buffer[256];
     char command = '\0';
@@ -522,7 +539,7 @@ void handle_inventory_command(Player *player, char *message, GameState *state, c
                 // Clear buffer
                 int c;
                 while ((c = getchar()) != '\n' && c != EOF);
-                snprintf(message, 256, "Invalid slot number! Use: %c <slot>  (e.g., %c 1)", command, command);
+                eventlog_push(log, EV_SLOT_MISSING, NULL, command, 0, 0);
                 return;
             }
             // Clear the rest of the line
@@ -536,143 +553,52 @@ void handle_inventory_command(Player *player, char *message, GameState *state, c
     } else {
         // Read entire line of input
         if (fgets(input_buffer, sizeof(input_buffer), stdin) == NULL) {
-            snprintf(message, 256, "Invalid input!");
-            return;
-        }
-        
-        // Parse the command - sscanf extracts first char and optional number
-        int items_read = sscanf(input_buffer, " %c %d", &command, &slot);
-        
-        if (items_read < 1) {
-            snprintf(message, 256, "Invalid input! Could not read command.");
-            return;
-        }
-        
-        // Convert command to uppercase
-        command = (char)toupper((unsigned char)command);
-        
-        // Check if slot is needed but not provided
-        if ((command == 'U' || command == 'E') && items_read < 2) {
-            snprintf(message, 256, "Invalid slot number! Use: %c <slot>  (e.g., %c 1)", command, command);
+            eventlog_note(log, "Invalid input!");
             return;
         }
+        handle_inventory_line(player, log, state, input_buffer);
+        return;
     }
     
-    // Handle commands
-    switch (command) {
-    case 'Q':
-        // Exit inventory
-        *state = STATE_EXPLORING;
-        snprintf(message, 256, "Exited inventory.");
-        return;
-        
-    case 'U':
-        // Use consumable - requires a slot number
-        if (slot < 0) {
-            snprintf(message, 256, "Invalid slot number! Use: U <slot>  (e.g., U 1)");
-            return;
-        }
-        
-        if (slot < 0 || slot >= player->inv_count) {
-            snprintf(message, 256, "Invalid slot %d! Choose 0-%d.", slot, player->inv_count - 1);
-            return;
-        }
-        
-        Item *use_item = &player->inventory[slot];
-        if (use_item->type != ITEM_CONSUMABLE) {
-            snprintf(message, 256, "Cannot use %s - not a consumable!", use_item->name);
-            return;
-        }
-        
-        if (use_item->quantity <= 0) {
-            snprintf(message, 256, "%s is depleted!", use_item->name);
-            return;
-        }
-        
-        // Use the item (heal)
-        int heal_amount = 30 + (use_item->value * 2);
-        int old_hp = player->health;
-        player->health += heal_amount;
-        if (player->health > player->max_health) {
-            player->health = player->max_health;
-        }
-        int actual_heal = player->health - old_hp;
-        
-        use_item->quantity--;
-        
-        // Remove if depleted
-        if (use_item->quantity <= 0) {
-            snprintf(message, 256, "Used %s! Healed %d HP. %s depleted!", 
-                    use_item->name, actual_heal, use_item->name);
-            // Shift inventory
-            for (int i = slot; i < player->inv_count - 1; i++) {
-                player->inventory[i] = player->inventory[i + 1];
-                if (player->equipped.weapon_slot == i + 1) player->equipped.weapon_slot = i;
-                if (player->equipped.armor_slot == i + 1) player->equipped.armor_slot = i;
-            }
-            player->inv_count--;
-            if (player->equipped.weapon_slot == slot) player->equipped.weapon_slot = INVALID_SLOT;
-            if (player->equipped.armor_slot == slot) player->equipped.armor_slot = INVALID_SLOT;
-        } else {
-            snprintf(message, 256, "Used %s! Healed %d HP. (%d remaining)", 
-                    use_item->name, actual_heal, use_item->quantity);
-        }
-        return;
-        
-    case 'E':
-        // Equip item - requires a slot number
-        if (slot < 0) {
-            snprintf(message, 256, "Invalid slot number! Use: E <slot>  (e.g., E 0)");
-            return;
-        }
-        
-        if (slot < 0 || slot >= player->inv_count) {
-            snprintf(message, 256, "Invalid slot %d! Choose 0-%d.", slot, player->inv_count - 1);
-            return;
-        }
-        
-        Item *equip_item = &player->inventory[slot];
-        
-        if (equip_item->type == ITEM_WEAPON) {
-            if (player->equipped.weapon_slot == slot) {
-                snprintf(message, 256, "%s is already equipped!", equip_item->name);
-            } else {
-                player->equipped.weapon_slot = slot;
-                player_apply_equipment(player);
-                snprintf(message, 256, "Equipped %s! Attack: %d (+%d dmg)", 
-                        equip_item->name, player->total_damage, equip_item->stats.damage);
-            }
-        } else if (equip_item->type == ITEM_ARMOR) {
-            if (player->equipped.armor_slot == slot) {
-                snprintf(message, 256, "%s is already equipped!", equip_item->name);
-            } else {
-                player->equipped.armor_slot = slot;
-                player_apply_equipment(player);
-                snprintf(message, 256, "Equipped %s! Defense: %d (+%d def)", 
-                        equip_item->name, player->total_defense, equip_item->stats.defense);
-            }
-        } else {
-            snprintf(message, 256, "Cannot equip %s - not a weapon or armor!", equip_item->name);
-        }
+    run_inventory_command(player, log, state, command, slot);
+}
+
+void handle_inventory_line(Player *player, EventLog *log, GameState *state, const char *line)
+{
+    char command = '\0';
+    int slot = -1;
+    
+    // Parse the command - sscanf extracts first char and optional number
+    int items_read = sscanf(line, " %c %d", &command, &slot);
+    
+    if (items_read < 1) {
+        eventlog_note(log, "Invalid input! Could not read command.");
         return;
-        
-    default:
-        snprintf(message, 256, "Invalid command '%c'! Use U <slot>, E <slot>, or Q to exit.", command);
+    }
+    
+    // Convert command to uppercase
+    command = (char)toupper((unsigned char)command);
+    
+    // Check if slot is needed but not provided
+    if ((command == 'U' || command == 'E') && items_read < 2) {
+        eventlog_push(log, EV_SLOT_MISSING, NULL, command, 0, 0);
         return;
     }
+    
+    run_inventory_command(player, log, state, command, slot);
 }
 
-void handle_command(char command, int *running, Position *pos, Player *player, char *message, Map *map, GameState *state, BattleState *battle)
+void handle_command(char command, int *running, Position *pos, Player *player, EventLog *log, Map *map, GameState *state, BattleState *battle)
 {
     // If in battle, handle battle commands
     if (*state == STATE_BATTLE) {
-        handle_battle_command(command, player, battle, message, state);
+        handle_battle_command(command, player, battle, log, state);
         return;
     }
     
     // If in inventory, handle inventory commands
     if (*state == STATE_INVENTORY) {
-        handle_inventory_command(player, message, state, command);
+        handle_inventory_command(player, log, state, command);
         return;
     }
     
@@ -686,7 +612,7 @@ void handle_command(char command, int *running, Position *pos, Player *player, c
     {
     case 'Q':
         *running = 0;
-        snprintf(message, 256, "Quitting the game. Thanks for playing!");
+        eventlog_note(log, "Quitting the game. Thanks for playing!");
         return;
     case 'M':
         // Show the explored map
@@ -695,18 +621,27 @@ void handle_command(char command, int *running, Position *pos, Player *player, c
         printf("\nPress any key to continue...");
         fflush(stdout);
         getchar();  // Wait for user input
-        snprintf(message, 256, "Viewing map...");
+        eventlog_note(log, "Viewing map...");
+        return;
+    case 'L':
+        // Scroll back through the event log
+        ui_clear_screen();
+        ui_render_log(log, 20);  // Show the last 20 events
+        printf("\nPress any key to continue...");
+        fflush(stdout);
+        getchar();  // Wait for user input
+        eventlog_note(log, "Viewing log...");
         return;
     case 'I':
         *state = STATE_INVENTORY;
-        snprintf(message, 256, "Viewing inventory. Use U <slot> to use items, E <slot> to equip, Q to exit.");
+        eventlog_note(log, "Viewing inventory. Use U <slot> to use items, E <slot> to equip, Q to exit.");
         return;
     case 'N':
         new_pos.y--;
         if (map_can_move(map, new_pos.x, new_pos.y)) {
             moved = 1;
         } else {
-            snprintf(message, 256, "Cannot go north - there's a wall!");
+            eventlog_push(log, EV_BLOCKED, "north", 0, 0, 0);
         }
         break;
     case 'S':
@@ -714,7 +649,7 @@ void handle_command(char command, int *running, Position *pos, Player *player, c
         if (map_can_move(map, new_pos.x, new_pos.y)) {
             moved = 1;
         } else {
-            snprintf(message, 256, "Cannot go south - there's a wall!");
+            eventlog_push(log, EV_BLOCKED, "south", 0, 0, 0);
         }
         break;
     case 'E':
@@ -722,7 +657,7 @@ void handle_command(char command, int *running, Position *pos, Player *player, c
         if (map_can_move(map, new_pos.x, new_pos.y)) {
             moved = 1;
         } else {
-            snprintf(message, 256, "Cannot go east - there's a wall!");
+            eventlog_push(log, EV_BLOCKED, "east", 0, 0, 0);
         }
         break;
     case 'W':
@@ -730,17 +665,19 @@ void handle_command(char command, int *running, Position *pos, Player *player, c
         if (map_can_move(map, new_pos.x, new_pos.y)) {
             moved = 1;
         } else {
-            snprintf(message, 256, "Cannot go west - there's a wall!");
+            eventlog_push(log, EV_BLOCKED, "west", 0, 0, 0);
         }
         break;
     default:
-        snprintf(message, 256, "Invalid command. Use N/S/E/W to move, I for inventory, M for map, Q to quit.");
+        eventlog_note(log, "Invalid command. Use N/S/E/W to move, I for inventory, M for map, L for log, Q to quit.");
         return;
     }
     
     if (moved) {
         *pos = new_pos;
-        search_room(player, pos, message, map, battle);
+        uint64_t search_start = metrics_now_ns();
+        search_room(player, pos, log, map, battle);
+        metrics_observe_since(METRIC_SEARCH_ROOM, search_start);
         
         // If a battle started, switch to battle state
         if (battle->is_active) {
@@ -749,15 +686,70 @@ void handle_command(char command, int *running, Position *pos, Player *player, c
     }
 }
 
+/**
+ * Count explored/walkable tiles and remaining monsters and treasure. The
+ * world knows the totals for an untouched map, so only the tiles this
+ * player changed (the content table) need looking at.
+ */
+void map_explore_stats(const Map *map, MapStats *out) {
+    const WorldBase *base = map->world->base;
+    int total_visited = 0;
+    int monsters_remaining = (int)base->monsters;
+    int treasures_remaining = (int)base->treasures;
+    
+    for (uint32_t i = 0; i < map->content_capacity; i++) {
+        const TileSlot *slot = &map->content[i];
+        if (slot->key == 0) continue;
+        int x = (int)((slot->key - 1) % MAP_SIZE);
+        int y = (int)((slot->key - 1) / MAP_SIZE);
+        if (map->tiles[map_index(x, y)] == TILE_WALL) continue;
+        if (slot->flags & TILE_VISITED) total_visited++;
+        
+        // Swap what the world counted for this tile for what is there now
+        TileData was, now;
+        world_tile_content(base, x, y, &was);
+        map_tile_content(map, x, y, &now);
+        monsters_remaining -= was.content == CONTENT_MONSTER || was.content == CONTENT_BOSS;
+        treasures_remaining -= was.content == CONTENT_TREASURE;
+        if (!now.is_looted) {
+            monsters_remaining += now.content == CONTENT_MONSTER || now.content == CONTENT_BOSS;
+            treasures_remaining += now.content == CONTENT_TREASURE;
+        }
+    }
+    
+    out->visited = total_visited;
+    out->walkable = (int)base->walkable;
+    out->monsters_remaining = monsters_remaining;
+    out->treasures_remaining = treasures_remaining;
+}
+
 // Print explored map with 'X' markers on visited tiles
+char map_glyph(const Map *map, int x, int y) {
+    if (map->tiles[map_index(x, y)] == TILE_WALL) return '#';
+    if (!map_is_visited(map, x, y)) return '?';
+    TileData tile;
+    map_tile_content(map, x, y, &tile);
+    if (tile.is_looted) return 'X';
+    switch (tile.content) {
+    case CONTENT_MONSTER: return 'M';
+    case CONTENT_TREASURE: return 'T';
+    case CONTENT_TRAP: return '!';
+    case CONTENT_HEALING_FOUNTAIN: return '+';
+    case CONTENT_BOSS: return 'B';
+    case CONTENT_SHRINE: return 'S';
+    default: return 'X';
+    }
+}
+
 void print_explored_map(const Map *map, const Position *pos, int radius) {
-    printf("\n╔══════════════════════════════════════════════════════════════╗\n");
-    printf("║                      EXPLORED MAP                            ║\n");
-    printf("╚══════════════════════════════════════════════════════════════╝\n\n");
+    TRACE_SCOPE("print_explored_map");
+    ui_printf("\n╔══════════════════════════════════════════════════════════════╗\n");
+    ui_printf("║                      EXPLORED MAP                            ║\n");
+    ui_printf("╚══════════════════════════════════════════════════════════════╝\n\n");
     
-    printf("Legend: @ = You  X = Visited  ? = Unexplored  # = Wall  \n");
-    printf("        M = Monster  T = Treasure  ! = Trap  + = Healing\n");
-    printf("        B = Boss  S = Shrine\n\n");
+    ui_printf("Legend: @ = You  X = Visited  ? = Unexplored  # = Wall  \n");
+    ui_printf("        M = Monster  T = Treasure  ! = Trap  + = Healing\n");
+    ui_printf("        B = Boss  S = Shrine\n\n");
     
     // Display a section of the map around the player
     int start_y = pos->y - radius;
@@ -772,106 +764,44 @@ void print_explored_map(const Map *map, const Position *pos, int radius) {
     if (end_x >= MAP_SIZE) end_x = MAP_SIZE - 1;
     
     // Print column numbers
-    printf("    ");
+    ui_printf("    ");
     for (int x = start_x; x <= end_x; x++) {
-        printf("%2d", x % 100);
+        ui_printf("%2d", x % 100);
     }
-    printf("\n    ");
+    ui_printf("\n    ");
     for (int x = start_x; x <= end_x; x++) {
-        printf("──");
+        ui_printf("──");
     }
-    printf("\n");
+    ui_printf("\n");
     
     // Print map
     for (int y = start_y; y <= end_y; y++) {
-        printf("%2d │ ", y);
+        ui_printf("%2d │ ", y);
         for (int x = start_x; x <= end_x; x++) {
             // Current player position
             if (x == pos->x && y == pos->y) {
-                printf("@ ");
-                continue;
-            }
-            
-            // Wall
-            if (map->tiles[y][x] == TILE_WALL) {
-                printf("# ");
+                ui_printf("@ ");
                 continue;
             }
             
-            // Visited tile - show what was there or X if looted
-            if (map->visited[y][x]) {
-                // If already looted, show X
-                if (map->data[y][x].is_looted) {
-                    printf("X ");
-                } else {
-                    // Show what's there
-                    switch (map->data[y][x].content) {
-                    case CONTENT_MONSTER:
-                        printf("M ");
-                        break;
-                    case CONTENT_TREASURE:
-                        printf("T ");
-                        break;
-                    case CONTENT_TRAP:
-                        printf("! ");
-                        break;
-                    case CONTENT_HEALING_FOUNTAIN:
-                        printf("+ ");
-                        break;
-                    case CONTENT_BOSS:
-                        printf("B ");
-                        break;
-                    case CONTENT_SHRINE:
-                        printf("S ");
-                        break;
-                    default:
-                        printf("X ");
-                        break;
-                    }
-                }
-            } else {
-                // Unvisited - show as unknown
-                printf("? ");
-            }
+            ui_printf("%c ", map_glyph(map, x, y));
         }
-        printf("\n");
+        ui_printf("\n");
     }
     
-    printf("\n");
-    printf("Current Position: (%d, %d)\n", pos->x, pos->y);
-    printf("Distance from Center: %d tiles\n", distance_from_center(pos));
+    ui_printf("\n");
+    ui_printf("Current Position: (%d, %d)\n", pos->x, pos->y);
+    ui_printf("Distance from Center: %d tiles\n", distance_from_center(pos));
     
     // Count statistics
-    int total_visited = 0;
-    int total_walkable = 0;
-    int monsters_remaining = 0;
-    int treasures_remaining = 0;
-    
-    for (int y = 0; y < MAP_SIZE; y++) {
-        for (int x = 0; x < MAP_SIZE; x++) {
-            if (map->tiles[y][x] != TILE_WALL) {
-                total_walkable++;
-                if (map->visited[y][x]) {
-                    total_visited++;
-                }
-                if (!map->data[y][x].is_looted) {
-                    if (map->data[y][x].content == CONTENT_MONSTER || 
-                        map->data[y][x].content == CONTENT_BOSS) {
-                        monsters_remaining++;
-                    }
-                    if (map->data[y][x].content == CONTENT_TREASURE) {
-                        treasures_remaining++;
-                    }
-                }
-            }
-        }
-    }
-    
-    printf("\nExploration: %d/%d tiles (%.1f%%)\n", 
-           total_visited, total_walkable, 
-           (100.0 * total_visited) / total_walkable);
-    printf("Monsters remaining: %d\n", monsters_remaining);
-    printf("Treasures remaining: %d\n", treasures_remaining);
-    printf("\n");
+    MapStats stats;
+    map_explore_stats(map, &stats);
+    
+    ui_printf("\nExploration: %d/%d tiles (%.1f%%)\n", 
+           stats.visited, stats.walkable, 
+           (100.0 * stats.visited) / stats.walkable);
+    ui_printf("Monsters remaining: %d\n", stats.monsters_remaining);
+    ui_printf("Treasures remaining: %d\n", stats.treasures_remaining);
+    ui_printf("\n");
 }
 
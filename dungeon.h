@@ -1,13 +1,45 @@
 #ifndef DUNGEON_H
 #define DUNGEON_H
 
+#include <stdint.h>
+#include "arena.h"
 #include "player.h"
 #include "enemies.h"
+#include "eventlog.h"
 
-// Map constants
+// Map constants (MAP_SIZE can be overridden at build time, e.g. -DMAP_SIZE=250)
+#ifndef MAP_SIZE
 #define MAP_SIZE 500
+#endif
 #define MAP_CENTER (MAP_SIZE / 2)
 
+/*
+ * Storage layout of the per-tile layers. Row-major by default; build with
+ * -DMAP_LAYOUT_TILED (make MAP_LAYOUT=tiled) to store the map as 16x16
+ * blocks, so a viewport or a tile's neighbours share cache lines and pages
+ * instead of striding MAP_SIZE entries per row. Always index through
+ * map_index().
+ */
+#ifdef MAP_LAYOUT_TILED
+#define MAP_BLOCK_SHIFT 4
+#define MAP_BLOCK_MASK ((1 << MAP_BLOCK_SHIFT) - 1)
+#define MAP_BLOCKS ((MAP_SIZE + MAP_BLOCK_MASK) >> MAP_BLOCK_SHIFT)  // Blocks per row
+#define MAP_CELLS (MAP_BLOCKS * MAP_BLOCKS << (2 * MAP_BLOCK_SHIFT))
+#define MAP_LAYOUT_NAME "tiled"
+
+static inline int map_index(int x, int y) {
+    int block = (y >> MAP_BLOCK_SHIFT) * MAP_BLOCKS + (x >> MAP_BLOCK_SHIFT);
+    return block << (2 * MAP_BLOCK_SHIFT) | (y & MAP_BLOCK_MASK) << MAP_BLOCK_SHIFT | (x & MAP_BLOCK_MASK);
+}
+#else
+#define MAP_CELLS (MAP_SIZE * MAP_SIZE)
+#define MAP_LAYOUT_NAME "row"
+
+static inline int map_index(int x, int y) {
+    return y * MAP_SIZE + x;
+}
+#endif
+
 // Tile types
 typedef enum {
     TILE_WALL,
@@ -26,21 +58,13 @@ typedef enum {
     CONTENT_SHRINE
 } TileContent;
 
-// Monster difficulty levels
-typedef enum {
-    DIFFICULTY_EASY,
-    DIFFICULTY_MEDIUM,
-    DIFFICULTY_HARD,
-    DIFFICULTY_BOSS
-} MonsterDifficulty;
-
 // Position on the map
 typedef struct {
     int x;
     int y;
 } Position;
 
-// Tile data structure
+// Tile data structure (filled in on demand by map_tile_content)
 typedef struct {
     TileContent content;
     MonsterDifficulty difficulty;  // For monsters
@@ -48,13 +72,58 @@ typedef struct {
     int is_looted;                 // Has this tile's content been consumed?
 } TileData;
 
-// Map structure
+// One stored tile in the map's content table (8 bytes)
 typedef struct {
-    TileType tiles[MAP_SIZE][MAP_SIZE];
-    TileData data[MAP_SIZE][MAP_SIZE];  // Content of each tile
-    int visited[MAP_SIZE][MAP_SIZE];
+    uint32_t key;             // Tile index + 1 (0 = free slot)
+    uint16_t treasure_value;  // For placed treasure
+    uint8_t content;          // TileContent of placed content
+    uint8_t flags;            // Difficulty in bits 0-1, plus TILE_PLACED / TILE_LOOTED
+} TileSlot;
+
+#define TILE_DIFFICULTY_MASK 0x03
+#define TILE_PLACED          0x04  // Slot content replaces the derived content
+#define TILE_LOOTED          0x08  // Tile's content has been consumed
+#define TILE_VISITED         0x10  // Player has been on the tile
+
+/*
+ * Map structure - one player's view of a world. The maze and what every
+ * tile starts out holding belong to a shared, read-only World (world.h)
+ * that any number of maps can play at once. The map itself only keeps
+ * what this player changed - tiles visited, content consumed and content
+ * placed by map_set_content() - as slots in an open-addressing table
+ * keyed by tile index, so its memory grows with the tiles actually
+ * touched.
+ *
+ * Call map_init() once before the first map_generate() or map_attach()
+ * and map_free() when done. The content table comes from the game's
+ * arena when one is given, otherwise from the heap.
+ */
+typedef struct {
+    uint32_t seed;                     // World seed for derived content
+    struct World *world;               // Shared terrain and initial content (NULL until generated)
+    const uint8_t *tiles;              // The world's TileTypes, indexed by map_index(x, y)
+    TileSlot *content;                 // Power-of-two table, NULL until first use
+    uint32_t content_capacity;
+    uint32_t content_count;
+    Arena *arena;                      // Owner of `content` (NULL = heap)
+    struct History *history;           // Undo journal for changes (NULL = off)
+    uint64_t hash;                     // Zobrist hash of seed, visited and consumed flags (zobrist.h)
 } Map;
 
+// Arena space for a Map and its content table in the worst case: every
+// tile stored (at most 8/3 slots per tile at 3/4 load) plus all the
+// smaller tables it outgrew on the way. The world itself is not in the
+// arena.
+#define MAP_ARENA_BYTES (sizeof(Map) + (size_t)MAP_SIZE * MAP_SIZE * 6 * sizeof(TileSlot))
+
+// Exploration summary shown under the map view
+typedef struct {
+    int visited;
+    int walkable;
+    int monsters_remaining;
+    int treasures_remaining;
+} MapStats;
+
 // Game states
 typedef enum {
     STATE_EXPLORING,
@@ -63,22 +132,32 @@ typedef enum {
     STATE_MAP_VIEW
 } GameState;
 
-// Battle state
-typedef struct {
-    Monster monster;
-    int monster_hp;
-    int is_active;
-} BattleState;
-
 // Map generation and access
-void map_generate(Map *map);
+void map_init(Map *map, Arena *arena);
+void map_free(Map *map);
+int map_generate(Map *map);
+int map_generate_seeded(Map *map, uint32_t seed);
+void map_attach(Map *map, struct World *world);
 int map_can_move(const Map *map, int x, int y);
 TileType map_get_tile(const Map *map, int x, int y);
+void map_explore_stats(const Map *map, MapStats *out);
+void map_tile_content(const Map *map, int x, int y, TileData *out);
+int map_consume(Map *map, int x, int y);
+int map_set_content(Map *map, int x, int y, const TileData *data);
+int map_is_looted(const Map *map, int x, int y);
+int map_is_visited(const Map *map, int x, int y);
+void map_set_visited(Map *map, int x, int y, int visited);
+int map_set_looted(Map *map, int x, int y, int looted);
+int map_restore_slot(Map *map, const TileSlot *saved);
+// What the explored map shows for a tile: # wall, ? unexplored, X visited
+// and empty, or the letter of what is still there (M T ! + B S)
+char map_glyph(const Map *map, int x, int y);
 
 char read_command(void);
-void search_room(Player *player, Position *pos, char *message, Map *map, BattleState *battle);
-void handle_command(char command, int *running, Position *pos, Player *player, char *message, Map *map, GameState *state, BattleState *battle);
-void handle_inventory_command(Player *player, char *message, GameState *state, char first_char);
+void search_room(Player *player, Position *pos, EventLog *log, Map *map, BattleState *battle);
+void handle_command(char command, int *running, Position *pos, Player *player, EventLog *log, Map *map, GameState *state, BattleState *battle);
+void handle_inventory_command(Player *player, EventLog *log, GameState *state, char first_char);
+void handle_inventory_line(Player *player, EventLog *log, GameState *state, const char *line);
 void print_map(const Position *pos);
 void print_explored_map(const Map *map, const Position *pos, int radius);
 
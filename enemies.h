@@ -1,13 +1,27 @@
 #ifndef ENEMIES_H
 #define ENEMIES_H
 
+#include "eventlog.h"
 #include "player.h"
 
-// Monster template definition - stores base stats and scaling info
+enum { MONSTER_NAME_LEN = 24 };
+
+// Monster difficulty levels (encounter buckets)
+typedef enum {
+    DIFFICULTY_EASY,
+    DIFFICULTY_MEDIUM,
+    DIFFICULTY_HARD,
+    DIFFICULTY_BOSS,
+    DIFFICULTY_COUNT  // Keep this last - number of buckets
+} MonsterDifficulty;
+
+// Monster template definition - stores base stats and scaling info.
+// Plain data (fixed-size name) so templates can live in the mmap'd game data blob.
 typedef struct {
-    const char *name;
+    char name[MONSTER_NAME_LEN];
     int level_offset_min;    // Minimum level offset from player (e.g., -2 means player_level - 2)
     int level_offset_max;    // Maximum level offset from player (e.g., +2 means player_level + 2)
+    int min_level;           // Level floor (bosses stay strong for low-level players)
     int base_hp;             // Base HP at level 1
     int hp_per_level;        // HP gained per level
     int base_attack;         // Base attack at level 1
@@ -17,6 +31,7 @@ typedef struct {
     int min_loot;
     int max_loot;
     int exp_reward_base;     // Base exp reward
+    int bucket_weight[DIFFICULTY_COUNT];  // Relative spawn weight in each difficulty bucket (0 = never)
 } MonsterTemplate;
 
 // Actual monster instance with generated stats
@@ -31,7 +46,36 @@ typedef struct {
     int exp_reward;
 } Monster;
 
-// Returns gold looted; mutates player->health and may add items
-int battle_monster(Player *player);
+// Roll one monster from a template: level within the template's offsets
+// from player_level (never below min_level), stats within +-20% of the
+// per-level formula.
+Monster monster_generate(const MonsterTemplate *template, int player_level);
+
+// Create a monster for an encounter of the given difficulty, scaled to the
+// player's level. The template is a constant-time weighted draw from the
+// difficulty bucket of the monster registry (game data).
+Monster monster_spawn(MonsterDifficulty difficulty, int player_level);
+
+// Battle state
+typedef struct {
+    Monster monster;
+    int monster_hp;
+    int is_active;
+} BattleState;
+
+/*
+ * Combat rules. One call is one round; outcomes go to `log` (may be NULL)
+ * and nothing is printed, so the same code runs in the terminal game and
+ * in batch simulations.
+ */
+void battle_start(BattleState *battle, Monster m);
+
+// Player attacks; the monster counterattacks if it survives. Returns 1
+// when the monster dies (gold, XP and loot are awarded, battle ends).
+int battle_attack(Player *player, BattleState *battle, EventLog *log);
+
+// Try to run (30%). Returns 1 on success; on failure the monster gets a
+// free hit.
+int battle_flee(Player *player, BattleState *battle, EventLog *log);
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,131 @@
+#include <stdio.h>
+#include "eventlog.h"
+#include "items.h"
+
+void eventlog_init(EventLog *log) {
+    log->head = 0;
+    log->turn = 0;
+}
+
+void eventlog_begin_turn(EventLog *log) {
+    log->turn++;
+}
+
+void eventlog_push(EventLog *log, EventType type, const char *subject, int a, int b, int c) {
+    if (!log) return;  // Caller does not want events
+    GameEvent *ev = &log->events[log->head & (EVENTLOG_CAPACITY - 1)];
+    ev->turn = log->turn;
+    ev->type = type;
+    ev->subject = subject;
+    ev->a = a;
+    ev->b = b;
+    ev->c = c;
+    log->head++;
+}
+
+int eventlog_count(const EventLog *log) {
+    return log->head < EVENTLOG_CAPACITY ? (int)log->head : EVENTLOG_CAPACITY;
+}
+
+const GameEvent *eventlog_get(const EventLog *log, int age) {
+    if (age < 0 || age >= eventlog_count(log)) {
+        return NULL;
+    }
+    return &log->events[(log->head - 1 - (uint32_t)age) & (EVENTLOG_CAPACITY - 1)];
+}
+
+int eventlog_format(const GameEvent *ev, char *buf, size_t len) {
+    const char *s = ev->subject;
+    switch (ev->type) {
+    case EV_NOTE:
+        return snprintf(buf, len, "%s", s);
+    case EV_BLOCKED:
+        return snprintf(buf, len, "Cannot go %s - there's a wall!", s);
+    case EV_BOSS_APPEARS:
+        return snprintf(buf, len, "*** BOSS LAIR! The %s appears! ***", s);
+    case EV_MONSTER_APPEARS:
+        return snprintf(buf, len, "⚔ A %s appears! Prepare for battle!", s);
+    case EV_SHRINE_HEAL:
+        return snprintf(buf, len, "✦ Found Ancient Shrine! Restored %d HP.", ev->a);
+    case EV_SHRINE_GOLD:
+        return snprintf(buf, len, "✦ Found Ancient Shrine! Received %d gold in offerings.", ev->a);
+    case EV_SHRINE_EXP:
+        return snprintf(buf, len, "✦ Found Ancient Shrine! Gained wisdom (+%d XP).", ev->a);
+    case EV_TREASURE:
+        if (ev->b) {
+            return snprintf(buf, len, "💰 Found treasure chest with %d gold and %s!", ev->a, item_name(ev->b));
+        }
+        return snprintf(buf, len, "💰 Found treasure chest with %d gold!", ev->a);
+    case EV_TRAP:
+        return snprintf(buf, len, "💥 Trap triggered! Took %d damage.", ev->a);
+    case EV_FOUNTAIN:
+        return snprintf(buf, len, "⛲ Found a healing fountain! Recovered %d HP.", ev->a);
+    case EV_GOLD_FOUND:
+        return snprintf(buf, len, "Found %d gold coins on the ground.", ev->a);
+    case EV_PLAYER_HIT:
+        return snprintf(buf, len, "You hit the %s for %d damage!", s, ev->a);
+    case EV_MONSTER_HIT:
+        return snprintf(buf, len, "The %s counters for %d damage!", s, ev->a);
+    case EV_VICTORY:
+        return snprintf(buf, len, "Victory! Defeated %s! Gained %d gold and %d XP.", s, ev->a, ev->b);
+    case EV_LOOT:
+        return snprintf(buf, len, "Also received %s!", item_name(ev->a));
+    case EV_INVENTORY_FULL:
+        return snprintf(buf, len, "Your inventory is full! Left %s behind.", item_name(ev->a));
+    case EV_LEVEL_UP:
+        return snprintf(buf, len, "*** LEVEL UP! You are now level %d! ***", ev->a);
+    case EV_FLED:
+        return snprintf(buf, len, "You successfully fled from the %s!", s);
+    case EV_FLEE_FAILED:
+        return snprintf(buf, len, "Failed to flee! The %s punishes you for %d damage!", s, ev->a);
+    case EV_ITEM_USED:
+        if (ev->c == 0) {
+            return snprintf(buf, len, "Used %s! Healed %d HP. %s depleted!",
+                            item_name(ev->a), ev->b, item_name(ev->a));
+        }
+        return snprintf(buf, len, "Used %s! Healed %d HP. (%d remaining)", item_name(ev->a), ev->b, ev->c);
+    case EV_EQUIPPED_WEAPON:
+        return snprintf(buf, len, "Equipped %s! Attack: %d (+%d dmg)", item_name(ev->a), ev->b, ev->c);
+    case EV_EQUIPPED_ARMOR:
+        return snprintf(buf, len, "Equipped %s! Defense: %d (+%d def)", item_name(ev->a), ev->b, ev->c);
+    case EV_UNEQUIPPED:
+        return snprintf(buf, len, "Unequipped %s.", item_name(ev->a));
+    case EV_ALREADY_EQUIPPED:
+        return snprintf(buf, len, "%s is already equipped!", item_name(ev->a));
+    case EV_CANNOT_EQUIP:
+        return snprintf(buf, len, "Cannot equip %s - not a weapon or armor!", item_name(ev->a));
+    case EV_CANNOT_USE:
+        return snprintf(buf, len, "Cannot use %s - not a consumable!", item_name(ev->a));
+    case EV_SLOT_EMPTY:
+        return snprintf(buf, len, "Slot %d is empty!", ev->a);
+    case EV_SLOT_MISSING:
+        return snprintf(buf, len, "Invalid slot number! Use: %c <slot>  (e.g., %c 1)", ev->a, ev->a);
+    case EV_BAD_COMMAND:
+        return snprintf(buf, len, "Invalid command '%c'! Use U <slot>, E <slot>, or Q to exit.", ev->a);
+    case EV_DATA_REJECTED:
+        return snprintf(buf, len, "Game data reload rejected: %s", s);
+    case EV_REWOUND:
+        if (ev->a == 0) return snprintf(buf, len, "Nothing to rewind - time will not bend any further.");
+        return snprintf(buf, len, "Time flows backwards... %d turn%s undone.", ev->a, ev->a == 1 ? "" : "s");
+    }
+    return snprintf(buf, len, "?");
+}
+
+int eventlog_format_turn(const EventLog *log, char *buf, size_t len) {
+    // Find the oldest event of the current turn, then write forwards
+    int first = -1;
+    for (int age = 0; age < eventlog_count(log); age++) {
+        if (eventlog_get(log, age)->turn != log->turn) break;
+        first = age;
+    }
+
+    size_t used = 0;
+    if (len > 0) buf[0] = '\0';
+    for (int age = first; age >= 0 && used + 1 < len; age--) {
+        if (used > 0) buf[used++] = ' ';
+        int n = eventlog_format(eventlog_get(log, age), buf + used, len - used);
+        if (n < 0) break;
+        used += (size_t)n < len - used ? (size_t)n : len - used - 1;
+    }
+    return first + 1;
+}
@@ -0,0 +1,96 @@
+#ifndef EVENTLOG_H
+#define EVENTLOG_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Event log - fixed-capacity ring buffer of typed game events.
+ *
+ * Game logic records what happened as a small record (event type, an
+ * optional name and up to three numbers). Nothing is turned into text
+ * until the UI asks for the lines it is about to draw, so headless runs
+ * never format anything. Older events stay available as scrollback until
+ * the ring wraps.
+ *
+ * The log is also the event sink for the game rules (player, combat, room
+ * events): they report through it instead of printing. A NULL log is
+ * accepted everywhere and simply drops the events.
+ */
+
+enum { EVENTLOG_CAPACITY = 128 };  // Power of two
+
+typedef enum {
+    EV_NOTE,              // Fixed text: subject
+    EV_BLOCKED,           // Wall in direction `subject`
+    EV_BOSS_APPEARS,      // subject = monster
+    EV_MONSTER_APPEARS,   // subject = monster
+    EV_SHRINE_HEAL,       // a = HP restored
+    EV_SHRINE_GOLD,       // a = gold
+    EV_SHRINE_EXP,        // a = XP
+    EV_TREASURE,          // a = gold, b = item id (0 = no item)
+    EV_TRAP,              // a = damage taken
+    EV_FOUNTAIN,          // a = HP restored
+    EV_GOLD_FOUND,        // a = gold
+    EV_PLAYER_HIT,        // subject = monster, a = damage dealt
+    EV_MONSTER_HIT,       // subject = monster, a = damage taken
+    EV_VICTORY,           // subject = monster, a = gold, b = XP
+    EV_LOOT,              // a = item id
+    EV_INVENTORY_FULL,    // a = item id that did not fit
+    EV_LEVEL_UP,          // a = new level
+    EV_FLED,              // subject = monster
+    EV_FLEE_FAILED,       // subject = monster, a = damage taken
+    EV_ITEM_USED,         // a = item id, b = HP healed, c = quantity left
+    EV_EQUIPPED_WEAPON,   // a = item id, b = total damage, c = item damage
+    EV_EQUIPPED_ARMOR,    // a = item id, b = total defense, c = item defense
+    EV_UNEQUIPPED,        // a = item id
+    EV_ALREADY_EQUIPPED,  // a = item id
+    EV_CANNOT_EQUIP,      // a = item id
+    EV_CANNOT_USE,        // a = item id
+    EV_SLOT_EMPTY,        // a = slot
+    EV_SLOT_MISSING,      // a = command letter
+    EV_BAD_COMMAND,       // a = command letter (inventory screen)
+    EV_DATA_REJECTED,     // subject = loader error text
+    EV_REWOUND            // a = turns undone (0 = nothing to undo)
+} EventType;
+
+typedef struct {
+    uint32_t turn;        // Turn the event happened in
+    EventType type;
+    const char *subject;  // Static text or a name that outlives the log
+    int a, b, c;
+} GameEvent;
+
+typedef struct {
+    GameEvent events[EVENTLOG_CAPACITY];
+    uint32_t head;  // Total events ever pushed; next write is head % capacity
+    uint32_t turn;
+} EventLog;
+
+void eventlog_init(EventLog *log);
+
+// Start a new turn; the message panel shows the events of the current turn
+void eventlog_begin_turn(EventLog *log);
+
+void eventlog_push(EventLog *log, EventType type, const char *subject, int a, int b, int c);
+
+// Shorthand for an EV_NOTE with fixed text
+static inline void eventlog_note(EventLog *log, const char *text) {
+    eventlog_push(log, EV_NOTE, text, 0, 0, 0);
+}
+
+// Number of events still held (at most EVENTLOG_CAPACITY)
+int eventlog_count(const EventLog *log);
+
+// Event by age: 0 is the newest. NULL if it has been overwritten.
+const GameEvent *eventlog_get(const EventLog *log, int age);
+
+// Format one event as a line of text. Returns the length snprintf would
+// have written, like snprintf.
+int eventlog_format(const GameEvent *ev, char *buf, size_t len);
+
+// Format every event of the current turn into one space-separated line
+// (truncated to fit). Returns the number of events written.
+int eventlog_format_turn(const EventLog *log, char *buf, size_t len);
+
+#endif
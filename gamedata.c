@@ -0,0 +1,440 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+#include "gamedata.h"
+
+// Currently active image plus the path/watch used for hot reload. Worker
+// threads read `current` while a reload replaces it: it is published with
+// release and read with acquire, so a reader that sees a new image also
+// sees its alias tables fully built.
+static _Atomic(GameData *) current = NULL;
+static _Thread_local const GameData *pinned;  // This thread's command's image (NULL = current)
+static char data_path[256];
+static int watch_fd = -1;
+
+static const size_t record_sizes[GD_SECTION_COUNT] = {
+    sizeof(MonsterTemplate),
+    sizeof(ItemDef),
+    sizeof(LootTableDef),
+    sizeof(LootEntryDef),
+};
+
+/**
+ * FNV-1a hash used as the blob checksum
+ */
+uint32_t gamedata_checksum(const void *data, size_t len) {
+    const unsigned char *p = data;
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        h ^= p[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+// Names are fixed-size fields; make sure each one is terminated
+static int name_ok(const char *name) {
+    return memchr(name, '\0', GAMEDATA_NAME_LEN) != NULL && name[0] != '\0';
+}
+
+// Nesting depth below a loot table; stops counting once past the limit so
+// a table that (indirectly) contains itself cannot recurse forever
+static int loot_depth(const GameData *gd, int table, int depth) {
+    if (depth > LOOT_MAX_DEPTH) return depth;
+    const LootTableDef *t = &gd->loot_tables[table];
+    int deepest = depth;
+    for (int i = 0; i < t->entry_count; i++) {
+        const LootEntryDef *e = &gd->loot_entries[t->first_entry + i];
+        if (e->kind != LOOT_TABLE) continue;
+        int d = loot_depth(gd, e->target, depth + 1);
+        if (d > deepest) deepest = d;
+        if (deepest > LOOT_MAX_DEPTH) break;
+    }
+    return deepest;
+}
+
+/**
+ * Check a blob and fill `out` with typed pointers into it.
+ * Nothing in the blob is trusted: every offset, count and cross reference
+ * is checked so a half-written or hand-edited file cannot crash the game.
+ */
+int gamedata_validate(const void *blob, size_t size, GameData *out, char *err, size_t errlen) {
+    const GameDataHeader *hdr = blob;
+    const unsigned char *bytes = blob;
+
+    if (size < sizeof(GameDataHeader)) {
+        snprintf(err, errlen, "file too small (%zu bytes)", size);
+        return -1;
+    }
+    if (hdr->magic != GAMEDATA_MAGIC) {
+        snprintf(err, errlen, "bad magic 0x%08x", (unsigned)hdr->magic);
+        return -1;
+    }
+    if (hdr->version != GAMEDATA_VERSION) {
+        snprintf(err, errlen, "version %u, expected %d", (unsigned)hdr->version, GAMEDATA_VERSION);
+        return -1;
+    }
+    if (hdr->size != size) {
+        snprintf(err, errlen, "size mismatch (header %u, file %zu)", (unsigned)hdr->size, size);
+        return -1;
+    }
+    if (gamedata_checksum(bytes + sizeof(*hdr), size - sizeof(*hdr)) != hdr->checksum) {
+        snprintf(err, errlen, "checksum mismatch");
+        return -1;
+    }
+
+    for (int s = 0; s < GD_SECTION_COUNT; s++) {
+        const GameDataSectionInfo *sec = &hdr->sections[s];
+        if (sec->offset % sizeof(int) != 0 || sec->offset > size ||
+            sec->count > (size - sec->offset) / record_sizes[s]) {
+            snprintf(err, errlen, "section %d out of bounds", s);
+            return -1;
+        }
+    }
+
+    memset(out, 0, sizeof(*out));
+    out->base = blob;
+    out->size = size;
+    out->monsters         = (const void *)(bytes + hdr->sections[GD_SECTION_MONSTERS].offset);
+    out->monster_count    = (int)hdr->sections[GD_SECTION_MONSTERS].count;
+    out->items            = (const void *)(bytes + hdr->sections[GD_SECTION_ITEMS].offset);
+    out->item_count       = (int)hdr->sections[GD_SECTION_ITEMS].count;
+    out->loot_tables      = (const void *)(bytes + hdr->sections[GD_SECTION_LOOT_TABLES].offset);
+    out->loot_table_count = (int)hdr->sections[GD_SECTION_LOOT_TABLES].count;
+    out->loot_entries     = (const void *)(bytes + hdr->sections[GD_SECTION_LOOT_ENTRIES].offset);
+    out->loot_entry_count = (int)hdr->sections[GD_SECTION_LOOT_ENTRIES].count;
+
+    if (out->monster_count == 0) {
+        snprintf(err, errlen, "no monster templates");
+        return -1;
+    }
+    // Totals are summed in 64 bits so hand-edited weights cannot overflow
+    int64_t bucket_total[DIFFICULTY_COUNT] = {0};
+    for (int i = 0; i < out->monster_count; i++) {
+        const MonsterTemplate *t = &out->monsters[i];
+        if (!name_ok(t->name) || t->level_offset_min > t->level_offset_max ||
+            t->min_level < 1 || t->min_loot > t->max_loot) {
+            snprintf(err, errlen, "bad monster template %d", i);
+            return -1;
+        }
+        for (int d = 0; d < DIFFICULTY_COUNT; d++) {
+            if (t->bucket_weight[d] < 0) {
+                snprintf(err, errlen, "negative bucket weight for %s", t->name);
+                return -1;
+            }
+            bucket_total[d] += t->bucket_weight[d];
+        }
+    }
+    for (int d = 0; d < DIFFICULTY_COUNT; d++) {
+        if (bucket_total[d] == 0) {
+            snprintf(err, errlen, "no monsters in difficulty bucket %d", d);
+            return -1;
+        }
+        if (bucket_total[d] > GAMEDATA_MAX_WEIGHT) {
+            snprintf(err, errlen, "difficulty bucket %d weighs more than %d", d, GAMEDATA_MAX_WEIGHT);
+            return -1;
+        }
+    }
+
+    for (int i = 0; i < out->item_count; i++) {
+        const ItemDef *it = &out->items[i];
+        if (!name_ok(it->name) || it->type < ITEM_CONSUMABLE || it->type > ITEM_MISC ||
+            (i > 0 && out->items[i - 1].id >= it->id)) {
+            snprintf(err, errlen, "bad item %d (items must be sorted by unique id)", i);
+            return -1;
+        }
+        if (it->id < 1 || it->id > GAMEDATA_MAX_ITEM_ID) {
+            snprintf(err, errlen, "item %s has id %d (must be 1-%d)", it->name, it->id, GAMEDATA_MAX_ITEM_ID);
+            return -1;
+        }
+    }
+
+    for (int t = 0; t < out->loot_table_count; t++) {
+        const LootTableDef *table = &out->loot_tables[t];
+        if (!name_ok(table->name) || table->entry_count < 1 || table->first_entry < 0 ||
+            table->first_entry > out->loot_entry_count - table->entry_count) {
+            snprintf(err, errlen, "bad loot table %d", t);
+            return -1;
+        }
+        int64_t total = 0;
+        for (int i = 0; i < table->entry_count; i++) {
+            const LootEntryDef *e = &out->loot_entries[table->first_entry + i];
+            int target_ok =
+                e->kind == LOOT_NOTHING ||
+                (e->kind == LOOT_ITEM && e->target >= 1 && e->target <= GAMEDATA_MAX_ITEM_ID &&
+                 gamedata_find_item(out, e->target)) ||
+                (e->kind == LOOT_TABLE && e->target >= 0 && e->target < out->loot_table_count);
+            if (e->weight < 0 || !target_ok || e->damage_range < 0 || e->defense_range < 0 ||
+                e->value_range < 0 || e->quality_damage_div < 0 || e->quality_defense_div < 0) {
+                snprintf(err, errlen, "bad entry %d in loot table %s", i, table->name);
+                return -1;
+            }
+            total += e->weight;
+        }
+        if (total <= 0) {
+            snprintf(err, errlen, "loot table %s has no weight", table->name);
+            return -1;
+        }
+        if (total > GAMEDATA_MAX_WEIGHT) {
+            snprintf(err, errlen, "loot table %s weighs more than %d", table->name, GAMEDATA_MAX_WEIGHT);
+            return -1;
+        }
+        if (loot_depth(out, t, 0) > LOOT_MAX_DEPTH) {
+            snprintf(err, errlen, "loot table %s nests too deep (or loops)", table->name);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+static void gamedata_free_lookups(GameData *gd) {
+    for (int d = 0; d < DIFFICULTY_COUNT; d++) {
+        alias_free(&gd->monster_buckets[d]);
+    }
+    if (gd->loot_alias) {
+        for (int t = 0; t < gd->loot_table_count; t++) {
+            alias_free(&gd->loot_alias[t]);
+        }
+        free(gd->loot_alias);
+        gd->loot_alias = NULL;
+    }
+}
+
+// Build the alias tables that make spawn and loot draws constant time
+static int gamedata_build_lookups(GameData *gd, char *err, size_t errlen) {
+    int n = gd->monster_count > gd->loot_entry_count ? gd->monster_count : gd->loot_entry_count;
+    int *weights = malloc(sizeof(int) * (size_t)n);
+    gd->loot_alias = calloc((size_t)gd->loot_table_count + 1, sizeof(AliasTable));
+    if (!weights || !gd->loot_alias) {
+        free(weights);
+        snprintf(err, errlen, "out of memory");
+        return -1;
+    }
+    for (int d = 0; d < DIFFICULTY_COUNT; d++) {
+        for (int i = 0; i < gd->monster_count; i++) {
+            weights[i] = gd->monsters[i].bucket_weight[d];
+        }
+        if (alias_build(&gd->monster_buckets[d], weights, gd->monster_count) != 0) {
+            snprintf(err, errlen, "cannot build spawn table for difficulty %d", d);
+            free(weights);
+            return -1;
+        }
+    }
+    for (int t = 0; t < gd->loot_table_count; t++) {
+        const LootTableDef *table = &gd->loot_tables[t];
+        for (int i = 0; i < table->entry_count; i++) {
+            weights[i] = gd->loot_entries[table->first_entry + i].weight;
+        }
+        if (alias_build(&gd->loot_alias[t], weights, table->entry_count) != 0) {
+            snprintf(err, errlen, "cannot build loot table %s", table->name);
+            free(weights);
+            return -1;
+        }
+    }
+    free(weights);
+    return 0;
+}
+
+// Map a blob file read-only and validate it
+static GameData *gamedata_map(const char *path, char *err, size_t errlen) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        snprintf(err, errlen, "%s: %s", path, strerror(errno));
+        return NULL;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        snprintf(err, errlen, "%s: cannot stat or empty", path);
+        close(fd);
+        return NULL;
+    }
+
+    size_t size = (size_t)st.st_size;
+    void *blob = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (blob == MAP_FAILED) {
+        snprintf(err, errlen, "%s: mmap failed: %s", path, strerror(errno));
+        return NULL;
+    }
+
+    GameData *gd = calloc(1, sizeof(*gd));
+    if (!gd) {
+        snprintf(err, errlen, "out of memory");
+        munmap(blob, size);
+        return NULL;
+    }
+
+    if (gamedata_validate(blob, size, gd, err, errlen) != 0 || gamedata_build_lookups(gd, err, errlen) != 0) {
+        gamedata_free_lookups(gd);
+        free(gd);
+        munmap(blob, size);
+        return NULL;
+    }
+    return gd;
+}
+
+static void gamedata_free_chain(GameData *gd) {
+    while (gd) {
+        GameData *next = gd->retired_next;
+        gamedata_free_lookups(gd);
+        munmap((void *)gd->base, gd->size);
+        free(gd);
+        gd = next;
+    }
+}
+
+// Start watching the directory holding the blob. Editors and the compiler
+// replace the file by rename, so watching the file's inode would miss it.
+static void gamedata_watch(const char *path) {
+#ifdef __linux__
+    char dir[sizeof(data_path)];
+    snprintf(dir, sizeof(dir), "%s", path);
+    char *slash = strrchr(dir, '/');
+    if (slash) {
+        *slash = '\0';
+        if (dir[0] == '\0') strcpy(dir, "/");
+    } else {
+        strcpy(dir, ".");
+    }
+
+    watch_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (watch_fd < 0) return;
+    if (inotify_add_watch(watch_fd, dir, IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+        close(watch_fd);
+        watch_fd = -1;
+    }
+#else
+    (void)path;
+#endif
+}
+
+/**
+ * Map the game data blob and start watching it for changes.
+ * Returns 0 on success, -1 on error (err describes the problem).
+ */
+int gamedata_init(const char *path, char *err, size_t errlen) {
+    if (!path) path = GAMEDATA_DEFAULT_PATH;
+    snprintf(data_path, sizeof(data_path), "%s", path);
+
+    GameData *gd = gamedata_map(data_path, err, errlen);
+    if (!gd) return -1;
+    atomic_store_explicit(&current, gd, memory_order_release);
+
+    gamedata_watch(data_path);
+    return 0;
+}
+
+/**
+ * Check for a changed blob and swap it in. Only one thread may poll. The
+ * terminal game polls between turns; threads running turns while it swaps
+ * (server workers) pin the image their turn started with, so no turn sees
+ * a mix of old and new definitions. The previous image stays mapped
+ * because monsters and items already handed out, and pinned turns, still
+ * point into it.
+ * Returns 1 if a new table is active, 0 if nothing changed, -1 if a change
+ * was seen but the new file was rejected (the old table stays active).
+ */
+int gamedata_poll_reload(char *err, size_t errlen) {
+#ifdef __linux__
+    if (watch_fd < 0) return 0;
+
+    const char *base = strrchr(data_path, '/');
+    base = base ? base + 1 : data_path;
+
+    char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    int changed = 0;
+    ssize_t len;
+    while ((len = read(watch_fd, buf, sizeof(buf))) > 0) {
+        for (char *p = buf; p < buf + len; ) {
+            const struct inotify_event *ev = (const struct inotify_event *)p;
+            if (ev->len > 0 && strcmp(ev->name, base) == 0) changed = 1;
+            p += sizeof(struct inotify_event) + ev->len;
+        }
+    }
+    if (!changed) return 0;
+
+    GameData *fresh = gamedata_map(data_path, err, errlen);
+    if (!fresh) return -1;
+
+    fresh->retired_next = atomic_load_explicit(&current, memory_order_relaxed);
+    atomic_store_explicit(&current, fresh, memory_order_release);
+    return 1;
+#else
+    (void)err;
+    (void)errlen;
+    return 0;
+#endif
+}
+
+/**
+ * The inotify descriptor gamedata_poll_reload() reads, for an event loop
+ * to wait on (-1 if the blob is not being watched)
+ */
+int gamedata_watch_fd(void) {
+    return watch_fd;
+}
+
+/**
+ * Unmap every image (current and retired) and stop watching
+ */
+void gamedata_shutdown(void) {
+    gamedata_free_chain(atomic_exchange(&current, NULL));
+    if (watch_fd >= 0) {
+        close(watch_fd);
+        watch_fd = -1;
+    }
+}
+
+/**
+ * Currently active game data (NULL before gamedata_init succeeds), or the
+ * image this thread has pinned
+ */
+const GameData *gamedata(void) {
+    if (pinned) return pinned;
+    return atomic_load_explicit(&current, memory_order_acquire);
+}
+
+void gamedata_pin(void) {
+    pinned = atomic_load_explicit(&current, memory_order_acquire);
+}
+
+void gamedata_unpin(void) {
+    pinned = NULL;
+}
+
+/**
+ * Find an item definition by id (items are sorted, so binary search)
+ */
+const ItemDef *gamedata_find_item(const GameData *gd, int id) {
+    int lo = 0, hi = gd->item_count - 1;
+    while (lo <= hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (gd->items[mid].id == id) return &gd->items[mid];
+        if (gd->items[mid].id < id) lo = mid + 1;
+        else hi = mid - 1;
+    }
+    return NULL;
+}
+
+/**
+ * Find a loot table by name; returns its index or -1
+ */
+int gamedata_find_loot_table(const GameData *gd, const char *name) {
+    for (int i = 0; i < gd->loot_table_count; i++) {
+        if (strcmp(gd->loot_tables[i].name, name) == 0) return i;
+    }
+    return -1;
+}
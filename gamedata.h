@@ -0,0 +1,124 @@
+#ifndef GAMEDATA_H
+#define GAMEDATA_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "alias.h"
+#include "dungeon.h"
+
+/*
+ * Game data blob - monster and loot definitions compiled from gamedata.txt
+ * by the gamedata_compile tool into a flat binary that is mmap'd at startup.
+ *
+ * Layout: GameDataHeader followed by fixed-size record arrays. Every record
+ * is plain data (no pointers) so the file can be used in place. Derived
+ * lookup structures (alias tables) are built at load time and live with
+ * the image, so a hot reload swaps them together with the data.
+ */
+
+#define GAMEDATA_MAGIC   0x44474D41u  // "AMGD"
+#define GAMEDATA_VERSION 3
+#define GAMEDATA_DEFAULT_PATH "gamedata.bin"
+#define GAMEDATA_NAME_LEN 24
+#define LOOT_MAX_DEPTH 8  // Deepest allowed nesting of loot tables
+#define GAMEDATA_MAX_WEIGHT INT32_MAX  // Largest weight total of a spawn bucket or loot table
+#define GAMEDATA_MAX_ITEM_ID UINT16_MAX  // Item ids are 1..this (InventoryEntry.item_id; 0 = no item)
+
+typedef enum {
+    GD_SECTION_MONSTERS,     // MonsterTemplate[] (the monster registry)
+    GD_SECTION_ITEMS,        // ItemDef[], sorted by id
+    GD_SECTION_LOOT_TABLES,  // LootTableDef[]
+    GD_SECTION_LOOT_ENTRIES, // LootEntryDef[], grouped by table
+    GD_SECTION_COUNT
+} GameDataSection;
+
+typedef struct {
+    uint32_t offset;  // Byte offset from start of blob
+    uint32_t count;   // Number of records
+} GameDataSectionInfo;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t size;      // Total blob size in bytes
+    uint32_t checksum;  // FNV-1a of everything after the header
+    GameDataSectionInfo sections[GD_SECTION_COUNT];
+} GameDataHeader;
+
+// Item definition - base stats for everything that can end up in an inventory
+typedef struct {
+    int id;
+    int type;            // ItemType
+    char name[GAMEDATA_NAME_LEN];
+    int damage;
+    int defense;
+    int value;
+    int value_per_stat;  // Added to value for every rolled stat point
+} ItemDef;
+
+// What a loot entry yields when it is drawn
+typedef enum {
+    LOOT_NOTHING,  // No drop
+    LOOT_ITEM,     // target = item id
+    LOOT_TABLE     // target = index of a nested loot table
+} LootKind;
+
+// Named loot table: a weighted set of entries, compiled to an alias table
+typedef struct {
+    char name[GAMEDATA_NAME_LEN];
+    int first_entry;  // Index into the loot entry section
+    int entry_count;
+} LootTableDef;
+
+// One weighted entry in a loot table. Stat rolls on LOOT_TABLE entries are
+// inherited by whatever the nested table yields (they add up along the path).
+typedef struct {
+    int weight;
+    int kind;                 // LootKind
+    int target;               // Item id or table index (see LootKind)
+    int damage_min;
+    int damage_range;         // Rolled damage = damage_min + rand() % damage_range
+    int defense_min;
+    int defense_range;
+    int value_range;          // Extra value = rand() % value_range
+    int quality_damage_div;   // Extra damage = quality / div (0 = none)
+    int quality_defense_div;  // Extra defense = quality / div (0 = none)
+} LootEntryDef;
+
+// A loaded (mapped) game data image
+typedef struct GameData {
+    const void *base;
+    size_t size;
+    const MonsterTemplate *monsters;
+    int monster_count;
+    AliasTable monster_buckets[DIFFICULTY_COUNT];  // Template index per difficulty
+    const ItemDef *items;
+    int item_count;
+    const LootTableDef *loot_tables;
+    int loot_table_count;
+    const LootEntryDef *loot_entries;
+    int loot_entry_count;
+    AliasTable *loot_alias;  // One per loot table, over its entries
+    struct GameData *retired_next;  // Older images kept alive after a reload
+} GameData;
+
+// Loading and hot reload (returns 0 on success, -1 on error with err filled)
+int gamedata_init(const char *path, char *err, size_t errlen);
+int gamedata_poll_reload(char *err, size_t errlen);  // 1 if a new table was swapped in
+int gamedata_watch_fd(void);  // Readable when the blob may have changed (-1 = not watched)
+void gamedata_shutdown(void);
+const GameData *gamedata(void);
+
+// Keep this thread on the active image: gamedata() returns it, even across
+// a reload by another thread, until gamedata_unpin(). A server command pins
+// it so one turn never mixes two tables.
+void gamedata_pin(void);
+void gamedata_unpin(void);
+
+// Validation and lookup helpers
+int gamedata_validate(const void *blob, size_t size, GameData *out, char *err, size_t errlen);
+uint32_t gamedata_checksum(const void *data, size_t len);
+const ItemDef *gamedata_find_item(const GameData *gd, int id);
+int gamedata_find_loot_table(const GameData *gd, const char *name);  // Index or -1
+
+#endif
@@ -0,0 +1,275 @@
+/**
+ * gamedata_compile.c - Compile gamedata.txt into the flat gamedata.bin blob
+ *
+ * Usage: gamedata_compile <source.txt> <output.bin>
+ *
+ * The output is written to a temporary file and renamed into place, so a
+ * running game watching the blob only ever sees a complete file.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "gamedata.h"
+
+enum { MAX_RECORDS = 256, MAX_TOKENS = 20 };
+
+static MonsterTemplate monsters[MAX_RECORDS];
+static ItemDef items[MAX_RECORDS];
+static LootTableDef tables[MAX_RECORDS];
+static LootEntryDef entries[MAX_RECORDS];
+static int entry_table[MAX_RECORDS];                     // Owning table of each parsed entry
+static char entry_target[MAX_RECORDS][GAMEDATA_NAME_LEN]; // Nested table name, resolved after parsing
+static int entry_line[MAX_RECORDS];
+static int monster_count, item_count, table_count, entry_count;
+
+static const char *src_path;
+static int line_no;
+
+static void fail(const char *msg, const char *detail) {
+    fprintf(stderr, "%s:%d: %s%s%s\n", src_path, line_no, msg,
+            detail ? ": " : "", detail ? detail : "");
+    exit(1);
+}
+
+// Split a line into tokens; "quoted strings" may contain spaces
+static int tokenize(char *line, char **tok) {
+    int n = 0;
+    char *p = line;
+    while (*p) {
+        while (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n') p++;
+        if (*p == '\0' || *p == '#') break;
+        if (n == MAX_TOKENS) fail("too many fields", NULL);
+        if (*p == '"') {
+            tok[n++] = ++p;
+            while (*p && *p != '"') p++;
+            if (*p != '"') fail("unterminated string", NULL);
+            *p++ = '\0';
+        } else {
+            tok[n++] = p;
+            while (*p && *p != ' ' && *p != '\t' && *p != '\r' && *p != '\n') p++;
+            if (*p) *p++ = '\0';
+        }
+    }
+    return n;
+}
+
+static int to_int(const char *s) {
+    char *end;
+    long v = strtol(s, &end, 10);
+    if (*s == '\0' || *end != '\0') fail("expected a number", s);
+    return (int)v;
+}
+
+static void copy_name(char *dst, const char *src) {
+    if (strlen(src) >= GAMEDATA_NAME_LEN) fail("name too long", src);
+    strcpy(dst, src);
+}
+
+static int parse_item_type(const char *s) {
+    if (strcmp(s, "consumable") == 0) return ITEM_CONSUMABLE;
+    if (strcmp(s, "weapon") == 0)     return ITEM_WEAPON;
+    if (strcmp(s, "armor") == 0)      return ITEM_ARMOR;
+    if (strcmp(s, "misc") == 0)       return ITEM_MISC;
+    fail("unknown item type", s);
+    return 0;
+}
+
+static int find_table(const char *name) {
+    for (int i = 0; i < table_count; i++) {
+        if (strcmp(tables[i].name, name) == 0) return i;
+    }
+    return -1;
+}
+
+static void expect_fields(int n, int want, const char *kind) {
+    if (n != want) fail("wrong number of fields for", kind);
+    if (monster_count == MAX_RECORDS || item_count == MAX_RECORDS ||
+        table_count == MAX_RECORDS || entry_count == MAX_RECORDS) {
+        fail("too many records", NULL);
+    }
+}
+
+static void parse_line(char **tok, int n) {
+    if (strcmp(tok[0], "monster") == 0) {
+        expect_fields(n, 18, "monster");
+        MonsterTemplate *t = &monsters[monster_count++];
+        copy_name(t->name, tok[1]);
+        t->level_offset_min  = to_int(tok[2]);
+        t->level_offset_max  = to_int(tok[3]);
+        t->min_level         = to_int(tok[4]);
+        t->base_hp           = to_int(tok[5]);
+        t->hp_per_level      = to_int(tok[6]);
+        t->base_attack       = to_int(tok[7]);
+        t->attack_per_level  = to_int(tok[8]);
+        t->base_defense      = to_int(tok[9]);
+        t->defense_per_level = to_int(tok[10]);
+        t->min_loot          = to_int(tok[11]);
+        t->max_loot          = to_int(tok[12]);
+        t->exp_reward_base   = to_int(tok[13]);
+        for (int d = 0; d < DIFFICULTY_COUNT; d++) {
+            t->bucket_weight[d] = to_int(tok[14 + d]);
+        }
+    } else if (strcmp(tok[0], "item") == 0) {
+        expect_fields(n, 8, "item");
+        ItemDef *it = &items[item_count++];
+        it->id             = to_int(tok[1]);
+        it->type           = parse_item_type(tok[2]);
+        copy_name(it->name, tok[3]);
+        it->damage         = to_int(tok[4]);
+        it->defense        = to_int(tok[5]);
+        it->value          = to_int(tok[6]);
+        it->value_per_stat = to_int(tok[7]);
+    } else if (strcmp(tok[0], "loottable") == 0) {
+        expect_fields(n, 2, "loottable");
+        if (find_table(tok[1]) >= 0) fail("duplicate loot table", tok[1]);
+        copy_name(tables[table_count++].name, tok[1]);
+    } else if (strcmp(tok[0], "loot") == 0) {
+        expect_fields(n, 12, "loot");
+        int table = find_table(tok[1]);
+        if (table < 0) fail("loot entry for undeclared table", tok[1]);
+        entry_table[entry_count] = table;
+        entry_line[entry_count] = line_no;
+        LootEntryDef *e = &entries[entry_count];
+        e->weight = to_int(tok[2]);
+        if (strcmp(tok[3], "nothing") == 0) {
+            e->kind = LOOT_NOTHING;  // Target is a "-" placeholder
+        } else if (strcmp(tok[3], "item") == 0) {
+            e->kind = LOOT_ITEM;
+            e->target = to_int(tok[4]);
+        } else if (strcmp(tok[3], "table") == 0) {
+            e->kind = LOOT_TABLE;
+            copy_name(entry_target[entry_count], tok[4]);  // May be declared later
+        } else {
+            fail("unknown loot kind", tok[3]);
+        }
+        e->damage_min          = to_int(tok[5]);
+        e->damage_range        = to_int(tok[6]);
+        e->defense_min         = to_int(tok[7]);
+        e->defense_range       = to_int(tok[8]);
+        e->value_range         = to_int(tok[9]);
+        e->quality_damage_div  = to_int(tok[10]);
+        e->quality_defense_div = to_int(tok[11]);
+        entry_count++;
+    } else {
+        fail("unknown record type", tok[0]);
+    }
+}
+
+static int compare_items(const void *a, const void *b) {
+    const ItemDef *x = a, *y = b;
+    return (x->id > y->id) - (x->id < y->id);
+}
+
+// Append a section to the blob being built and record it in the header
+static size_t add_section(unsigned char *blob, size_t pos, GameDataHeader *hdr,
+                          GameDataSection s, const void *records, int count, size_t rec_size) {
+    hdr->sections[s].offset = (uint32_t)pos;
+    hdr->sections[s].count = (uint32_t)count;
+    memcpy(blob + pos, records, (size_t)count * rec_size);
+    return pos + (size_t)count * rec_size;
+}
+
+int main(int argc, char **argv) {
+    if (argc != 3) {
+        fprintf(stderr, "usage: %s <source.txt> <output.bin>\n", argv[0]);
+        return 2;
+    }
+    src_path = argv[1];
+
+    FILE *in = fopen(src_path, "r");
+    if (!in) {
+        perror(src_path);
+        return 1;
+    }
+    char line[512];
+    char *tok[MAX_TOKENS];
+    while (fgets(line, sizeof(line), in)) {
+        line_no++;
+        int n = tokenize(line, tok);
+        if (n > 0) parse_line(tok, n);
+    }
+    fclose(in);
+
+    // Resolve nested table references now that every table is declared
+    for (int i = 0; i < entry_count; i++) {
+        if (entries[i].kind != LOOT_TABLE) continue;
+        line_no = entry_line[i];
+        entries[i].target = find_table(entry_target[i]);
+        if (entries[i].target < 0) fail("unknown nested loot table", entry_target[i]);
+    }
+
+    // Group loot entries by table so each table is one contiguous run
+    static LootEntryDef grouped[MAX_RECORDS];
+    int pos = 0;
+    for (int t = 0; t < table_count; t++) {
+        tables[t].first_entry = pos;
+        for (int i = 0; i < entry_count; i++) {
+            if (entry_table[i] == t) grouped[pos++] = entries[i];
+        }
+        tables[t].entry_count = pos - tables[t].first_entry;
+    }
+    qsort(items, (size_t)item_count, sizeof(items[0]), compare_items);
+
+    size_t size = sizeof(GameDataHeader)
+                + (size_t)monster_count * sizeof(MonsterTemplate)
+                + (size_t)item_count * sizeof(ItemDef)
+                + (size_t)table_count * sizeof(LootTableDef)
+                + (size_t)entry_count * sizeof(LootEntryDef);
+    unsigned char *blob = calloc(1, size);
+    if (!blob) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    GameDataHeader hdr = {0};
+    hdr.magic = GAMEDATA_MAGIC;
+    hdr.version = GAMEDATA_VERSION;
+    hdr.size = (uint32_t)size;
+
+    size_t off = sizeof(GameDataHeader);
+    off = add_section(blob, off, &hdr, GD_SECTION_MONSTERS, monsters, monster_count, sizeof(MonsterTemplate));
+    off = add_section(blob, off, &hdr, GD_SECTION_ITEMS, items, item_count, sizeof(ItemDef));
+    off = add_section(blob, off, &hdr, GD_SECTION_LOOT_TABLES, tables, table_count, sizeof(LootTableDef));
+    add_section(blob, off, &hdr, GD_SECTION_LOOT_ENTRIES, grouped, entry_count, sizeof(LootEntryDef));
+
+    hdr.checksum = gamedata_checksum(blob + sizeof(hdr), size - sizeof(hdr));
+    memcpy(blob, &hdr, sizeof(hdr));
+
+    // Run the same checks the game will run before we publish the file
+    GameData check;
+    char err[256];
+    line_no = 0;
+    if (gamedata_validate(blob, size, &check, err, sizeof(err)) != 0) {
+        fprintf(stderr, "%s: invalid data: %s\n", src_path, err);
+        return 1;
+    }
+
+    char tmp_path[512];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", argv[2]);
+    FILE *out = fopen(tmp_path, "wb");
+    if (!out) {
+        perror(tmp_path);
+        return 1;
+    }
+    if (fwrite(blob, 1, size, out) != size || fflush(out) != 0 || fsync(fileno(out)) != 0) {
+        perror(tmp_path);
+        fclose(out);
+        unlink(tmp_path);
+        return 1;
+    }
+    fclose(out);
+    if (rename(tmp_path, argv[2]) != 0) {
+        perror(argv[2]);
+        unlink(tmp_path);
+        return 1;
+    }
+
+    printf("%s: %d monsters, %d items, %d loot tables (%zu bytes)\n",
+           argv[2], monster_count, item_count, table_count, size);
+    free(blob);
+    return 0;
+}
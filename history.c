@@ -0,0 +1,147 @@
+#include <string.h>
+#include "history.h"
+
+static TurnRecord *turn_at(History *h, uint32_t n) {
+    return &h->turns[n % HISTORY_TURNS];
+}
+
+static ChunkImage *image_at(History *h, uint32_t n) {
+    return &h->images[n % HISTORY_IMAGES];
+}
+
+// Stop recording into the open turn and forget which chunks it imaged
+static void close_turn(History *h) {
+    if (!h->recording) return;
+    for (uint32_t n = turn_at(h, h->turn_head - 1)->first_image; n != h->image_head; n++) {
+        uint32_t chunk = image_at(h, n)->chunk;
+        h->touched[chunk / 8] &= (uint8_t)~(1u << (chunk % 8));
+    }
+    h->recording = 0;
+}
+
+void history_init(History *h) {
+    h->turn_head = 0;
+    h->turn_tail = 0;
+    h->image_head = 0;
+    h->recording = 0;
+    memset(h->touched, 0, sizeof(h->touched));
+}
+
+void history_begin_turn(History *h, const Player *player, Position pos,
+                        GameState state, const BattleState *battle) {
+    close_turn(h);
+    if (h->turn_head - h->turn_tail == HISTORY_TURNS) {
+        h->turn_tail++;
+    }
+    TurnRecord *t = turn_at(h, h->turn_head++);
+    t->player = *player;
+    t->pos = pos;
+    t->state = state;
+    t->battle = *battle;
+    t->first_image = h->image_head;
+    h->recording = 1;
+}
+
+void history_end_turn(History *h, const Player *player, Position pos,
+                      GameState state, const BattleState *battle) {
+    if (!h->recording) return;
+    TurnRecord *t = turn_at(h, h->turn_head - 1);
+    if (t->first_image != h->image_head) return;  // The map changed
+    if (t->pos.x != pos.x || t->pos.y != pos.y || t->state != state ||
+        memcmp(&t->player, player, sizeof(*player)) != 0 ||
+        memcmp(&t->battle, battle, sizeof(*battle)) != 0) {
+        return;
+    }
+    h->recording = 0;
+    h->turn_head--;
+}
+
+/**
+ * Copy the chunk holding (x, y) into the image ring the first time the
+ * open turn touches it. Older turns are forgotten to make room; a turn
+ * that alone overflows the ring cannot be undone and clears the history.
+ */
+void history_touch(History *h, const Map *map, int x, int y) {
+    if (!h->recording) return;
+    int cx = x >> HISTORY_CHUNK_SHIFT;
+    int cy = y >> HISTORY_CHUNK_SHIFT;
+    uint32_t chunk = (uint32_t)(cy * HISTORY_CHUNK_ROW + cx);
+    if (h->touched[chunk / 8] & (1u << (chunk % 8))) return;
+
+    uint32_t open = h->turn_head - 1;
+    while (h->image_head - turn_at(h, h->turn_tail)->first_image >= HISTORY_IMAGES) {
+        if (h->turn_tail == open) {
+            close_turn(h);
+            h->turn_tail = h->turn_head;
+            memset(h->touched, 0, sizeof(h->touched));
+            return;
+        }
+        h->turn_tail++;
+    }
+
+    ChunkImage *img = image_at(h, h->image_head++);
+    img->chunk = chunk;
+    memset(img->visited, 0, sizeof(img->visited));
+    memset(img->looted, 0, sizeof(img->looted));
+    for (int i = 0; i < HISTORY_CHUNK_SIDE * HISTORY_CHUNK_SIDE; i++) {
+        int tx = (cx << HISTORY_CHUNK_SHIFT) + i % HISTORY_CHUNK_SIDE;
+        int ty = (cy << HISTORY_CHUNK_SHIFT) + i / HISTORY_CHUNK_SIDE;
+        if (tx >= MAP_SIZE || ty >= MAP_SIZE) continue;
+        uint8_t bit = (uint8_t)(1u << (i % 8));
+        if (map_is_visited(map, tx, ty)) img->visited[i / 8] |= bit;
+        if (map_is_looted(map, tx, ty)) img->looted[i / 8] |= bit;
+    }
+    h->touched[chunk / 8] |= (uint8_t)(1u << (chunk % 8));
+}
+
+// Write a chunk image back into the map
+static void restore_image(Map *map, const ChunkImage *img) {
+    int cx = (int)(img->chunk % HISTORY_CHUNK_ROW) << HISTORY_CHUNK_SHIFT;
+    int cy = (int)(img->chunk / HISTORY_CHUNK_ROW) << HISTORY_CHUNK_SHIFT;
+    for (int i = 0; i < HISTORY_CHUNK_SIDE * HISTORY_CHUNK_SIDE; i++) {
+        int tx = cx + i % HISTORY_CHUNK_SIDE;
+        int ty = cy + i / HISTORY_CHUNK_SIDE;
+        if (tx >= MAP_SIZE || ty >= MAP_SIZE) continue;
+        uint8_t bit = (uint8_t)(1u << (i % 8));
+        map_set_visited(map, tx, ty, (img->visited[i / 8] & bit) != 0);
+        int looted = (img->looted[i / 8] & bit) != 0;
+        if (map_is_looted(map, tx, ty) != looted) {
+            map_set_looted(map, tx, ty, looted);
+        }
+    }
+}
+
+int history_rewind(History *h, Map *map, int turns, Player *player, Position *pos,
+                   GameState *state, BattleState *battle) {
+    close_turn(h);
+    int undone = 0;
+    while (undone < turns && h->turn_head != h->turn_tail) {
+        const TurnRecord *t = turn_at(h, --h->turn_head);
+        while (h->image_head != t->first_image) {
+            restore_image(map, image_at(h, --h->image_head));
+        }
+        *player = t->player;
+        *pos = t->pos;
+        *state = t->state;
+        *battle = t->battle;
+        undone++;
+    }
+    return undone;
+}
+
+HistoryMark history_mark(const History *h) {
+    return h->turn_head;
+}
+
+int history_rewind_to(History *h, Map *map, HistoryMark mark, Player *player,
+                      Position *pos, GameState *state, BattleState *battle) {
+    uint32_t turns = h->turn_head - mark;
+    if (turns > h->turn_head - h->turn_tail) {
+        return -1;
+    }
+    return history_rewind(h, map, (int)turns, player, pos, state, battle);
+}
+
+int history_depth(const History *h) {
+    return (int)(h->turn_head - h->turn_tail);
+}
@@ -0,0 +1,91 @@
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include <stdint.h>
+#include "dungeon.h"
+
+/*
+ * Undo history - lets the game (or a simulator) step back whole turns.
+ *
+ * Copying the map every turn would cost megabytes, so the mutable map
+ * layers (`visited` and the consumed flags) are journaled copy-on-write:
+ * the map is split into 16x16 chunks, and the first time a turn touches a
+ * chunk its before-image (two 32-byte bitsets) is saved. A turn that moves
+ * one step and fights stores one chunk image plus a copy of the Player, so
+ * memory grows with what changed, not with the map size.
+ *
+ * Turns and images live in fixed rings; when either fills up the oldest
+ * turns are forgotten. Rewinding restores chunk images newest first, then
+ * the player state saved when the turn began.
+ */
+
+#define HISTORY_TURNS  64   // Turns that can be rewound
+#define HISTORY_IMAGES 512  // Chunk images shared by those turns
+
+#define HISTORY_CHUNK_SHIFT 4  // 16x16 tiles per chunk
+#define HISTORY_CHUNK_SIDE  (1 << HISTORY_CHUNK_SHIFT)
+#define HISTORY_CHUNK_BYTES (HISTORY_CHUNK_SIDE * HISTORY_CHUNK_SIDE / 8)
+#define HISTORY_CHUNK_ROW   ((MAP_SIZE + HISTORY_CHUNK_SIDE - 1) / HISTORY_CHUNK_SIDE)
+#define HISTORY_CHUNKS      (HISTORY_CHUNK_ROW * HISTORY_CHUNK_ROW)
+
+// Before-image of one chunk (bit i = tile i of the chunk, row-major)
+typedef struct {
+    uint32_t chunk;
+    uint8_t visited[HISTORY_CHUNK_BYTES];
+    uint8_t looted[HISTORY_CHUNK_BYTES];
+} ChunkImage;
+
+// State at the start of a turn, plus the chunk images the turn saved
+typedef struct {
+    Player player;
+    Position pos;
+    GameState state;
+    BattleState battle;
+    uint32_t first_image;  // Sequence number of the turn's first image
+} TurnRecord;
+
+typedef struct History {
+    TurnRecord turns[HISTORY_TURNS];
+    ChunkImage images[HISTORY_IMAGES];
+    uint32_t turn_head;    // Turns recorded so far (ring index = n % HISTORY_TURNS)
+    uint32_t turn_tail;    // Oldest turn still held
+    uint32_t image_head;   // Images saved so far
+    int recording;         // A turn is open (between begin and the next rewind)
+    uint8_t touched[(HISTORY_CHUNKS + 7) / 8];  // Chunks imaged by the open turn
+} History;
+
+// A point to come back to with history_rewind_to()
+typedef uint32_t HistoryMark;
+
+// Forget everything (new game, loaded save).
+void history_init(History *h);
+
+// Open a new turn, saving the state it starts from. Closes the previous turn.
+void history_begin_turn(History *h, const Player *player, Position pos,
+                        GameState state, const BattleState *battle);
+
+// Drop the open turn again if it changed nothing (so rewinding skips it).
+void history_end_turn(History *h, const Player *player, Position pos,
+                      GameState state, const BattleState *battle);
+
+// Save the chunk holding (x, y) before it changes. Called by the map.
+void history_touch(History *h, const Map *map, int x, int y);
+
+// Undo up to `turns` turns. The player state is restored from the oldest
+// turn undone. Returns the number of turns actually undone.
+int history_rewind(History *h, Map *map, int turns, Player *player, Position *pos,
+                   GameState *state, BattleState *battle);
+
+// Current position in the history, for branching: play on, then
+// history_rewind_to() the mark to try something else from the same state.
+HistoryMark history_mark(const History *h);
+
+// Rewind to a mark. Returns the turns undone, or -1 if the mark has
+// already been forgotten (the state is then left unchanged).
+int history_rewind_to(History *h, Map *map, HistoryMark mark, Player *player,
+                      Position *pos, GameState *state, BattleState *battle);
+
+// Turns that can currently be undone.
+int history_depth(const History *h);
+
+#endif
@@ -0,0 +1,131 @@
+#include <stddef.h>
+#include "inventory.h"
+
+static unsigned int stack_hash(int item_id, uint32_t roll) {
+    uint32_t h = (uint32_t)item_id * 0x9E3779B1u ^ roll * 0x85EBCA6Bu;
+    return (unsigned int)(h ^ (h >> 15)) & (INVENTORY_INDEX_SIZE - 1);
+}
+
+/**
+ * Bucket holding the stack for (item_id, roll), or the empty bucket where
+ * it would go
+ */
+static unsigned int index_probe(const Inventory *inv, int item_id, uint32_t roll) {
+    unsigned int b = stack_hash(item_id, roll);
+    while (inv->stack_index[b] != INVALID_SLOT) {
+        const InventoryEntry *e = &inv->entries[inv->stack_index[b]];
+        if (e->item_id == item_id && e->roll == roll) break;
+        b = (b + 1) & (INVENTORY_INDEX_SIZE - 1);
+    }
+    return b;
+}
+
+/**
+ * Drop `slot` from the stack index if it is there. Later entries of the
+ * probe run are shifted back so lookups never need tombstones.
+ */
+static void index_erase(Inventory *inv, int slot) {
+    const unsigned int mask = INVENTORY_INDEX_SIZE - 1;
+    const InventoryEntry *e = &inv->entries[slot];
+    unsigned int hole = index_probe(inv, e->item_id, e->roll);
+    if (inv->stack_index[hole] != slot) return;  // Not a stack entry
+
+    for (unsigned int i = (hole + 1) & mask; inv->stack_index[i] != INVALID_SLOT; i = (i + 1) & mask) {
+        const InventoryEntry *moved = &inv->entries[inv->stack_index[i]];
+        unsigned int home = stack_hash(moved->item_id, moved->roll);
+        // Move it into the hole unless its home bucket lies between the hole and i
+        if (((i - home) & mask) >= ((i - hole) & mask)) {
+            inv->stack_index[hole] = inv->stack_index[i];
+            hole = i;
+        }
+    }
+    inv->stack_index[hole] = INVALID_SLOT;
+}
+
+void inventory_init(Inventory *inv) {
+    for (int i = 0; i < MAX_INVENTORY; i++) {
+        inv->entries[i] = (InventoryEntry){0, 0, 0};
+        inv->generation[i] = 1;
+        inv->next_free[i] = (int8_t)(i + 1 < MAX_INVENTORY ? i + 1 : INVALID_SLOT);
+    }
+    inv->free_head = 0;
+    for (int i = 0; i < INVENTORY_INDEX_SIZE; i++) {
+        inv->stack_index[i] = INVALID_SLOT;
+    }
+    inv->count = 0;
+}
+
+ItemHandle inventory_add(Inventory *inv, int item_id, int quantity, uint32_t roll, int stackable) {
+    if (quantity <= 0) return ITEM_HANDLE_NONE;  // A 0 quantity would read as a free slot
+    // An id that does not fit the entry would be stored (and indexed) as another item
+    if (item_id < 1 || item_id > UINT16_MAX) return ITEM_HANDLE_NONE;
+    if (quantity > UINT16_MAX) quantity = UINT16_MAX;
+    unsigned int bucket = 0;
+    if (stackable) {
+        bucket = index_probe(inv, item_id, roll);
+        int slot = inv->stack_index[bucket];
+        if (slot != INVALID_SLOT) {
+            // Full stacks stay full rather than wrap around to "free"
+            int total = inv->entries[slot].quantity + quantity;
+            inv->entries[slot].quantity = (uint16_t)(total > UINT16_MAX ? UINT16_MAX : total);
+            return inventory_handle(inv, slot);
+        }
+    }
+
+    int slot = inv->free_head;
+    if (slot == INVALID_SLOT) {
+        return ITEM_HANDLE_NONE;
+    }
+    inv->free_head = inv->next_free[slot];
+    inv->entries[slot] = (InventoryEntry){(uint16_t)item_id, (uint16_t)quantity, roll};
+    inv->count++;
+    if (stackable) {
+        inv->stack_index[bucket] = (int8_t)slot;
+    }
+    return inventory_handle(inv, slot);
+}
+
+void inventory_remove(Inventory *inv, int slot) {
+    if (!inventory_slot(inv, slot)) return;
+
+    index_erase(inv, slot);
+    inv->entries[slot].quantity = 0;
+    // Skip 0 on wrap-around so a live handle is never ITEM_HANDLE_NONE
+    if (++inv->generation[slot] == 0) inv->generation[slot] = 1;
+    inv->next_free[slot] = inv->free_head;
+    inv->free_head = (int8_t)slot;
+    inv->count--;
+}
+
+int inventory_consume(Inventory *inv, int slot, int amount) {
+    if (!inventory_slot(inv, slot)) return 0;
+
+    InventoryEntry *e = &inv->entries[slot];
+    if (amount >= e->quantity) {
+        inventory_remove(inv, slot);
+        return 0;
+    }
+    e->quantity = (uint16_t)(e->quantity - amount);
+    return e->quantity;
+}
+
+const InventoryEntry *inventory_slot(const Inventory *inv, int slot) {
+    if (slot < 0 || slot >= MAX_INVENTORY || inv->entries[slot].quantity == 0) {
+        return NULL;
+    }
+    return &inv->entries[slot];
+}
+
+ItemHandle inventory_handle(const Inventory *inv, int slot) {
+    if (!inventory_slot(inv, slot)) return ITEM_HANDLE_NONE;
+    return (ItemHandle)inv->generation[slot] << 16 | (ItemHandle)slot;
+}
+
+int inventory_lookup(const Inventory *inv, ItemHandle handle) {
+    if (handle == ITEM_HANDLE_NONE) return INVALID_SLOT;
+    int slot = (int)(handle & 0xFFFF);
+    if (!inventory_slot(inv, slot) || inv->generation[slot] != (uint16_t)(handle >> 16)) {
+        return INVALID_SLOT;
+    }
+    return slot;
+}
@@ -0,0 +1,67 @@
+#ifndef INVENTORY_H
+#define INVENTORY_H
+
+#include <stdint.h>
+
+/*
+ * Fixed-capacity inventory with stable slots.
+ *
+ * Entries never move: a removed entry's slot goes onto a free list and its
+ * generation counter is bumped, so a handle taken earlier (e.g. by the
+ * equipment) stops resolving instead of pointing at whatever lands there
+ * next. Stackable entries are also indexed by (item id, roll), so finding
+ * a stack to merge into does not scan the inventory.
+ */
+
+enum {
+    MAX_INVENTORY = 24,
+    INVALID_SLOT = -1,
+    INVENTORY_INDEX_SIZE = 64   // Stack index buckets (power of two, > MAX_INVENTORY)
+};
+
+// Compact inventory entry (8 bytes). Names and base stats stay in the
+// read-only item catalog; only what differs per copy is stored here.
+// A quantity of 0 marks a free slot.
+typedef struct {
+    uint16_t item_id;   // Catalog id
+    uint16_t quantity;
+    uint32_t roll;      // Rolled stat bonuses, see item_roll_pack()
+} InventoryEntry;
+
+// Generation in the high 16 bits, slot in the low 16. Never 0 for a live entry.
+typedef uint32_t ItemHandle;
+#define ITEM_HANDLE_NONE 0u
+
+typedef struct {
+    InventoryEntry entries[MAX_INVENTORY];
+    uint16_t generation[MAX_INVENTORY];         // Bumped each time a slot is freed
+    int8_t next_free[MAX_INVENTORY];            // Free-list links
+    int8_t free_head;                           // First free slot or INVALID_SLOT
+    int8_t stack_index[INVENTORY_INDEX_SIZE];   // (id, roll) -> slot, linear probing
+    int count;                                  // Occupied slots
+} Inventory;
+
+void inventory_init(Inventory *inv);
+
+// Add `quantity` of an item. Stackable items merge into an existing entry
+// with the same id and roll; a stack holds at most UINT16_MAX and any more
+// is dropped. Returns the entry's handle, or ITEM_HANDLE_NONE if a new slot
+// was needed and the inventory is full (or `quantity` is not positive, or
+// `item_id` is outside 1..UINT16_MAX).
+ItemHandle inventory_add(Inventory *inv, int item_id, int quantity, uint32_t roll, int stackable);
+
+// Take up to `amount` from the entry in `slot`, freeing the slot when it
+// reaches zero. Returns the quantity left (0 if the entry is gone).
+int inventory_consume(Inventory *inv, int slot, int amount);
+void inventory_remove(Inventory *inv, int slot);
+
+// Occupied entry in `slot`, or NULL for a free or out-of-range slot
+const InventoryEntry *inventory_slot(const Inventory *inv, int slot);
+
+// Handle for the entry currently in `slot` (ITEM_HANDLE_NONE if free)
+ItemHandle inventory_handle(const Inventory *inv, int slot);
+
+// Slot a handle refers to, or INVALID_SLOT if the entry has since been removed
+int inventory_lookup(const Inventory *inv, ItemHandle handle);
+
+#endif
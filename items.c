@@ -0,0 +1,68 @@
+#include "gamedata.h"
+#include "items.h"
+
+static int clamp(int v, int lo, int hi) {
+    return v < lo ? lo : (v > hi ? hi : v);
+}
+
+uint32_t item_roll_pack(int damage_bonus, int defense_bonus, int value_bonus) {
+    return (uint32_t)(uint8_t)(int8_t)clamp(damage_bonus, INT8_MIN, INT8_MAX)
+         | (uint32_t)(uint8_t)(int8_t)clamp(defense_bonus, INT8_MIN, INT8_MAX) << 8
+         | (uint32_t)(uint16_t)clamp(value_bonus, 0, UINT16_MAX) << 16;
+}
+
+int item_roll_damage(uint32_t roll) {
+    return (int8_t)(roll & 0xFF);
+}
+
+int item_roll_defense(uint32_t roll) {
+    return (int8_t)((roll >> 8) & 0xFF);
+}
+
+int item_roll_value(uint32_t roll) {
+    return (int)(roll >> 16);
+}
+
+const char *item_name(int item_id) {
+    const ItemDef *def = gamedata_find_item(gamedata(), item_id);
+    return def ? def->name : "Unknown item";
+}
+
+ItemType item_type(int item_id) {
+    const ItemDef *def = gamedata_find_item(gamedata(), item_id);
+    return def ? (ItemType)def->type : ITEM_MISC;
+}
+
+const char *item_type_name(ItemType type) {
+    switch (type) {
+        case ITEM_CONSUMABLE: return "Consumable";
+        case ITEM_WEAPON:     return "Weapon";
+        case ITEM_ARMOR:      return "Armor";
+        case ITEM_MISC:       return "Misc";
+        default:              return "Unknown";
+    }
+}
+
+/**
+ * Expand an inventory entry using the current catalog. Final stats are the
+ * catalog base plus the entry's rolls; value grows with every rolled point.
+ */
+int item_resolve(const InventoryEntry *entry, Item *out) {
+    const ItemDef *def = gamedata_find_item(gamedata(), entry->item_id);
+    if (!def) {
+        *out = (Item){entry->item_id, ITEM_MISC, "Unknown item", entry->quantity, {0, 0}, 0};
+        return 0;
+    }
+
+    int dmg = item_roll_damage(entry->roll);
+    int def_bonus = item_roll_defense(entry->roll);
+    *out = (Item){
+        def->id,
+        (ItemType)def->type,
+        def->name,
+        entry->quantity,
+        (ItemStats){def->damage + dmg, def->defense + def_bonus},
+        def->value + def->value_per_stat * (dmg + def_bonus) + item_roll_value(entry->roll)
+    };
+    return 1;
+}
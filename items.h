@@ -0,0 +1,31 @@
+#ifndef ITEMS_H
+#define ITEMS_H
+
+#include <stdint.h>
+#include "player.h"
+
+/*
+ * Item catalog access. Inventory entries only hold a catalog id, a
+ * quantity and their packed stat rolls; names, types and base stats are
+ * looked up in the read-only catalog (game data) when something needs
+ * to be shown or applied.
+ */
+
+// Pack/unpack rolled stat bonuses into InventoryEntry.roll
+// (damage and defense as signed 8-bit, value bonus as 16-bit)
+uint32_t item_roll_pack(int damage_bonus, int defense_bonus, int value_bonus);
+int item_roll_damage(uint32_t roll);
+int item_roll_defense(uint32_t roll);
+int item_roll_value(uint32_t roll);
+
+// Name for an item id ("Unknown item" if the catalog has no such id)
+const char *item_name(int item_id);
+// Type for an item id (ITEM_MISC if the catalog has no such id)
+ItemType item_type(int item_id);
+const char *item_type_name(ItemType type);
+
+// Expand an inventory entry into a full Item view (name, type, final stats
+// and value). Returns 0 and fills a placeholder if the id is unknown.
+int item_resolve(const InventoryEntry *entry, Item *out);
+
+#endif
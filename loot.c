@@ -0,0 +1,94 @@
+#include "items.h"
+#include "loot.h"
+#include "rng.h"
+
+typedef unsigned int (*LootRng)(void *state);
+
+static unsigned int rng_game(void *state) {
+    (void)state;
+    return (unsigned int)rng_rand();
+}
+
+// A private generator for batch sampling, so it leaves the game's alone
+static unsigned int rng_private(void *state) {
+    return (unsigned int)(rng_next(state) >> 33);
+}
+
+static int roll_range(LootRng rng, void *state, int min, int range) {
+    return range > 0 ? min + (int)(rng(state) % (unsigned int)range) : min;
+}
+
+/*
+ * Walk from `table` down through nested tables until an item or "nothing"
+ * comes up, summing stat rolls from every entry on the way.
+ */
+static int loot_sample(const GameData *gd, int table, int quality,
+                       LootRng rng, void *state, LootDrop *out) {
+    int damage = 0, defense = 0, value = 0;
+
+    for (int depth = 0; depth <= LOOT_MAX_DEPTH; depth++) {
+        const LootTableDef *t = &gd->loot_tables[table];
+        int pick = alias_pick(&gd->loot_alias[table], rng(state), rng(state));
+        const LootEntryDef *e = &gd->loot_entries[t->first_entry + pick];
+
+        int d = roll_range(rng, state, e->damage_min, e->damage_range);
+        int a = roll_range(rng, state, e->defense_min, e->defense_range);
+        if (d > 0 && e->quality_damage_div > 0) d += quality / e->quality_damage_div;
+        if (a > 0 && e->quality_defense_div > 0) a += quality / e->quality_defense_div;
+        damage += d;
+        defense += a;
+        value += roll_range(rng, state, 0, e->value_range);
+
+        if (e->kind == LOOT_NOTHING) {
+            return 0;
+        }
+        if (e->kind == LOOT_ITEM) {
+            out->item_id = e->target;
+            out->damage_bonus = damage;
+            out->defense_bonus = defense;
+            out->value_bonus = value;
+            return 1;
+        }
+        table = e->target;  // LOOT_TABLE: descend
+    }
+    return 0;  // Unreachable for validated data
+}
+
+int loot_roll(const char *table_name, int quality, LootDrop *out) {
+    const GameData *gd = gamedata();
+    int table = gamedata_find_loot_table(gd, table_name);
+    if (table < 0) return 0;
+    return loot_sample(gd, table, quality, rng_game, NULL, out);
+}
+
+int loot_give(Player *player, const char *table_name, int quality, LootDrop *out_drop, EventLog *log) {
+    LootDrop drop;
+    if (!loot_roll(table_name, quality, &drop)) {
+        return 0;
+    }
+    uint32_t roll = item_roll_pack(drop.damage_bonus, drop.defense_bonus, drop.value_bonus);
+    if (!player_add_item(player, drop.item_id, 1, roll, log)) {
+        return 0;
+    }
+    if (out_drop) *out_drop = drop;
+    return 1;
+}
+
+void loot_sample_batch(const GameData *gd, int table, int quality, long count,
+                       uint64_t seed, LootStats *stats) {
+    Rng rng = {seed ? seed : SPLITMIX64_GAMMA};  // xorshift must not start at 0
+
+    for (long i = 0; i < count; i++) {
+        LootDrop drop;
+        stats->samples++;
+        if (!loot_sample(gd, table, quality, rng_private, &rng, &drop)) {
+            stats->nothing++;
+            continue;
+        }
+        const ItemDef *def = gamedata_find_item(gd, drop.item_id);
+        stats->item_counts[def - gd->items]++;
+        stats->damage_sum += drop.damage_bonus;
+        stats->defense_sum += drop.defense_bonus;
+        stats->value_sum += drop.value_bonus;
+    }
+}
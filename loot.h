@@ -0,0 +1,48 @@
+#ifndef LOOT_H
+#define LOOT_H
+
+#include <stdint.h>
+#include "gamedata.h"
+#include "player.h"
+
+/*
+ * Loot engine - samples the named, weighted, nestable loot tables from the
+ * game data. Each table is an alias table over its entries, so one draw
+ * costs the same no matter how many entries a table has (plus one extra
+ * draw per level of nesting).
+ */
+
+// Result of one loot draw: an item id plus its rolled stat bonuses
+typedef struct {
+    int item_id;
+    int damage_bonus;
+    int defense_bonus;
+    int value_bonus;
+} LootDrop;
+
+// Aggregate results of a batch run (for balance checks)
+typedef struct {
+    long samples;
+    long nothing;          // Draws that produced no item
+    long *item_counts;     // Per catalog index (gd->item_count entries, caller-owned)
+    long long damage_sum;  // Sum of rolled bonuses over all drops
+    long long defense_sum;
+    long long value_sum;
+} LootStats;
+
+// Draw once from a table using rng_rand(). Returns 1 and fills *out if an item
+// dropped, 0 for a "nothing" result or an unknown table.
+int loot_roll(const char *table_name, int quality, LootDrop *out);
+
+// Roll a table and put the result straight into the player's inventory by
+// catalog id. Returns 1 if an item was added (and fills *out_drop when non-NULL).
+// A drop that does not fit is reported to `log` (may be NULL).
+int loot_give(Player *player, const char *table_name, int quality, LootDrop *out_drop, EventLog *log);
+
+// Draw `count` samples from table index `table` with a private seeded
+// generator (independent of rng_rand(), repeatable for a given seed).
+// stats->item_counts must hold gd->item_count zeroed counters.
+void loot_sample_batch(const GameData *gd, int table, int quality, long count,
+                       uint64_t seed, LootStats *stats);
+
+#endif
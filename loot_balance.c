@@ -0,0 +1,73 @@
+/**
+ * loot_balance.c - Sample every loot table many times and print the
+ * resulting drop distribution, for balance checks.
+ *
+ * Usage: loot_balance [samples] [quality] [seed]
+ *   samples  draws per table (default 1000000)
+ *   quality  quality passed to the tables (default 0; chests use their gold value)
+ *   seed     generator seed (default 1; same seed = same numbers)
+ *
+ * Reads gamedata.bin (or $ADVENTURE_DATA) like the game does.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "gamedata.h"
+#include "loot.h"
+
+int main(int argc, char **argv) {
+    long samples = argc > 1 ? atol(argv[1]) : 1000000;
+    int quality = argc > 2 ? atoi(argv[2]) : 0;
+    uint64_t seed = argc > 3 ? strtoull(argv[3], NULL, 10) : 1;
+    if (samples <= 0) {
+        fprintf(stderr, "usage: %s [samples] [quality] [seed]  (samples > 0)\n", argv[0]);
+        return 1;
+    }
+
+    char err[256];
+    if (gamedata_init(getenv("ADVENTURE_DATA"), err, sizeof(err)) != 0) {
+        fprintf(stderr, "Failed to load game data: %s\n", err);
+        return 1;
+    }
+    const GameData *gd = gamedata();
+
+    long *counts = malloc(sizeof(long) * (size_t)gd->item_count);
+    if (!counts) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    for (int t = 0; t < gd->loot_table_count; t++) {
+        for (int i = 0; i < gd->item_count; i++) counts[i] = 0;
+        LootStats stats = {0};
+        stats.item_counts = counts;
+
+        struct timespec start, end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        loot_sample_batch(gd, t, quality, samples, seed, &stats);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        double secs = (double)(end.tv_sec - start.tv_sec) + (double)(end.tv_nsec - start.tv_nsec) / 1e9;
+
+        long drops = stats.samples - stats.nothing;
+        printf("%s: %ld samples, %.2f%% drop rate, %.1f ns/sample\n",
+               gd->loot_tables[t].name, stats.samples,
+               100.0 * (double)drops / (double)stats.samples, secs * 1e9 / (double)stats.samples);
+        for (int i = 0; i < gd->item_count; i++) {
+            if (counts[i] == 0) continue;
+            printf("  %-18s %7.3f%%\n", gd->items[i].name, 100.0 * (double)counts[i] / (double)stats.samples);
+        }
+        if (drops > 0) {
+            printf("  avg bonus per drop: dmg %.2f  def %.2f  value %.2f\n",
+                   (double)stats.damage_sum / (double)drops,
+                   (double)stats.defense_sum / (double)drops,
+                   (double)stats.value_sum / (double)drops);
+        }
+    }
+
+    free(counts);
+    gamedata_shutdown();
+    return 0;
+}
@@ -11,38 +11,74 @@
 
 #include <stdio.h>   // Standard Input/Output: printf, scanf, getchar
 #include <stdlib.h>  // Standard library: srand, rand, exit
+#include <string.h>  // strchr
 #include <time.h>    // Time functions: time() for random seed
+#include "arena.h"   // One-block allocator for everything the game owns
 #include "dungeon.h" // Our custom dungeon/map types and functions
+#include "eventlog.h" // Ring buffer of game events shown in the message panel
+#include "gamedata.h" // Monster/loot definitions loaded from gamedata.bin
+#include "history.h"  // Undo journal behind the R (rewind) command
+#include "metrics.h"  // Latency histograms and counters (metrics.prom)
 #include "player.h"  // Player struct and class definitions
+#include "save.h"    // Save files and the autosave writer thread
+#include "trace.h"   // Trace spans (make TRACE=1; compiled out otherwise)
 #include "ui.h"      // User interface rendering functions
+#include "worldgen.h" // Map generation on a background thread
+#include "zobrist.h"  // 64-bit fingerprint of the game state
+
+// Arena reservation: the map (with its content table), the event log and
+// the undo history. Pages are only backed once touched, so this is an
+// upper bound, not a cost.
+#define GAME_ARENA_BYTES (MAP_ARENA_BYTES + sizeof(EventLog) + sizeof(History) + 4096)
+
+#define AUTOSAVE_EVERY_MOVES 25  // Default for ADVENTURE_AUTOSAVE_MOVES
 
 /**
- * main() - Program entry point
- * 
- * C vs C++:
- * - In C, main returns int (always)
- * - "void" in the parameters means no arguments (in C++ you'd write main())
- * - No try/catch in C - error handling is manual with return codes
- * 
- * @return 0 on success, non-zero on error (Unix convention)
+ * Publish the arena's size, high-water mark and waste as metrics gauges
  */
-int main(void)
-{
-    /*
-     * Seed the random number generator
-     * 
-     * C vs C++:
-     * - C uses srand() + rand() (in C++ you'd use <random> with mt19937)
-     * - time(NULL) returns current time as seed (NULL = no pointer passed)
-     * - Cast to unsigned int because time_t might be different size
-     * - This makes rand() produce different numbers each run
-     */
-    srand((unsigned int)time(NULL));
+static void report_arena(const Arena *arena) {
+    metrics_set(METRIC_ARENA_CAPACITY_BYTES, arena->capacity);
+    metrics_set(METRIC_ARENA_USED_BYTES, arena->used);
+    metrics_set(METRIC_ARENA_PEAK_BYTES, arena->peak);
+    metrics_set(METRIC_ARENA_WASTED_BYTES, arena->padding + arena->abandoned);
+}
 
-    // ========================================================================
-    // CHARACTER CLASS SELECTION
-    // ========================================================================
-    
+/**
+ * Keep a copy of a reload error for the EV_DATA_REJECTED event that shows it
+ *
+ * Events only hold a pointer to their text. The copies go round a ring as
+ * long as the event log's, so a slot is only reused once the event
+ * pointing at it has been pushed out of the log.
+ */
+static const char *keep_reload_error(const char *err) {
+    static char kept[EVENTLOG_CAPACITY][256];  // As long as main()'s err buffer
+    static unsigned next;
+    char *slot = kept[next++ % EVENTLOG_CAPACITY];
+    snprintf(slot, sizeof(kept[0]), "%s", err);
+    return slot;
+}
+
+/**
+ * Start over with a fresh player in the map the caller has just
+ * regenerated in place (same buffers, same content table allocation).
+ */
+static void restart_game(Player *player, PlayerClass player_class, EventLog *log,
+                         Position *pos, GameState *state, BattleState *battle) {
+    player_init(player, player_class);
+    eventlog_init(log);
+    eventlog_note(log, "The portal flares again - a new dungeon takes shape around you...");
+    *pos = (Position){MAP_CENTER, MAP_CENTER};
+    *state = STATE_EXPLORING;
+    *battle = (BattleState){0};
+}
+
+/**
+ * Show the title and class menu and wait for a valid choice, then for Enter
+ *
+ * @return the chosen class
+ */
+static PlayerClass choose_class(void)
+{
     /*
      * Display the game title using box-drawing characters
      * 
@@ -162,6 +198,138 @@ int main(void)
     printf("\nPress Enter to begin your adventure...");
     getchar(); // consume newline from scanf
     getchar(); // wait for user to press Enter
+
+    return selected_class;
+}
+
+/**
+ * main() - Program entry point
+ * 
+ * C vs C++:
+ * - In C, main returns int (always)
+ * - "void" in the parameters means no arguments (in C++ you'd write main())
+ * - No try/catch in C - error handling is manual with return codes
+ * 
+ * @return 0 on success, non-zero on error (Unix convention)
+ */
+int main(void)
+{
+    /*
+     * Seed the random number generator
+     * 
+     * C vs C++:
+     * - C uses srand() + rand() (in C++ you'd use <random> with mt19937)
+     * - time(NULL) returns current time as seed (NULL = no pointer passed)
+     * - Cast to unsigned int because time_t might be different size
+     * - This makes rand() produce different numbers each run
+     */
+    srand((unsigned int)time(NULL));
+
+    /*
+     * Load monster and loot definitions
+     *
+     * C error handling:
+     * - gamedata_init() returns -1 and fills err with a description
+     * - getenv() returns NULL if the variable is unset, which selects
+     *   the default path (gamedata.bin in the current directory)
+     */
+    char err[256];
+    if (gamedata_init(getenv("ADVENTURE_DATA"), err, sizeof(err)) != 0) {
+        fprintf(stderr, "Failed to load game data: %s\n", err);
+        fprintf(stderr, "Run 'make' to build gamedata.bin from gamedata.txt.\n");
+        return 1;
+    }
+
+    /*
+     * Start collecting metrics
+     *
+     * The file is written when the game exits, or at any time with:
+     *   kill -USR1 <pid>
+     * ADVENTURE_METRICS picks the path (empty string = don't write it).
+     */
+    metrics_init(getenv("ADVENTURE_METRICS"));
+
+    /*
+     * Start the autosave writer and, if asked, load the last save
+     *
+     * C vs C++:
+     * - atoi() converts a string to int (like std::stoi, but returns 0
+     *   instead of throwing on garbage)
+     * - ADVENTURE_SAVE picks the file (default adventure.sav, empty = off),
+     *   ADVENTURE_AUTOSAVE_MOVES how often it is written
+     * - ADVENTURE_CONTINUE=1 resumes from the save instead of starting a
+     *   new character; save_read() refuses damaged files
+     */
+    const char *autosave_moves = getenv("ADVENTURE_AUTOSAVE_MOVES");
+    Autosave autosave;
+    autosave_init(&autosave, getenv("ADVENTURE_SAVE"),
+                  autosave_moves ? atoi(autosave_moves) : AUTOSAVE_EVERY_MOVES);
+
+    SaveGame saved;
+    int resumed = 0;
+    const char *continue_env = getenv("ADVENTURE_CONTINUE");
+    if (autosave.started && continue_env && strcmp(continue_env, "1") == 0) {
+        if (save_read(autosave.path, &saved, err, sizeof(err)) == 0) {
+            resumed = 1;
+        } else {
+            fprintf(stderr, "Not resuming: %s\n", err);
+        }
+    }
+    uint32_t world_seed = resumed ? saved.seed : (uint32_t)rand();
+
+    /*
+     * Reserve the game's memory in one block
+     *
+     * C vs C++:
+     * - Everything that lives as long as the game (map, event log, the
+     *   map's content table) is carved out of one arena
+     * - In C++ you might write a custom allocator or use std::pmr's
+     *   monotonic_buffer_resource; in C it's a struct and a bump pointer
+     * - arena_destroy() at the end frees all of it at once - no
+     *   per-object free() calls to forget
+     */
+    Arena arena;
+    if (arena_init(&arena, GAME_ARENA_BYTES) != 0) {
+        fprintf(stderr, "Failed to reserve %zu bytes of game memory\n", (size_t)GAME_ARENA_BYTES);
+        gamedata_shutdown();
+        return 1;
+    }
+
+    /*
+     * Create the map and start generating it in the background
+     * 
+     * C vs C++:
+     * - ARENA_NEW(&arena, Map) is our stand-in for "new Map" - it returns
+     *   a pointer into the arena
+     * - The reservation above is sized so these can't fail
+     * - map_init() ties the map's content table to the same arena; the
+     *   maze itself is a read-only World mapped outside it (world.h)
+     * - worldgen_start() runs map_generate_seeded() on a pthread (C has
+     *   no std::thread - POSIX threads are the usual choice), so the maze
+     *   is carved while the player is still reading the class menu
+     * - The seed comes from rand() here, on the main thread, so srand()
+     *   still decides the world (or from the save when resuming)
+     * - ADVENTURE_WORLDGEN=sync generates after class selection instead,
+     *   for comparing time-to-first-frame
+     */
+    Map *map = ARENA_NEW(&arena, Map);
+    map_init(map, &arena);
+    const char *worldgen_mode = getenv("ADVENTURE_WORLDGEN");
+    int background_worldgen = !(worldgen_mode && strcmp(worldgen_mode, "sync") == 0);
+    WorldGen worldgen = {0};
+    if (background_worldgen) {
+        worldgen_start(&worldgen, map, world_seed);
+    }
+
+    // ========================================================================
+    // CHARACTER CLASS SELECTION
+    // ========================================================================
+
+    /*
+     * A resumed game keeps the saved character; otherwise ask
+     */
+    PlayerClass selected_class = resumed ? saved.player.player_class : choose_class();
+    uint64_t first_frame_start = metrics_now_ns();  // Startup latency the player sees
     
     // ========================================================================
     // GAME INITIALIZATION
@@ -181,16 +349,22 @@ int main(void)
     player_init(&player, selected_class);  // Pass address to initialize
     
     /*
-     * Create and generate the map
-     * 
-     * C vs C++:
-     * - Map map; allocates on the stack (same as C++)
-     * - map_generate(&map) passes address to fill in the map data
-     * - No "new" keyword - this is stack allocation
-     * - Will be automatically freed when main() exits
+     * Wait for the world generated in the background
+     *
+     * Usually it finished long ago, while the class menu was on screen,
+     * and this returns at once.
      */
-    Map map;
-    map_generate(&map);
+    metrics_observe(METRIC_WORLDGEN_WAIT, worldgen_join(&worldgen));
+    if (!background_worldgen) {
+        worldgen.status = map_generate_seeded(map, world_seed);  // ADVENTURE_WORLDGEN=sync: the old critical path
+    }
+    if (worldgen.status != 0) {
+        fprintf(stderr, "Failed to generate the dungeon: out of memory\n");
+        autosave_shutdown(&autosave);
+        arena_destroy(&arena);
+        gamedata_shutdown();
+        return 1;
+    }
 
     /*
      * Initialize game state variables
@@ -205,22 +379,67 @@ int main(void)
     GameState state = STATE_EXPLORING;        // Game state enum
     BattleState battle = {0};                 // Zero-initialize all members
     battle.is_active = 0;                     // Explicitly set (redundant but clear)
+
+    /*
+     * Resuming: put back the saved character, position and explored tiles
+     *
+     * The save also carries the state's Zobrist hash: comparing one
+     * 64-bit number checks that the restored game is the one that was
+     * saved, instead of comparing the whole map and player field by field.
+     * A save that restores to anything else is damaged: the map is reset
+     * and a new character chosen, as if save_read() had refused it.
+     */
+    if (resumed) {
+        if (save_apply(&saved, map) == 0) {
+            player = saved.player;  // Struct assignment copies every member
+            pos = saved.pos;
+        } else {
+            fprintf(stderr, "Not resuming: %s: damaged (does not restore to the saved state)\n",
+                    autosave.path);
+            resumed = 0;
+            map_attach(map, map->world);  // Same world, nothing visited
+            selected_class = choose_class();
+            player_init(&player, selected_class);
+            first_frame_start = metrics_now_ns();
+        }
+        save_release(&saved);
+    }
+
+    /*
+     * Start the undo history
+     *
+     * C vs C++:
+     * - There is no copy-on-write std::shared_ptr magic here: the map
+     *   calls history_touch() itself before changing a tile, and the
+     *   history copies that tile's 16x16 chunk the first time per turn
+     * - Attaching it only now keeps world generation and the loaded save
+     *   out of the journal
+     */
+    History *history = ARENA_NEW(&arena, History);
+    history_init(history);
+    map->history = history;
     
     /*
      * Set up game loop variables
      * 
-     * C arrays:
-     * - char message[256] = creates array of 256 chars on stack
-     * - In C++, you'd use std::string message = "...";
-     * - String literals automatically null-terminated ('\0' at end)
-     * - Fixed size - NO bounds checking! Overflow = undefined behavior
-     * - Must ensure strings fit in the buffer (why we use 256)
+     * C arrays and structs:
+     * - EventLog holds a fixed array of event records (a ring buffer)
+     * - In C++, you might use std::deque<Event> and let it grow
+     * - Here the size is fixed at compile time: no allocation, and the
+     *   oldest events are simply overwritten once the ring is full
+     * - Events are stored as numbers, not text - the UI formats only
+     *   the lines it actually draws
      */
     int running = 1;  // true - game loop continues while this is 1
-    char message[256] = "Whoa! You trigger a magical portal and find yourself in a mysterious dungeon...";
+    EventLog *log = ARENA_NEW(&arena, EventLog);
+    eventlog_init(log);
+    eventlog_note(log, resumed ? "You find your way back into the dungeon..."
+                               : "Whoa! You trigger a magical portal and find yourself in a mysterious dungeon...");
 
     // Render initial game state
-    ui_render_game(&player, &pos, message, &map);
+    ui_render_game(&player, &pos, log, map);
+    metrics_observe_since(METRIC_FIRST_FRAME, first_frame_start);
+    report_arena(&arena);
 
     // ========================================================================
     // MAIN GAME LOOP
@@ -247,9 +466,12 @@ int main(void)
          * - Returns 1 if successful, 0 if no input, EOF if error
          */
         char command;
+        uint64_t t = metrics_now_ns();  // uint64_t from <stdint.h> - exactly 64 bits everywhere
         if (scanf(" %c", &command) != 1) {
             break;  // Exit loop if scanf fails (EOF or error)
         }
+        metrics_observe_since(METRIC_INPUT, t);
+        metrics_count(METRIC_COMMANDS, 1);
         
         /*
          * Process the command
@@ -260,7 +482,68 @@ int main(void)
          * - C doesn't have references - only pointers
          * - The function can modify these variables through the pointers
          */
-        handle_command(command, &running, &pos, &player, message, &map, &state, &battle);
+        eventlog_begin_turn(log);  // Message panel shows this turn's events
+
+        // Classify the command first - handle_command() may change the state
+        int rewind = command == 'R' || command == 'r';
+        MetricPhase phase = METRIC_COMMAND_OTHER;
+        if (rewind) {
+            phase = METRIC_REWIND;
+        } else if (state == STATE_BATTLE) {
+            phase = METRIC_COMMAND_BATTLE;
+        } else if (state == STATE_INVENTORY) {
+            phase = METRIC_COMMAND_INVENTORY;
+        } else if (strchr("NSEWnsew", command)) {
+            phase = METRIC_COMMAND_MOVE;
+        }
+        Position old_pos = pos;
+        GameState old_state = state;
+
+        /*
+         * R takes back the last turn (in any state, even mid-battle);
+         * everything else is one turn of the history
+         */
+        t = metrics_now_ns();
+        if (rewind) {
+            int undone = history_rewind(history, map, 1, &player, &pos, &state, &battle);
+            eventlog_push(log, EV_REWOUND, NULL, undone, 0, 0);
+        } else {
+            history_begin_turn(history, &player, pos, state, &battle);
+            handle_command(command, &running, &pos, &player, log, map, &state, &battle);
+            history_end_turn(history, &player, pos, state, &battle);
+        }
+        metrics_observe_since(phase, t);
+
+        report_arena(&arena);  // A move can grow the map's content table
+        int moved = !rewind && (pos.x != old_pos.x || pos.y != old_pos.y);
+        if (moved) metrics_count(METRIC_MOVES, 1);
+        if (state == STATE_BATTLE && old_state != STATE_BATTLE) metrics_count(METRIC_BATTLES, 1);
+
+        /*
+         * Autosave every few moves while exploring
+         *
+         * This only copies the state (microseconds); a writer thread
+         * writes and fsyncs the file, so slow flash never blocks input.
+         * Quitting saves right away.
+         */
+        if (state == STATE_EXPLORING && player.health > 0) {
+            autosave_tick(&autosave, moved, !running, &player, &pos, map);
+        }
+
+        /*
+         * Pick up edited game data between turns
+         *
+         * The new table only affects monsters and loot rolled from now on;
+         * a battle already in progress keeps its copied Monster stats.
+         */
+        t = metrics_now_ns();
+        int reloaded = gamedata_poll_reload(err, sizeof(err));
+        metrics_observe_since(METRIC_RELOAD, t);
+        if (reloaded > 0) {
+            eventlog_note(log, "Game data reloaded.");
+        } else if (reloaded < 0) {
+            eventlog_push(log, EV_DATA_REJECTED, keep_reload_error(err), 0, 0, 0);
+        }
         
         // ====================================================================
         // RENDERING
@@ -275,13 +558,18 @@ int main(void)
          * - State pattern but without polymorphism (no virtual functions)
          */
         if (running) {
+            uint64_t bytes_before = ui_bytes_written();
+            t = metrics_now_ns();
             if (state == STATE_BATTLE) {
-                ui_render_battle(&player, &battle, message);
+                ui_render_battle(&player, &battle, log);
             } else if (state == STATE_INVENTORY) {
-                ui_render_inventory(&player, message);
+                ui_render_inventory(&player, log);
             } else {
-                ui_render_game(&player, &pos, message, &map);
+                ui_render_game(&player, &pos, log, map);
             }
+            metrics_observe_since(METRIC_RENDER, t);
+            metrics_count(METRIC_RENDERS, 1);
+            metrics_count(METRIC_BYTES_WRITTEN, ui_bytes_written() - bytes_before);
         }
 
         // ====================================================================
@@ -310,6 +598,71 @@ int main(void)
             printf("Final Position: [%d, %d]\n\n", pos.x, pos.y);
             running = 0;  // Stop the game loop
         }
+
+        // ====================================================================
+        // NEW GAME
+        // ====================================================================
+
+        /*
+         * Offer another round after dying or quitting
+         *
+         * Instead of exiting and starting the program again, the same
+         * process, arena and map buffers are reused: the next map is
+         * generated in place in the background while the question is on
+         * screen, and the player re-created with the class chosen at the
+         * start. EOF (e.g. piped input running out) counts as "no".
+         *
+         * After a death the history can instead rewind to just before the
+         * fatal fight. The old map is still needed for that, so the next
+         * one is only generated once the player has decided.
+         */
+        if (!running) {
+            int can_rewind = player.health <= 0 && history_depth(history) > 0;
+            int prefetched = background_worldgen && !can_rewind;
+            map->history = NULL;  // Regenerating the map is not a turn
+            if (prefetched) {
+                worldgen_start(&worldgen, map, (uint32_t)rand());
+            }
+            char answer;
+            printf(can_rewind ? "Start a new game? (Y/N, R = rewind to before the fight): "
+                              : "Start a new game? (Y/N): ");
+            fflush(stdout);
+            int answered = scanf(" %c", &answer) == 1;
+            t = metrics_now_ns();
+            if (can_rewind && answered && (answer == 'R' || answer == 'r')) {
+                // Undo turns until back in the corridor the fight started from
+                map->history = history;
+                int undone = 0;
+                do {
+                    undone += history_rewind(history, map, 1, &player, &pos, &state, &battle);
+                } while ((state != STATE_EXPLORING || battle.is_active) && history_depth(history) > 0);
+                metrics_observe_since(METRIC_REWIND, t);
+                eventlog_begin_turn(log);
+                eventlog_push(log, EV_REWOUND, NULL, undone, 0, 0);
+                running = 1;
+                if (state == STATE_BATTLE) {
+                    ui_render_battle(&player, &battle, log);
+                } else {
+                    ui_render_game(&player, &pos, log, map);
+                }
+                continue;
+            }
+            int again = answered && (answer == 'Y' || answer == 'y');
+            metrics_observe(METRIC_WORLDGEN_WAIT, worldgen_join(&worldgen));
+            if (again && (prefetched ? worldgen.status : map_generate(map)) != 0) {
+                printf("Could not generate a new dungeon.\n");
+                again = 0;
+            }
+            if (again) {
+                restart_game(&player, selected_class, log, &pos, &state, &battle);
+                autosave_reset(&autosave);
+                history_init(history);
+                map->history = history;
+                metrics_observe_since(METRIC_RESTART, t);
+                running = 1;
+                ui_render_game(&player, &pos, log, map);
+            }
+        }
     }
 
     // ========================================================================
@@ -321,12 +674,21 @@ int main(void)
      * 
      * C vs C++:
      * - No destructors! Must manually clean up
-     * - Luckily, all our data is on the stack (automatic storage)
+     * - Small data is on the stack (automatic storage)
      * - Stack variables are automatically freed when function exits
-     * - If we used malloc(), we'd need to call free() here
+     * - The map and event log live in the arena: arena_destroy() releases
+     *   all of it in one call (after the final metrics dump reports it);
+     *   map_free() first lets go of the map's world mapping
      * - ui_show_cursor() restores the terminal to normal state
      */
     ui_show_cursor();
+    autosave_shutdown(&autosave);  // Waits for a save still being written
+    report_arena(&arena);
+    metrics_dump();       // Final metrics file (see metrics_init above)
+    TRACE_WRITE(getenv("ADVENTURE_TRACE"));  // trace.json in TRACE=1 builds, nothing otherwise
+    map_free(map);
+    arena_destroy(&arena);
+    gamedata_shutdown();  // Unmap the game data blob(s)
     return 0;  // Success! (Unix convention: 0 = success)
     
     /*
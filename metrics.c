@@ -0,0 +1,210 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <fcntl.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "metrics.h"
+
+typedef struct {
+    _Atomic uint64_t buckets[METRIC_BUCKETS + 1];  // Last one is +Inf
+    _Atomic uint64_t count;
+    _Atomic uint64_t sum_ns;
+} Histogram;
+
+// Updated with relaxed atomic adds, so the autosave writer and the
+// server's workers can record alongside the main thread. A dump (possibly
+// from SIGUSR1) may see a sample half-recorded, which at worst makes one
+// scrape off by one.
+static Histogram histograms[METRIC_PHASE_COUNT];
+static _Atomic uint64_t counters[METRIC_COUNTER_COUNT];
+static _Atomic uint64_t gauges[METRIC_GAUGE_COUNT];
+static char metrics_path[256];
+static char metrics_tmp[264];
+
+static const char *const phase_names[METRIC_PHASE_COUNT] = {
+    "input", "command_move", "command_battle", "command_inventory",
+    "command_other", "search_room", "reload", "render", "restart",
+    "first_frame", "worldgen_wait", "autosave_stall", "autosave_write",
+    "rewind", "session_command", "session_queue", "session_hibernate",
+    "session_wake",
+};
+
+static const char *const counter_names[METRIC_COUNTER_COUNT] = {
+    "adventure_commands_total", "adventure_moves_total", "adventure_battles_total",
+    "adventure_renders_total", "adventure_render_bytes_total",
+    "adventure_autosaves_total", "adventure_autosave_failures_total",
+    "adventure_autosaves_deferred_total",
+};
+
+static const char *const gauge_names[METRIC_GAUGE_COUNT] = {
+    "adventure_arena_capacity_bytes", "adventure_arena_used_bytes",
+    "adventure_arena_peak_bytes", "adventure_arena_wasted_bytes",
+    "adventure_save_file_bytes", "adventure_sessions_active",
+    "adventure_sessions_resident",
+};
+
+static void handle_sigusr1(int sig) {
+    (void)sig;
+    metrics_dump();
+}
+
+void metrics_init(const char *path) {
+    if (!path) path = "metrics.prom";
+    snprintf(metrics_path, sizeof(metrics_path), "%s", path);
+    snprintf(metrics_tmp, sizeof(metrics_tmp), "%s.tmp", metrics_path);
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = handle_sigusr1;
+    sa.sa_flags = SA_RESTART;  // Don't break the blocking scanf in the main loop
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGUSR1, &sa, NULL);
+}
+
+uint64_t metrics_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+void metrics_observe(MetricPhase phase, uint64_t ns) {
+    Histogram *h = &histograms[phase];
+    // Bucket i holds samples <= 2^(i+10) ns: i = ceil(log2(ns)) - 10
+    int b = ns <= 1024 ? 0 : 64 - __builtin_clzll(ns - 1) - 10;
+    if (b > METRIC_BUCKETS) b = METRIC_BUCKETS;
+    atomic_fetch_add_explicit(&h->buckets[b], 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&h->count, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&h->sum_ns, ns, memory_order_relaxed);
+}
+
+void metrics_count(MetricCounter counter, uint64_t n) {
+    atomic_fetch_add_explicit(&counters[counter], n, memory_order_relaxed);
+}
+
+void metrics_set(MetricGauge gauge, uint64_t value) {
+    atomic_store_explicit(&gauges[gauge], value, memory_order_relaxed);
+}
+
+// ---------------------------------------------------------------------------
+// Text output. snprintf is not async-signal-safe, so numbers are formatted
+// by hand into a small buffer that is flushed with write().
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    int fd;
+    int failed;
+    size_t len;
+    char buf[512];
+} Writer;
+
+static void out_flush(Writer *w) {
+    size_t off = 0;
+    while (off < w->len && !w->failed) {
+        ssize_t n = write(w->fd, w->buf + off, w->len - off);
+        if (n <= 0) w->failed = 1;
+        else off += (size_t)n;
+    }
+    w->len = 0;
+}
+
+static void out_str(Writer *w, const char *s) {
+    for (; *s; s++) {
+        if (w->len == sizeof(w->buf)) out_flush(w);
+        w->buf[w->len++] = *s;
+    }
+}
+
+static void out_u64(Writer *w, uint64_t v) {
+    char digits[21];
+    int i = (int)sizeof(digits) - 1;
+    digits[i] = '\0';
+    do {
+        digits[--i] = (char)('0' + v % 10);
+        v /= 10;
+    } while (v);
+    out_str(w, &digits[i]);
+}
+
+// Nanoseconds as decimal seconds ("0.000001024")
+static void out_seconds(Writer *w, uint64_t ns) {
+    char frac[10];
+    uint64_t f = ns % 1000000000u;
+    for (int i = 8; i >= 0; i--) {
+        frac[i] = (char)('0' + f % 10);
+        f /= 10;
+    }
+    frac[9] = '\0';
+    out_u64(w, ns / 1000000000u);
+    out_str(w, ".");
+    out_str(w, frac);
+}
+
+int metrics_dump(void) {
+    if (metrics_path[0] == '\0') return -1;
+
+    Writer w;
+    w.fd = open(metrics_tmp, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (w.fd < 0) return -1;
+    w.failed = 0;
+    w.len = 0;
+
+    out_str(&w, "# HELP adventure_phase_seconds Time spent in each main-loop phase.\n");
+    out_str(&w, "# TYPE adventure_phase_seconds histogram\n");
+    for (int p = 0; p < METRIC_PHASE_COUNT; p++) {
+        const Histogram *h = &histograms[p];
+        uint64_t cumulative = 0;
+        for (int b = 0; b <= METRIC_BUCKETS; b++) {
+            cumulative += atomic_load_explicit(&h->buckets[b], memory_order_relaxed);
+            out_str(&w, "adventure_phase_seconds_bucket{phase=\"");
+            out_str(&w, phase_names[p]);
+            out_str(&w, "\",le=\"");
+            if (b < METRIC_BUCKETS) out_seconds(&w, (uint64_t)1024 << b);
+            else out_str(&w, "+Inf");
+            out_str(&w, "\"} ");
+            out_u64(&w, cumulative);
+            out_str(&w, "\n");
+        }
+        out_str(&w, "adventure_phase_seconds_sum{phase=\"");
+        out_str(&w, phase_names[p]);
+        out_str(&w, "\"} ");
+        out_seconds(&w, atomic_load_explicit(&h->sum_ns, memory_order_relaxed));
+        out_str(&w, "\nadventure_phase_seconds_count{phase=\"");
+        out_str(&w, phase_names[p]);
+        out_str(&w, "\"} ");
+        out_u64(&w, atomic_load_explicit(&h->count, memory_order_relaxed));
+        out_str(&w, "\n");
+    }
+
+    for (int c = 0; c < METRIC_COUNTER_COUNT; c++) {
+        out_str(&w, "# TYPE ");
+        out_str(&w, counter_names[c]);
+        out_str(&w, " counter\n");
+        out_str(&w, counter_names[c]);
+        out_str(&w, " ");
+        out_u64(&w, atomic_load_explicit(&counters[c], memory_order_relaxed));
+        out_str(&w, "\n");
+    }
+
+    for (int g = 0; g < METRIC_GAUGE_COUNT; g++) {
+        out_str(&w, "# TYPE ");
+        out_str(&w, gauge_names[g]);
+        out_str(&w, " gauge\n");
+        out_str(&w, gauge_names[g]);
+        out_str(&w, " ");
+        out_u64(&w, atomic_load_explicit(&gauges[g], memory_order_relaxed));
+        out_str(&w, "\n");
+    }
+
+    out_flush(&w);
+    if (close(w.fd) != 0) w.failed = 1;
+    if (w.failed) {
+        unlink(metrics_tmp);
+        return -1;
+    }
+    // Readers only ever see a complete file
+    return rename(metrics_tmp, metrics_path) == 0 ? 0 : -1;
+}
@@ -0,0 +1,83 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdint.h>
+
+/*
+ * Lightweight runtime metrics - per-phase latency histograms and event
+ * counters for the main loop, exported as a Prometheus text file.
+ *
+ * Histograms use fixed power-of-two buckets (1 us .. ~1 s), so recording
+ * a sample is a clock read, a bit scan and three relaxed atomic adds.
+ * Cheap enough to leave on in normal play, and safe from any thread.
+ */
+
+typedef enum {
+    METRIC_INPUT,              // Blocked in scanf (includes player think time)
+    METRIC_COMMAND_MOVE,       // handle_command() for N/S/E/W
+    METRIC_COMMAND_BATTLE,     // handle_command() during a battle
+    METRIC_COMMAND_INVENTORY,  // handle_command() on the inventory screen
+    METRIC_COMMAND_OTHER,      // Any other command (map, log, quit, ...)
+    METRIC_SEARCH_ROOM,        // search_room() after a move
+    METRIC_RELOAD,             // gamedata_poll_reload()
+    METRIC_RENDER,             // ui_render_*()
+    METRIC_RESTART,            // New game after death or quit (regenerates the map)
+    METRIC_FIRST_FRAME,        // Enter on the class screen until the first frame is drawn
+    METRIC_WORLDGEN_WAIT,      // Blocked waiting for background world generation
+    METRIC_AUTOSAVE_STALL,     // Main loop copying state for an autosave
+    METRIC_AUTOSAVE_WRITE,     // Writer thread: serialise, write, fsync, rename
+    METRIC_REWIND,             // Undoing turns from the history (R)
+    METRIC_SESSION_COMMAND,    // Server: one session command, run and rendered
+    METRIC_SESSION_QUEUE,      // Server: a session with input waiting for a worker
+    METRIC_SESSION_HIBERNATE,  // Server: writing an idle session out and freeing it
+    METRIC_SESSION_WAKE,       // Server: reading a hibernated session back in
+    METRIC_PHASE_COUNT
+} MetricPhase;
+
+typedef enum {
+    METRIC_COMMANDS,            // Commands read
+    METRIC_MOVES,               // Successful moves
+    METRIC_BATTLES,             // Battles started
+    METRIC_RENDERS,             // Full-screen renders
+    METRIC_BYTES_WRITTEN,       // Bytes the renderer wrote to stdout
+    METRIC_AUTOSAVES,           // Save files written
+    METRIC_AUTOSAVE_FAILURES,   // Saves that could not be captured or written
+    METRIC_AUTOSAVES_DEFERRED,  // Turns an autosave waited for a busy writer
+    METRIC_COUNTER_COUNT
+} MetricCounter;
+
+typedef enum {
+    METRIC_ARENA_CAPACITY_BYTES,  // Game arena reservation
+    METRIC_ARENA_USED_BYTES,      // Game arena in use now
+    METRIC_ARENA_PEAK_BYTES,      // Game arena high-water mark
+    METRIC_ARENA_WASTED_BYTES,    // Alignment padding plus abandoned blocks
+    METRIC_SAVE_FILE_BYTES,       // Size of the last save written
+    METRIC_SESSIONS_ACTIVE,       // Server: connected sessions
+    METRIC_SESSIONS_RESIDENT,     // Server: connected sessions not hibernated
+    METRIC_GAUGE_COUNT
+} MetricGauge;
+
+enum { METRIC_BUCKETS = 21 };  // le 2^10 ns .. 2^30 ns, then +Inf
+
+// Remember where to write the metrics file and dump it on SIGUSR1.
+// A NULL path selects "metrics.prom"; an empty path disables the file.
+void metrics_init(const char *path);
+
+// Monotonic clock in nanoseconds
+uint64_t metrics_now_ns(void);
+
+void metrics_observe(MetricPhase phase, uint64_t ns);
+void metrics_count(MetricCounter counter, uint64_t n);
+void metrics_set(MetricGauge gauge, uint64_t value);
+
+// Convenience: observe the time since `start_ns` (from metrics_now_ns())
+static inline void metrics_observe_since(MetricPhase phase, uint64_t start_ns) {
+    metrics_observe(phase, metrics_now_ns() - start_ns);
+}
+
+// Write the metrics file now (temp file + rename). Only uses
+// async-signal-safe calls, which is what lets SIGUSR1 dump directly.
+// Returns 0 on success, -1 on error or when disabled.
+int metrics_dump(void);
+
+#endif
@@ -0,0 +1,159 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "net.h"
+
+int net_set_nonblocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    if (flags < 0) return -1;
+    return fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+}
+
+// Resolve a "host:port" address; an empty host means all interfaces when
+// listening and localhost when connecting
+static struct addrinfo *resolve_tcp(const char *address, int passive, char *err, size_t err_size) {
+    const char *colon = strrchr(address, ':');
+    char host[256];
+    size_t host_len = (size_t)(colon - address);
+    if (host_len >= sizeof(host)) {
+        snprintf(err, err_size, "host name too long: %s", address);
+        return NULL;
+    }
+    memcpy(host, address, host_len);
+    host[host_len] = '\0';
+
+    struct addrinfo hints = {0};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = passive ? AI_PASSIVE : 0;
+    struct addrinfo *list;
+    int rc = getaddrinfo(host_len ? host : NULL, colon + 1, &hints, &list);
+    if (rc != 0) {
+        snprintf(err, err_size, "%s: %s", address, gai_strerror(rc));
+        return NULL;
+    }
+    return list;
+}
+
+static int unix_address(const char *path, struct sockaddr_un *sun, char *err, size_t err_size) {
+    memset(sun, 0, sizeof(*sun));
+    sun->sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(sun->sun_path)) {
+        snprintf(err, err_size, "socket path too long: %s", path);
+        return -1;
+    }
+    strcpy(sun->sun_path, path);
+    return 0;
+}
+
+// Clear the way for a Unix socket at `address`: a socket nobody answers on
+// was left behind by a previous server and is removed. Anything else there
+// (a regular file, a server still running) is an error
+static int unix_stale(const char *address, const struct sockaddr_un *sun, char *err, size_t err_size) {
+    struct stat st;
+    if (lstat(address, &st) != 0) {
+        if (errno == ENOENT) return 0;
+        snprintf(err, err_size, "%s: %s", address, strerror(errno));
+        return -1;
+    }
+    if (!S_ISSOCK(st.st_mode)) {
+        snprintf(err, err_size, "%s exists and is not a socket", address);
+        return -1;
+    }
+    int probe = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (probe < 0) {
+        snprintf(err, err_size, "%s: %s", address, strerror(errno));
+        return -1;
+    }
+    int live = connect(probe, (const struct sockaddr *)sun, sizeof(*sun)) == 0;
+    close(probe);
+    if (live) {
+        snprintf(err, err_size, "another server is listening on %s", address);
+        return -1;
+    }
+    if (unlink(address) != 0 && errno != ENOENT) {
+        snprintf(err, err_size, "%s: %s", address, strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+int net_listen(const char *address, char *err, size_t err_size) {
+    int fd = -1;
+    if (strchr(address, ':')) {
+        struct addrinfo *list = resolve_tcp(address, 1, err, err_size);
+        if (!list) return -1;
+        for (struct addrinfo *ai = list; ai; ai = ai->ai_next) {
+            fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+            if (fd < 0) continue;
+            int one = 1;
+            setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+            if (bind(fd, ai->ai_addr, ai->ai_addrlen) == 0) break;
+            close(fd);
+            fd = -1;
+        }
+        freeaddrinfo(list);
+    } else {
+        struct sockaddr_un sun;
+        if (unix_address(address, &sun, err, err_size) != 0) return -1;
+        if (unix_stale(address, &sun, err, err_size) != 0) return -1;
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd >= 0) {
+            if (bind(fd, (struct sockaddr *)&sun, sizeof(sun)) != 0) {
+                close(fd);
+                fd = -1;
+            }
+        }
+    }
+    if (fd < 0 || listen(fd, SOMAXCONN) != 0 || net_set_nonblocking(fd) != 0) {
+        snprintf(err, err_size, "%s: %s", address, strerror(errno));
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int net_connect(const char *address, char *err, size_t err_size) {
+    int fd = -1;
+    if (strchr(address, ':')) {
+        struct addrinfo *list = resolve_tcp(address, 0, err, err_size);
+        if (!list) return -1;
+        for (struct addrinfo *ai = list; ai; ai = ai->ai_next) {
+            fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+            if (fd < 0) continue;
+            if (connect(fd, ai->ai_addr, ai->ai_addrlen) == 0) {
+                // Commands are tiny and latency-bound: don't batch them
+                int one = 1;
+                setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+                break;
+            }
+            close(fd);
+            fd = -1;
+        }
+        freeaddrinfo(list);
+    } else {
+        struct sockaddr_un sun;
+        if (unix_address(address, &sun, err, err_size) != 0) return -1;
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd >= 0 && connect(fd, (struct sockaddr *)&sun, sizeof(sun)) != 0) {
+            close(fd);
+            fd = -1;
+        }
+    }
+    if (fd < 0 || net_set_nonblocking(fd) != 0) {
+        snprintf(err, err_size, "%s: %s", address, strerror(errno));
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+    return fd;
+}
@@ -0,0 +1,27 @@
+#ifndef NET_H
+#define NET_H
+
+#include <stddef.h>
+
+/*
+ * Socket addresses for the game server and its load client.
+ *
+ * An address containing ':' is TCP ("host:port", or ":port" for every
+ * interface / localhost); anything else is the path of a Unix socket.
+ * Returned descriptors are non-blocking.
+ */
+
+#define NET_DEFAULT_ADDRESS "adventure.sock"
+
+// Listen on `address`. A stale Unix socket file is replaced.
+// Returns the listening fd, or -1 with a description in err.
+int net_listen(const char *address, char *err, size_t err_size);
+
+// Connect to `address` (blocking connect, then switched to non-blocking).
+// Returns the fd, or -1 with a description in err.
+int net_connect(const char *address, char *err, size_t err_size);
+
+// Make `fd` non-blocking. Returns 0, or -1 on error.
+int net_set_nonblocking(int fd);
+
+#endif
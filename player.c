@@ -1,17 +1,6 @@
-#include <stdio.h>
+#include "items.h"
 #include "player.h"
 
-// Helper: Convert item type to string for display
-static const char* item_type_name(ItemType t) {
-    switch (t) {
-        case ITEM_CONSUMABLE: return "Consumable";
-        case ITEM_WEAPON:     return "Weapon";
-        case ITEM_ARMOR:      return "Armor";
-        case ITEM_MISC:       return "Misc";
-        default:              return "Unknown";
-    }
-}
-
 /**
  * Recalculate player's total damage and defense based on base stats + equipped items
  */
@@ -20,18 +9,22 @@ void player_apply_equipment(Player *p) {
     p->total_damage  = p->base_damage;
     p->total_defense = p->base_defense;
 
-    // Add weapon bonuses if equipped
-    if (p->equipped.weapon_slot != INVALID_SLOT) {
-        const Item *w = &p->inventory[p->equipped.weapon_slot];
-        p->total_damage  += w->stats.damage;
-        p->total_defense += w->stats.defense;
+    // Add weapon bonuses if equipped (a stale handle counts as unequipped)
+    int weapon_slot = inventory_lookup(&p->inventory, p->equipped.weapon);
+    if (weapon_slot != INVALID_SLOT) {
+        Item w;
+        item_resolve(&p->inventory.entries[weapon_slot], &w);
+        p->total_damage  += w.stats.damage;
+        p->total_defense += w.stats.defense;
     }
     
     // Add armor bonuses if equipped
-    if (p->equipped.armor_slot != INVALID_SLOT) {
-        const Item *a = &p->inventory[p->equipped.armor_slot];
-        p->total_damage  += a->stats.damage;
-        p->total_defense += a->stats.defense;
+    int armor_slot = inventory_lookup(&p->inventory, p->equipped.armor);
+    if (armor_slot != INVALID_SLOT) {
+        Item a;
+        item_resolve(&p->inventory.entries[armor_slot], &a);
+        p->total_damage  += a.stats.damage;
+        p->total_defense += a.stats.defense;
     }
 }
 
@@ -119,58 +112,24 @@ void player_init(Player *p, PlayerClass class) {
     
     p->health = p->max_health;
 
-    // Give starter items
-    p->inventory[0] = (Item){1, ITEM_WEAPON,    "Rusty Sword",  1, {6, 0},  5};
-    p->inventory[1] = (Item){2, ITEM_CONSUMABLE,"Small Potion", 3, {0, 0},  3};
-    p->inventory[2] = (Item){3, ITEM_ARMOR,     "Cloth Tunic",  1, {0, 2},  4};
-    p->inv_count = 3;
+    // Give starter items (catalog ids: names and stats come from gamedata.txt)
+    inventory_init(&p->inventory);
+    ItemHandle sword = inventory_add(&p->inventory, 1, 1, 0, 0);  // Rusty Sword
+    inventory_add(&p->inventory, 2, 3, 0, 1);                      // Small Potion x3
+    ItemHandle tunic = inventory_add(&p->inventory, 3, 1, 0, 0);  // Cloth Tunic
 
     // Equip starter gear
-    p->equipped.weapon_slot = 0;  // Rusty Sword
-    p->equipped.armor_slot  = 2;  // Cloth Tunic
+    p->equipped.weapon = sword;
+    p->equipped.armor  = tunic;
 
     // Calculate final stats with equipment
     player_apply_equipment(p);
 }
 
-/**
- * Display current player status (HP, gold, stats, level)
- */
-void player_print_status(const Player *p) {
-    printf("HP: %d/%d, Gold: %d, Dmg: %d, Def: %d | Level: %d, XP: %d/%d\n",
-           p->health, p->max_health, p->gold, p->total_damage, p->total_defense,
-           p->level, p->experience, p->exp_to_next_level);
-}
-
-/**
- * Display all items in inventory with equipment markers
- */
-void player_print_inventory(const Player *p) {
-    printf("\nInventory (E = equipped):\n");
-    for (int i = 0; i < p->inv_count; ++i) {
-        int is_equipped = (p->equipped.weapon_slot == i) || (p->equipped.armor_slot == i);
-        const Item *it = &p->inventory[i];
-        
-        printf("  [%2d]%s %-14s x%-2d  %-10s",
-               i,
-               is_equipped ? " [E]" : "    ",
-               it->name,
-               it->quantity,
-               item_type_name(it->type));
-               
-        // Show stat bonuses for weapons/armor
-        if (it->stats.damage || it->stats.defense) {
-            printf("  (dmg:%d def:%d)", it->stats.damage, it->stats.defense);
-        }
-        printf("  value:%d\n", it->value);
-    }
-    printf("\n");
-}
-
 /**
  * Level up the player, increasing stats and healing to full
  */
-void player_level_up(Player *p) {
+void player_level_up(Player *p, EventLog *log) {
     p->level++;
     
     // Stat increases per level
@@ -182,10 +141,7 @@ void player_level_up(Player *p) {
     // Calculate next level requirement (exponential growth)
     p->exp_to_next_level = 100 + (p->level - 1) * 50;
     
-    printf("\n*** LEVEL UP! You are now level %d! ***\n", p->level);
-    printf("Max HP +20 (now %d), Damage +3 (now %d), Defense +2 (now %d)\n",
-           p->max_health, p->base_damage, p->base_defense);
-    printf("HP fully restored!\n\n");
+    eventlog_push(log, EV_LEVEL_UP, NULL, p->level, 0, 0);
     
     // Recalculate stats with equipment
     player_apply_equipment(p);
@@ -194,14 +150,13 @@ void player_level_up(Player *p) {
 /**
  * Award experience points and handle level ups
  */
-void player_gain_exp(Player *p, int exp) {
+void player_gain_exp(Player *p, int exp, EventLog *log) {
     p->experience += exp;
-    printf("You gained %d experience! (%d/%d)\n", exp, p->experience, p->exp_to_next_level);
     
     // Handle multiple level ups if enough XP gained
     while (p->experience >= p->exp_to_next_level) {
         p->experience -= p->exp_to_next_level;
-        player_level_up(p);
+        player_level_up(p, log);
     }
 }
 
@@ -209,143 +164,92 @@ void player_gain_exp(Player *p, int exp) {
  * Add an item to inventory, stacking consumables if possible
  * Returns 1 on success, 0 if inventory full
  */
-int player_add_item(Player *p, const Item *item) {
-    // Check if inventory is full
-    if (p->inv_count >= MAX_INVENTORY) {
-        printf("Your inventory is full! Cannot pick up %s.\n", item->name);
+int player_add_item(Player *p, int item_id, int quantity, uint32_t roll, EventLog *log) {
+    // Consumables with the same id and roll share one stack
+    int stackable = item_type(item_id) == ITEM_CONSUMABLE;
+    if (inventory_add(&p->inventory, item_id, quantity, roll, stackable) == ITEM_HANDLE_NONE) {
+        eventlog_push(log, EV_INVENTORY_FULL, NULL, item_id, 0, 0);
         return 0;
     }
-    
-    // Try to stack with existing consumables
-    if (item->type == ITEM_CONSUMABLE) {
-        for (int i = 0; i < p->inv_count; i++) {
-            if (p->inventory[i].id == item->id) {
-                p->inventory[i].quantity += item->quantity;
-                printf("Picked up %s x%d (now have %d)\n", 
-                       item->name, item->quantity, p->inventory[i].quantity);
-                return 1;
-            }
-        }
-    }
-    
-    // Add new item to inventory
-    p->inventory[p->inv_count] = *item;
-    printf("Picked up %s!\n", item->name);
-    p->inv_count++;
     return 1;
 }
 
 /**
  * Equip a weapon or armor from inventory
+ * Returns 1 if the equipment changed, 0 otherwise
  */
-void player_equip_item(Player *p, int slot) {
-    if (slot < 0 || slot >= p->inv_count) {
-        printf("Invalid inventory slot!\n");
-        return;
+int player_equip_item(Player *p, int slot, EventLog *log) {
+    const InventoryEntry *entry = inventory_slot(&p->inventory, slot);
+    if (!entry) {
+        eventlog_push(log, EV_SLOT_EMPTY, NULL, slot, 0, 0);
+        return 0;
     }
     
-    Item *item = &p->inventory[slot];
+    Item item;
+    item_resolve(entry, &item);
     
-    if (item->type == ITEM_WEAPON) {
-        // Unequip old weapon if any
-        if (p->equipped.weapon_slot != INVALID_SLOT && p->equipped.weapon_slot != slot) {
-            printf("Unequipped %s\n", p->inventory[p->equipped.weapon_slot].name);
-        }
-        p->equipped.weapon_slot = slot;
-        printf("Equipped %s (Damage +%d)\n", item->name, item->stats.damage);
-    } 
-    else if (item->type == ITEM_ARMOR) {
-        // Unequip old armor if any
-        if (p->equipped.armor_slot != INVALID_SLOT && p->equipped.armor_slot != slot) {
-            printf("Unequipped %s\n", p->inventory[p->equipped.armor_slot].name);
-        }
-        p->equipped.armor_slot = slot;
-        printf("Equipped %s (Defense +%d)\n", item->name, item->stats.defense);
-    } 
-    else {
-        printf("Cannot equip %s (not a weapon or armor)\n", item->name);
-        return;
+    ItemHandle *target;
+    if (item.type == ITEM_WEAPON) {
+        target = &p->equipped.weapon;
+    } else if (item.type == ITEM_ARMOR) {
+        target = &p->equipped.armor;
+    } else {
+        eventlog_push(log, EV_CANNOT_EQUIP, NULL, item.id, 0, 0);
+        return 0;
+    }
+    
+    ItemHandle h = inventory_handle(&p->inventory, slot);
+    if (*target == h) {
+        eventlog_push(log, EV_ALREADY_EQUIPPED, NULL, item.id, 0, 0);
+        return 0;
+    }
+    
+    // Unequip old item if any
+    int old = inventory_lookup(&p->inventory, *target);
+    if (old != INVALID_SLOT) {
+        eventlog_push(log, EV_UNEQUIPPED, NULL, p->inventory.entries[old].item_id, 0, 0);
     }
+    *target = h;
     
     // Recalculate stats with new equipment
     player_apply_equipment(p);
+    if (item.type == ITEM_WEAPON) {
+        eventlog_push(log, EV_EQUIPPED_WEAPON, NULL, item.id, p->total_damage, item.stats.damage);
+    } else {
+        eventlog_push(log, EV_EQUIPPED_ARMOR, NULL, item.id, p->total_defense, item.stats.defense);
+    }
+    return 1;
 }
 
 /**
  * Use a consumable item from inventory
  * Returns 1 if an item was used, 0 otherwise
  */
-int player_use_item(Player *p) {
-    // Show available consumables
-    int consumable_count = 0;
-    printf("\nAvailable consumables:\n");
-    for (int i = 0; i < p->inv_count; i++) {
-        if (p->inventory[i].type == ITEM_CONSUMABLE && p->inventory[i].quantity > 0) {
-            printf("  [%d] %s x%d\n", i, p->inventory[i].name, p->inventory[i].quantity);
-            consumable_count++;
-        }
-    }
-    
-    // No consumables available
-    if (consumable_count == 0) {
-        return 0;
-    }
-    
-    // Get user choice
-    printf("Enter slot number to use (or -1 to cancel): ");
-    int slot;
-    if (scanf("%d", &slot) != 1) {
+int player_use_item(Player *p, int slot, EventLog *log) {
+    const InventoryEntry *entry = inventory_slot(&p->inventory, slot);
+    if (!entry) {
+        eventlog_push(log, EV_SLOT_EMPTY, NULL, slot, 0, 0);
         return 0;
     }
     
-    // Validate choice
-    if (slot == -1) {
-        printf("Cancelled.\n");
-        return 0;
-    }
-    
-    if (slot < 0 || slot >= p->inv_count) {
-        printf("Invalid slot!\n");
-        return 0;
-    }
-    
-    Item *item = &p->inventory[slot];
+    Item item;
+    item_resolve(entry, &item);
     
-    if (item->type != ITEM_CONSUMABLE || item->quantity <= 0) {
-        printf("That item cannot be used!\n");
+    if (item.type != ITEM_CONSUMABLE) {
+        eventlog_push(log, EV_CANNOT_USE, NULL, item.id, 0, 0);
         return 0;
     }
     
     // Use the item (for now, all consumables are health potions)
-    int heal_amount = 30 + (item->value * 2);  // Scale healing with value
+    int heal_amount = 30 + (item.value * 2);  // Scale healing with value
+    int old_hp = p->health;
     p->health += heal_amount;
     if (p->health > p->max_health) {
         p->health = p->max_health;
     }
     
-    printf("Used %s! Restored %d HP. Current HP: %d/%d\n", 
-           item->name, heal_amount, p->health, p->max_health);
-    
-    // Decrease quantity
-    item->quantity--;
-    
-    // Remove item from inventory if depleted
-    if (item->quantity <= 0) {
-        printf("%s depleted!\n", item->name);
-        // Shift items down to fill the gap
-        for (int i = slot; i < p->inv_count - 1; i++) {
-            p->inventory[i] = p->inventory[i + 1];
-            
-            // Update equipment slots if they shifted
-            if (p->equipped.weapon_slot == i + 1) p->equipped.weapon_slot = i;
-            if (p->equipped.armor_slot == i + 1) p->equipped.armor_slot = i;
-        }
-        p->inv_count--;
-        
-        // Fix equipment slots if the removed item was equipped
-        if (p->equipped.weapon_slot == slot) p->equipped.weapon_slot = INVALID_SLOT;
-        if (p->equipped.armor_slot == slot) p->equipped.armor_slot = INVALID_SLOT;
-    }
-    
+    // Decrease quantity; the slot is freed once the stack runs out
+    int remaining = inventory_consume(&p->inventory, slot, 1);
+    eventlog_push(log, EV_ITEM_USED, NULL, item.id, p->health - old_hp, remaining);
     return 1;
-}
\ No newline at end of file
+}
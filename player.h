@@ -1,7 +1,9 @@
 #ifndef PLAYER_H
 #define PLAYER_H
 
-enum { MAX_INVENTORY = 24, INVALID_SLOT = -1 };
+#include <stdint.h>
+#include "eventlog.h"
+#include "inventory.h"
 
 typedef enum {
     CLASS_WARRIOR,
@@ -31,6 +33,7 @@ typedef struct {
     int defense;
 } ItemStats;
 
+// Full item view (catalog data + rolls), built on demand by item_resolve()
 typedef struct {
     int id;
     ItemType type;
@@ -41,8 +44,8 @@ typedef struct {
 } Item;
 
 typedef struct {
-    int weapon_slot; // index into inventory or -1
-    int armor_slot;  // index into inventory or -1
+    ItemHandle weapon; // inventory handle or ITEM_HANDLE_NONE
+    ItemHandle armor;  // inventory handle or ITEM_HANDLE_NONE
 } Equipment;
 
 typedef struct {
@@ -68,8 +71,7 @@ typedef struct {
     int total_defense;
 
     // Inventory & equipment
-    Item inventory[MAX_INVENTORY];
-    int inv_count;
+    Inventory inventory;
     Equipment equipped;
 } Player;
 
@@ -82,17 +84,18 @@ const char* player_class_name(PlayerClass class);
 const ClassDefinition* get_class_definition(PlayerClass class);
 const ClassDefinition* get_all_class_definitions(int *count);
 
+/*
+ * Game rules below never print. What happened is reported to the event
+ * log passed in as `log`; pass NULL to discard the events (batch runs).
+ */
+
 // Experience and leveling
-void player_gain_exp(Player *p, int exp);
-void player_level_up(Player *p);
+void player_gain_exp(Player *p, int exp, EventLog *log);
+void player_level_up(Player *p, EventLog *log);
 
 // Inventory management
-int player_add_item(Player *p, const Item *item);
-int player_use_item(Player *p);  // Returns 1 if item was used, 0 otherwise
-void player_equip_item(Player *p, int slot);
-
-// Utility display
-void player_print_status(const Player *p);
-void player_print_inventory(const Player *p);
+int player_add_item(Player *p, int item_id, int quantity, uint32_t roll, EventLog *log);
+int player_use_item(Player *p, int slot, EventLog *log);    // Returns 1 if item was used, 0 otherwise
+int player_equip_item(Player *p, int slot, EventLog *log);  // Returns 1 if equipment changed
 
 #endif
\ No newline at end of file
@@ -0,0 +1,142 @@
+#include <string.h>
+#include "rle.h"
+
+static int bit_at(const uint8_t *bits, size_t i) {
+    return (bits[i >> 3] >> (i & 7)) & 1;
+}
+
+/**
+ * First index >= pos whose bit differs from `value`, or nbits. Whole
+ * bytes and 64-bit words that are all `value` are skipped at once.
+ */
+static size_t next_change(const uint8_t *bits, size_t nbits, size_t pos, int value) {
+    const uint8_t fill = value ? 0xFF : 0x00;
+    const uint64_t fill64 = value ? ~(uint64_t)0 : 0;
+
+    // Finish the current byte bit by bit
+    while (pos < nbits && (pos & 7)) {
+        if (bit_at(bits, pos) != value) return pos;
+        pos++;
+    }
+    if (pos >= nbits) return nbits;
+    // Uniform words, then uniform bytes (a whole-word compare needs no
+    // particular byte order)
+    size_t full_bytes = nbits >> 3;
+    size_t byte = pos >> 3;
+    while (byte + 8 <= full_bytes) {
+        uint64_t word;
+        memcpy(&word, bits + byte, sizeof(word));
+        if (word != fill64) break;
+        byte += 8;
+    }
+    while (byte < full_bytes && bits[byte] == fill) {
+        byte++;
+    }
+    pos = byte << 3;
+    if (byte < full_bytes) {
+        // This byte holds the change
+        unsigned int diff = (unsigned int)(bits[byte] ^ fill);
+        return pos + (size_t)__builtin_ctz(diff);
+    }
+    // Trailing partial byte
+    while (pos < nbits && bit_at(bits, pos) == value) {
+        pos++;
+    }
+    return pos;
+}
+
+static size_t put_varint(uint8_t *out, size_t n) {
+    size_t len = 0;
+    while (n >= 0x80) {
+        out[len++] = (uint8_t)(n | 0x80);
+        n >>= 7;
+    }
+    out[len++] = (uint8_t)n;
+    return len;
+}
+
+size_t rle_encode(const uint8_t *bits, size_t nbits, uint8_t *out) {
+    size_t raw = (nbits + 7) / 8;
+    size_t len = 1;
+    size_t pos = 0;
+    int value = 0;
+    out[0] = RLE_RUNS;
+    while (pos < nbits) {
+        size_t end = next_change(bits, nbits, pos, value);
+        // A varint is at most 10 bytes; give up on runs once they can't win
+        if (len + 10 > raw) {
+            out[0] = RLE_RAW;
+            memcpy(out + 1, bits, raw);
+            if (nbits & 7) out[raw] &= (uint8_t)((1u << (nbits & 7)) - 1);  // Clear the padding bits
+            return raw + 1;
+        }
+        len += put_varint(out + len, end - pos);
+        pos = end;
+        value = !value;
+    }
+    return len;
+}
+
+int rle_decode_runs(const uint8_t *in, size_t len, size_t nbits, RleRunFn run, void *ctx) {
+    if (len == 0) return -1;
+    if (in[0] == RLE_RAW) {
+        if (len != (nbits + 7) / 8 + 1) return -1;
+        const uint8_t *bits = in + 1;
+        for (size_t pos = 0; pos < nbits;) {
+            size_t start = next_change(bits, nbits, pos, 0);
+            if (start == nbits) break;
+            size_t end = next_change(bits, nbits, start, 1);
+            if (run) run(ctx, start, end - start);
+            pos = end;
+        }
+        return 0;
+    }
+    if (in[0] != RLE_RUNS) return -1;
+
+    size_t i = 1, pos = 0;
+    int value = 0;
+    while (pos < nbits) {
+        uint64_t n = 0;
+        int shift = 0;
+        for (;;) {
+            if (i >= len || shift > 56) return -1;
+            uint8_t b = in[i++];
+            n |= (uint64_t)(b & 0x7F) << shift;
+            if (!(b & 0x80)) break;
+            shift += 7;
+        }
+        if (n > nbits - pos) return -1;
+        if (value && n && run) run(ctx, pos, (size_t)n);
+        pos += (size_t)n;
+        value = !value;
+    }
+    return i == len ? 0 : -1;
+}
+
+static void set_run(void *ctx, size_t start, size_t count) {
+    uint8_t *bits = ctx;
+    size_t end = start + count;
+    // Leading partial byte, whole bytes, trailing partial byte
+    while (start < end && (start & 7)) {
+        bits[start >> 3] |= (uint8_t)(1u << (start & 7));
+        start++;
+    }
+    if (end - start >= 8) {
+        memset(bits + (start >> 3), 0xFF, (end - start) >> 3);
+        start += (end - start) & ~(size_t)7;
+    }
+    while (start < end) {
+        bits[start >> 3] |= (uint8_t)(1u << (start & 7));
+        start++;
+    }
+}
+
+int rle_decode(const uint8_t *in, size_t len, uint8_t *bits, size_t nbits) {
+    size_t raw = (nbits + 7) / 8;
+    if (len == raw + 1 && in[0] == RLE_RAW) {
+        memcpy(bits, in + 1, raw);
+        return 0;
+    }
+    memset(bits, 0, raw);
+    return rle_decode_runs(in, len, nbits, set_run, bits);
+}
@@ -0,0 +1,40 @@
+#ifndef RLE_H
+#define RLE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Run-length coding for bit layers (visited and looted tiles in saves).
+ *
+ * A layer is a bitset, bit i = byte i/8, bit i%8. Explored maps are long
+ * runs of 0 broken by a winding trail of 1s, so the layer is stored as
+ * alternating run lengths (0s first, then 1s, ...) in LEB128 varints: a
+ * few hundred bytes instead of one bit per tile. Noisy layers that would
+ * come out larger are stored raw instead, so the result never exceeds
+ * RLE_MAX_BYTES.
+ *
+ * Encoding skips uniform 64-bit words at a time. Decoding hands out runs
+ * of 1s, so callers can write them straight into their own layout.
+ */
+
+enum { RLE_RUNS = 0, RLE_RAW = 1 };  // First byte of an encoded layer
+
+// Largest encoding of an `nbits` layer (format byte plus the raw bitset)
+#define RLE_MAX_BYTES(nbits) (((nbits) + 7) / 8 + 1)
+
+// Encode `nbits` bits into `out` (at least RLE_MAX_BYTES(nbits) bytes).
+// Returns the encoded length.
+size_t rle_encode(const uint8_t *bits, size_t nbits, uint8_t *out);
+
+// Called once per run of 1s: bits [start, start + count)
+typedef void (*RleRunFn)(void *ctx, size_t start, size_t count);
+
+// Decode, calling `run` (may be NULL to only validate) for every run of
+// 1s. Returns 0, or -1 if the data is malformed or not `nbits` long.
+int rle_decode_runs(const uint8_t *in, size_t len, size_t nbits, RleRunFn run, void *ctx);
+
+// Decode into a bitset of `nbits` bits. Returns 0, or -1 if malformed.
+int rle_decode(const uint8_t *in, size_t len, uint8_t *bits, size_t nbits);
+
+#endif
@@ -0,0 +1,19 @@
+#include <stdlib.h>
+#include "rng.h"
+
+static _Thread_local Rng *current;  // Generator this thread draws from (NULL = rand())
+
+void rng_seed(Rng *rng, uint64_t seed) {
+    // splitmix64, so that nearby seeds (session numbers) start far apart
+    uint64_t z = splitmix64(seed + SPLITMIX64_GAMMA);
+    rng->state = z ? z : 1;
+}
+
+void rng_set_current(Rng *rng) {
+    current = rng;
+}
+
+int rng_rand(void) {
+    if (!current) return rand();
+    return (int)(rng_next(current) >> 33);
+}
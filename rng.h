@@ -0,0 +1,53 @@
+#ifndef RNG_H
+#define RNG_H
+
+#include <stdint.h>
+
+/*
+ * Random numbers for the game rules: combat rolls, room events, loot.
+ *
+ * Game code calls rng_rand() rather than rand(). A thread that has picked
+ * a generator with rng_set_current() draws from that; otherwise rng_rand()
+ * is rand(), so the terminal game still follows its srand(). Server
+ * sessions each own an Rng and select it while they run a command (like
+ * ui_set_target() for output), so sessions on different worker threads
+ * share no state and each session's rolls do not depend on scheduling.
+ */
+
+#define RNG_MAX 0x7FFFFFFF  // rng_rand() range, the same as glibc's RAND_MAX
+#define SPLITMIX64_GAMMA 0x9E3779B97F4A7C15ULL  // splitmix64's step (2^64 / golden ratio)
+
+typedef struct {
+    uint64_t state;  // xorshift64*; never zero
+} Rng;
+
+/*
+ * The two generator primitives every module shares. Inline, so the world
+ * generator and the state hash keep them in their inner loops.
+ */
+
+// xorshift64*: advance `rng` and return 64 bits, the high ones best
+static inline uint64_t rng_next(Rng *rng) {
+    rng->state ^= rng->state >> 12;
+    rng->state ^= rng->state << 25;
+    rng->state ^= rng->state >> 27;
+    return rng->state * 0x2545F4914F6CDD1DULL;
+}
+
+// splitmix64 finalizer: every input bit affects every output bit. Adding
+// SPLITMIX64_GAMMA first gives splitmix64's own output for that state.
+static inline uint64_t splitmix64(uint64_t z) {
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+void rng_seed(Rng *rng, uint64_t seed);
+
+// Draw from `rng` on this thread from now on (NULL = back to rand())
+void rng_set_current(Rng *rng);
+
+// Uniform in 0..RNG_MAX
+int rng_rand(void);
+
+#endif
@@ -0,0 +1,409 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "metrics.h"
+#include "rle.h"
+#include "save.h"
+#include "trace.h"
+#include "zobrist.h"
+
+#define SAVE_MAGIC "ADVSAVE1"
+#define SAVE_VERSION 4  // 2: run-length coded layers, 3: state hash, 4: header checksummed
+#define SAVE_LAYER_MAX RLE_MAX_BYTES(SAVE_LAYER_BITS)
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t map_size;
+    uint32_t player_size;     // sizeof(Player) of the writing build
+    uint32_t seed;
+    int32_t pos_x;
+    int32_t pos_y;
+    uint32_t visited_bytes;   // Encoded visited layer following the player
+    uint32_t looted_bytes;    // Encoded looted layer following that
+    uint64_t state_hash;      // zobrist_state() of the saved game
+    uint64_t checksum;        // FNV-1a of the header (this field zeroed) and everything after it
+} SaveHeader;
+
+// Snapshot handed from the main loop to the writer thread
+struct SaveSnapshot {
+    SaveHeader header;
+    Player player;
+    uint32_t content_count;     // Occupied slots copied into `content`
+    uint32_t content_capacity;  // Size of the content buffer, in slots
+    TileSlot *content;
+    // Writer-thread scratch: both layers and their encodings
+    uint8_t visited[SAVE_VISITED_BYTES];
+    uint8_t looted[SAVE_VISITED_BYTES];
+    uint8_t encoded[2 * SAVE_LAYER_MAX];
+};
+
+static uint64_t fnv1a(uint64_t h, const void *data, size_t len) {
+    const unsigned char *p = data;
+    for (size_t i = 0; i < len; i++) {
+        h ^= p[i];
+        h *= 0x100000001B3ULL;
+    }
+    return h;
+}
+
+#define FNV_OFFSET 0xCBF29CE484222325ULL
+
+// The checksum a file should carry: header with `checksum` zeroed, player, layers
+static uint64_t save_checksum(const SaveHeader *header, const Player *player,
+                              const uint8_t *layers, size_t layer_bytes) {
+    SaveHeader h = *header;
+    h.checksum = 0;
+    uint64_t sum = fnv1a(FNV_OFFSET, &h, sizeof(h));
+    sum = fnv1a(sum, player, sizeof(Player));
+    return fnv1a(sum, layers, layer_bytes);
+}
+
+// ---------------------------------------------------------------------------
+// Loading
+// ---------------------------------------------------------------------------
+
+static int read_full(int fd, void *buf, size_t len) {
+    unsigned char *p = buf;
+    while (len > 0) {
+        ssize_t n = read(fd, p, len);
+        if (n <= 0) return -1;
+        p += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+int save_read(const char *path, SaveGame *out, char *err, size_t err_size) {
+    memset(out, 0, sizeof(*out));
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        snprintf(err, err_size, "%s: no save file", path);
+        return -1;
+    }
+
+    SaveHeader h;
+    const char *problem = NULL;
+    if (read_full(fd, &h, sizeof(h)) != 0 || memcmp(h.magic, SAVE_MAGIC, sizeof(h.magic)) != 0) {
+        problem = "not a save file";
+    } else if (h.version != SAVE_VERSION || h.map_size != MAP_SIZE || h.player_size != sizeof(Player)) {
+        problem = "written by a different build";
+    } else if (h.visited_bytes > SAVE_LAYER_MAX || h.looted_bytes > SAVE_LAYER_MAX) {
+        problem = "damaged (bad layer size)";
+    } else {
+        size_t layer_bytes = (size_t)h.visited_bytes + h.looted_bytes;
+        out->layers = malloc(layer_bytes ? layer_bytes : 1);
+        if (!out->layers) {
+            problem = "out of memory";
+        } else if (read_full(fd, &out->player, sizeof(Player)) != 0 ||
+                   read_full(fd, out->layers, layer_bytes) != 0) {
+            problem = "damaged (truncated)";
+        } else {
+            if (save_checksum(&h, &out->player, out->layers, layer_bytes) != h.checksum) {
+                problem = "damaged (checksum mismatch)";
+            } else if (rle_decode_runs(out->layers, h.visited_bytes, SAVE_LAYER_BITS, NULL, NULL) != 0 ||
+                       rle_decode_runs(out->layers + h.visited_bytes, h.looted_bytes,
+                                       SAVE_LAYER_BITS, NULL, NULL) != 0) {
+                problem = "damaged (bad layer encoding)";
+            }
+        }
+    }
+    close(fd);
+
+    if (problem) {
+        snprintf(err, err_size, "%s: %s", path, problem);
+        save_release(out);
+        return -1;
+    }
+    out->seed = h.seed;
+    out->pos = (Position){h.pos_x, h.pos_y};
+    out->visited_bytes = h.visited_bytes;
+    out->looted_bytes = h.looted_bytes;
+    out->state_hash = h.state_hash;
+    return 0;
+}
+
+// Decoder callbacks: a run of tiles, row-major from `start`
+static void apply_visited(void *ctx, size_t start, size_t count) {
+    Map *map = ctx;
+    int x = (int)(start % MAP_SIZE), y = (int)(start / MAP_SIZE);
+    for (size_t i = 0; i < count; i++) {
+        map_set_visited(map, x, y, 1);
+        if (++x == MAP_SIZE) {
+            x = 0;
+            y++;
+        }
+    }
+}
+
+static void apply_looted(void *ctx, size_t start, size_t count) {
+    Map *map = ctx;
+    for (size_t i = start; i < start + count; i++) {
+        map_set_looted(map, (int)(i % MAP_SIZE), (int)(i / MAP_SIZE), 1);
+    }
+}
+
+int save_apply(const SaveGame *save, Map *map) {
+    rle_decode_runs(save->layers, save->visited_bytes, SAVE_LAYER_BITS, apply_visited, map);
+    rle_decode_runs(save->layers + save->visited_bytes, save->looted_bytes,
+                    SAVE_LAYER_BITS, apply_looted, map);
+    return zobrist_state(map, &save->player, save->pos) == save->state_hash ? 0 : -1;
+}
+
+void save_release(SaveGame *save) {
+    free(save->layers);
+    save->layers = NULL;
+    save->visited_bytes = save->looted_bytes = 0;
+}
+
+// ---------------------------------------------------------------------------
+// Writing (writer thread)
+// ---------------------------------------------------------------------------
+
+static int write_full(int fd, const void *buf, size_t len) {
+    const unsigned char *p = buf;
+    while (len > 0) {
+        ssize_t n = write(fd, p, len);
+        if (n <= 0) return -1;
+        p += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+/**
+ * Encode the visited and looted layers into snap->encoded and fill in
+ * the header's sizes and checksum. Returns the encoded length.
+ */
+static size_t encode_snapshot(SaveSnapshot *snap) {
+    memset(snap->visited, 0, sizeof(snap->visited));
+    memset(snap->looted, 0, sizeof(snap->looted));
+    for (uint32_t i = 0; i < snap->content_count; i++) {
+        const TileSlot *slot = &snap->content[i];
+        uint32_t bit = slot->key - 1;  // key = row-major tile index + 1
+        uint8_t mask = (uint8_t)(1u << (bit & 7));
+        if (slot->flags & TILE_VISITED) snap->visited[bit >> 3] |= mask;
+        if (slot->flags & TILE_LOOTED) snap->looted[bit >> 3] |= mask;
+    }
+
+    SaveHeader *h = &snap->header;
+    size_t visited = rle_encode(snap->visited, SAVE_LAYER_BITS, snap->encoded);
+    size_t looted = rle_encode(snap->looted, SAVE_LAYER_BITS, snap->encoded + visited);
+    h->visited_bytes = (uint32_t)visited;
+    h->looted_bytes = (uint32_t)looted;
+    h->checksum = save_checksum(h, &snap->player, snap->encoded, visited + looted);
+    return visited + looted;
+}
+
+/**
+ * Write a snapshot to `path` crash-safely: temp file, fsync, rename, then
+ * fsync the directory so the rename itself is durable.
+ */
+static int write_snapshot(const char *path, SaveSnapshot *snap) {
+    TRACE_SCOPE("autosave_write");
+    SaveHeader *h = &snap->header;
+    size_t encoded = encode_snapshot(snap);
+
+    char tmp[272];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    int fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return -1;
+    int ok = write_full(fd, h, sizeof(*h)) == 0 &&
+             write_full(fd, &snap->player, sizeof(Player)) == 0 &&
+             write_full(fd, snap->encoded, encoded) == 0 &&
+             fsync(fd) == 0;
+    if (close(fd) != 0) ok = 0;
+    if (!ok || rename(tmp, path) != 0) {
+        unlink(tmp);
+        return -1;
+    }
+
+    // Directory containing `path`
+    char dir[256];
+    const char *slash = strrchr(path, '/');
+    if (slash) {
+        snprintf(dir, sizeof(dir), "%.*s", (int)(slash - path + 1), path);
+    } else {
+        snprintf(dir, sizeof(dir), ".");
+    }
+    int dfd = open(dir, O_RDONLY);
+    if (dfd >= 0) {
+        fsync(dfd);
+        close(dfd);
+    }
+    return 0;
+}
+
+static void *writer_main(void *arg) {
+    Autosave *as = arg;
+    pthread_mutex_lock(&as->lock);
+    for (;;) {
+        while (!as->pending && !as->stop) {
+            pthread_cond_wait(&as->wake, &as->lock);
+        }
+        if (!as->pending) break;  // Stopping and nothing left to write
+        as->writing = as->pending;
+        as->pending = NULL;
+        pthread_mutex_unlock(&as->lock);
+
+        uint64_t start = metrics_now_ns();
+        int result = write_snapshot(as->path, as->writing);
+        uint64_t elapsed = metrics_now_ns() - start;
+
+        pthread_mutex_lock(&as->lock);
+        if (as->completed < (int)(sizeof(as->write_ns) / sizeof(as->write_ns[0]))) {
+            as->write_ns[as->completed] = elapsed;
+        }
+        as->completed++;
+        if (result != 0) {
+            as->failed++;
+        } else {
+            const SaveHeader *h = &as->writing->header;
+            as->file_bytes = sizeof(*h) + sizeof(Player) + h->visited_bytes + h->looted_bytes;
+        }
+        as->writing = NULL;
+    }
+    pthread_mutex_unlock(&as->lock);
+    return NULL;
+}
+
+// ---------------------------------------------------------------------------
+// Main-thread side
+// ---------------------------------------------------------------------------
+
+int autosave_init(Autosave *as, const char *path, int every_moves) {
+    memset(as, 0, sizeof(*as));
+    if (!path) path = "adventure.sav";
+    if (path[0] == '\0' || every_moves <= 0) return -1;
+    snprintf(as->path, sizeof(as->path), "%s", path);
+
+    as->buffers[0] = calloc(1, sizeof(SaveSnapshot));
+    as->buffers[1] = calloc(1, sizeof(SaveSnapshot));
+    pthread_mutex_init(&as->lock, NULL);
+    pthread_cond_init(&as->wake, NULL);
+    if (!as->buffers[0] || !as->buffers[1] ||
+        pthread_create(&as->thread, NULL, writer_main, as) != 0) {
+        free(as->buffers[0]);
+        free(as->buffers[1]);
+        pthread_mutex_destroy(&as->lock);
+        pthread_cond_destroy(&as->wake);
+        memset(as, 0, sizeof(*as));
+        return -1;
+    }
+    as->every_moves = every_moves;
+    as->started = 1;
+    return 0;
+}
+
+void autosave_reset(Autosave *as) {
+    as->moves = 0;
+}
+
+/**
+ * Copy the game state into `snap`. Only the occupied content slots are
+ * copied; the buffer grows (on this thread) when the table has.
+ * Returns 0 on success, -1 if out of memory.
+ */
+static int capture(SaveSnapshot *snap, const Player *player,
+                   const Position *pos, const Map *map) {
+    if (snap->content_capacity < map->content_count || !snap->content) {
+        uint32_t capacity = map->content_count > 64 ? map->content_count * 2 : 64;
+        TileSlot *grown = realloc(snap->content, capacity * sizeof(TileSlot));
+        if (!grown) return -1;
+        snap->content = grown;
+        snap->content_capacity = capacity;
+    }
+    uint32_t n = 0;
+    for (uint32_t i = 0; i < map->content_capacity; i++) {
+        if (map->content[i].key != 0) snap->content[n++] = map->content[i];
+    }
+
+    SaveHeader *h = &snap->header;
+    memset(h, 0, sizeof(*h));
+    memcpy(h->magic, SAVE_MAGIC, sizeof(h->magic));
+    h->version = SAVE_VERSION;
+    h->map_size = MAP_SIZE;
+    h->player_size = sizeof(Player);
+    h->seed = map->seed;
+    h->pos_x = pos->x;
+    h->pos_y = pos->y;
+    h->state_hash = zobrist_state(map, player, *pos);
+    snap->content_count = n;
+    snap->player = *player;
+    return 0;
+}
+
+// Report writes that finished since the last call to the metrics
+static void report_writes(Autosave *as) {
+    pthread_mutex_lock(&as->lock);
+    int completed = as->completed, failed = as->failed;
+    uint64_t file_bytes = as->file_bytes;
+    uint64_t write_ns[8];
+    memcpy(write_ns, as->write_ns, sizeof(write_ns));
+    as->completed = as->failed = 0;
+    pthread_mutex_unlock(&as->lock);
+    for (int i = 0; i < completed && i < 8; i++) {
+        metrics_observe(METRIC_AUTOSAVE_WRITE, write_ns[i]);
+    }
+    metrics_count(METRIC_AUTOSAVES, (uint64_t)(completed - failed));
+    metrics_count(METRIC_AUTOSAVE_FAILURES, (uint64_t)failed);
+    if (completed > failed) metrics_set(METRIC_SAVE_FILE_BYTES, file_bytes);
+}
+
+void autosave_tick(Autosave *as, int moved, int force, const Player *player, const Position *pos, const Map *map) {
+    if (!as->started) return;
+    if (moved) as->moves++;
+    report_writes(as);
+
+    if (!force && as->moves < as->every_moves) return;
+
+    uint64_t start = metrics_now_ns();
+    pthread_mutex_lock(&as->lock);
+    SaveSnapshot *snap = NULL;
+    if (!as->pending) {
+        // Whichever buffer the writer isn't using
+        snap = as->buffers[0] == as->writing ? as->buffers[1] : as->buffers[0];
+    }
+    pthread_mutex_unlock(&as->lock);
+    if (!snap) {
+        metrics_count(METRIC_AUTOSAVES_DEFERRED, 1);  // Writer still busy; try next turn
+        return;
+    }
+
+    // The writer never touches a buffer that is neither pending nor writing,
+    // so the copy happens without holding the lock
+    if (capture(snap, player, pos, map) != 0) {
+        metrics_count(METRIC_AUTOSAVE_FAILURES, 1);
+        return;
+    }
+    pthread_mutex_lock(&as->lock);
+    as->pending = snap;
+    pthread_mutex_unlock(&as->lock);
+    // Measure before waking the writer: on a single core the wakeup can
+    // hand it the CPU, which is scheduling, not time spent saving
+    metrics_observe_since(METRIC_AUTOSAVE_STALL, start);
+    pthread_cond_signal(&as->wake);
+    as->moves = 0;
+}
+
+void autosave_shutdown(Autosave *as) {
+    if (!as->started) return;
+    pthread_mutex_lock(&as->lock);
+    as->stop = 1;
+    pthread_cond_signal(&as->wake);
+    pthread_mutex_unlock(&as->lock);
+    pthread_join(as->thread, NULL);
+    report_writes(as);
+
+    for (int i = 0; i < 2; i++) {
+        free(as->buffers[i]->content);
+        free(as->buffers[i]);
+    }
+    pthread_mutex_destroy(&as->lock);
+    pthread_cond_destroy(&as->wake);
+    as->started = 0;
+}
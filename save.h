@@ -0,0 +1,93 @@
+#ifndef SAVE_H
+#define SAVE_H
+
+#include <stdint.h>
+#include <pthread.h>
+#include "dungeon.h"
+#include "player.h"
+
+/*
+ * Save files and asynchronous autosave.
+ *
+ * A save holds what can't be re-derived: the world seed (the maze, bosses,
+ * shrines and all unvisited content follow from it), the player, their
+ * position, and which tiles were visited and consumed. Those two layers
+ * are run-length coded (rle.h), so a save is a few KB even on a 500x500
+ * map. Files are only valid for the build that wrote them (same MAP_SIZE
+ * and Player layout).
+ *
+ * Autosave splits the work: the main loop copies the state into one of
+ * two snapshot buffers (a few KB, microseconds) and a writer thread does
+ * the slow part - serialise, write, fsync, rename. The file is written
+ * under a temporary name and renamed over the old one only after fsync,
+ * so a crash mid-save always leaves the previous save intact.
+ */
+
+#define SAVE_LAYER_BITS (MAP_SIZE * MAP_SIZE)             // Row-major bit per tile
+#define SAVE_VISITED_BYTES ((SAVE_LAYER_BITS + 7) / 8)
+
+// A save file loaded into memory by save_read()
+typedef struct {
+    uint32_t seed;
+    Player player;
+    Position pos;
+    uint32_t visited_bytes;  // Encoded visited layer at the start of `layers`
+    uint32_t looted_bytes;   // Encoded looted layer right after it
+    uint8_t *layers;
+    uint64_t state_hash;     // zobrist_state() when saved
+} SaveGame;
+
+// Read and verify a save file. Returns 0 on success; -1 if it is missing,
+// damaged or from a different build (err describes which).
+int save_read(const char *path, SaveGame *out, char *err, size_t err_size);
+
+// Decode the visited and consumed flags of a loaded save straight into
+// `map`, which must be freshly generated from save->seed. Returns 0, or -1
+// if the map, saved player and position do not hash to save->state_hash:
+// the save is damaged and the map must be started afresh.
+int save_apply(const SaveGame *save, Map *map);
+
+void save_release(SaveGame *save);
+
+typedef struct SaveSnapshot SaveSnapshot;
+
+typedef struct {
+    char path[256];
+    int every_moves;              // Autosave after this many moves (0 = off)
+    int moves;                    // Moves since the last snapshot
+
+    // Shared with the writer thread (under lock)
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    int started;
+    int stop;
+    SaveSnapshot *buffers[2];
+    SaveSnapshot *pending;        // Captured, waiting for the writer
+    SaveSnapshot *writing;        // Being written now
+    int completed;                // Writes finished since the main thread last looked
+    int failed;                   // ... of which failed
+    uint64_t write_ns[8];         // Durations of those writes (first 8)
+    uint64_t file_bytes;          // Size of the last file written
+} Autosave;
+
+// Start the writer thread. A NULL path selects "adventure.sav"; an empty
+// path or every_moves <= 0 turns autosave off. Returns 0 when enabled.
+int autosave_init(Autosave *as, const char *path, int every_moves);
+
+// Start counting moves afresh (new or resumed game)
+void autosave_reset(Autosave *as);
+
+/**
+ * Call once per turn from the main loop. Counts moves and, once
+ * every_moves have passed (or `force` is set), hands a snapshot to the
+ * writer. Never waits for a write: if the writer is still busy with an
+ * older snapshot the save is retried on a later turn.
+ * Also reports finished writes to the metrics.
+ */
+void autosave_tick(Autosave *as, int moved, int force, const Player *player, const Position *pos, const Map *map);
+
+// Wait for any queued save to finish and stop the writer
+void autosave_shutdown(Autosave *as);
+
+#endif
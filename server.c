@@ -0,0 +1,821 @@
+/**
+ * server.c - Serve many games from one process over a socket.
+ *
+ * Usage: adventure_server [address]
+ *   address  Unix socket path (default adventure.sock), or host:port /
+ *            :port for TCP
+ *
+ * Every connection is its own game (a Session). Clients send one command
+ * per line, exactly what they would type at the terminal game; each
+ * response is the next screen, ending in a NUL byte. Try it with
+ *   nc -U adventure.sock      or      ./server_load adventure.sock 100
+ *
+ * One thread multiplexes all connections with epoll and only moves bytes:
+ * sockets are non-blocking, and a session with a complete line is handed
+ * to a work-stealing pool of worker threads (workpool.h; one per core, or
+ * $ADVENTURE_WORKERS) that runs its commands and sends the output. A
+ * session is on at most one worker at a time, so its commands run in
+ * order, and a worker yields after each command while others wait, so
+ * one busy session does not hold up the rest. Output a client is slow to
+ * take is kept and sent when the socket becomes writable. Every 10
+ * seconds (and on exit) it prints the number of sessions, command latency
+ * percentiles and how many sessions one core would hold at the current
+ * load.
+ *
+ * A session idle for $ADVENTURE_IDLE_SECONDS (default 600; 0 = never) is
+ * hibernated: its changes go to a file in $ADVENTURE_HIBERNATE_DIR
+ * (default: the current directory) and its memory is freed. The next
+ * line the player sends wakes it before running, so resident memory
+ * follows active players rather than connected ones.
+ *
+ * A client can watch a game instead of playing: "watch" at the class menu
+ * lists the games in progress and "watch <id>" follows one (session.h).
+ * Players publish a snapshot after each command while watched
+ * (spectate.h) and spectators draw from it, up to 10 frames a second,
+ * on their own thread ($ADVENTURE_SPECTATOR_THREADS, default 1), so
+ * spectators neither lock the player's session nor take worker time
+ * from the players.
+ *
+ * Sessions play on a pool of shared, read-only worlds (world.h) handed out
+ * in rotation; each session keeps only its own changes, so one more player
+ * costs kilobytes. $ADVENTURE_WORLDS sets the pool size (default 8) and
+ * $ADVENTURE_WORLD_DIR a directory to cache the worlds in, so that several
+ * server processes map the same files.
+ *
+ * Reads gamedata.bin (or $ADVENTURE_DATA) like the game does, and reloads
+ * it when the file changes so a running server can be retuned: commands
+ * already running finish on the old table, the next ones use the new one,
+ * and a rejected file leaves the old one in place. Reloads and rejections
+ * are reported on stderr. Writes metrics.prom ($ADVENTURE_METRICS) on exit
+ * or SIGUSR1.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <dirent.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+#include "gamedata.h"
+#include "metrics.h"
+#include "net.h"
+#include "session.h"
+#include "workpool.h"
+
+#define INPUT_BYTES 4096           // Command bytes buffered per connection
+#define OUTPUT_HIGH_WATER 65536    // Stop running commands while this much is unsent
+#define LATENCY_SAMPLES 65536      // Ring of recent command latencies (power of two)
+#define REPORT_EVERY_NS 10000000000ULL
+#define FRAME_EVERY_MS 100         // Spectators get at most one frame per period
+
+/*
+ * A connection belongs to the loop thread while idle and to one worker
+ * while `busy` (from dispatch() until the loop takes the done hand-back).
+ * Only the input buffer is touched by both, under `lock`.
+ */
+typedef struct Connection {
+    int fd;
+    Session session;
+    pthread_mutex_t lock;
+    char in[INPUT_BYTES];  // Received, not yet run (under lock)
+    size_t in_len;
+    int skipping;          // Dropping the rest of an over-long line, up to its newline (under lock)
+    // Owner's (loop or worker)
+    size_t sent;           // Bytes of session.out already written
+    int broken;            // A send failed
+    uint64_t queued_ns;    // When the session last went on a queue
+    struct Connection *next_done;
+    unsigned long id;      // Names its hibernation file; spectators watch it by this
+    // Loop thread's
+    int busy;
+    int hung_up;           // Peer left while busy: close once handed back
+    uint32_t events;       // Current epoll interest
+    uint64_t active_ns;    // When the player last sent something
+    struct Connection *older, *newer;  // Place in `list`
+    struct ConnList *list;             // idle, watchers or none
+} Connection;
+
+// Awake sessions, least recently active first (idle), or spectators (watchers)
+typedef struct ConnList {
+    Connection *oldest;
+    Connection *newest;
+} ConnList;
+
+// Sessions workers have finished with, for the loop thread to take back
+typedef struct {
+    pthread_mutex_t lock;
+    Connection *head;
+    int fd;                // eventfd the loop waits on
+} DoneList;
+
+typedef struct {
+    _Atomic uint64_t ns[LATENCY_SAMPLES];
+    _Atomic uint64_t count;  // Samples ever recorded
+    uint64_t reported;     // `count` at the last report
+    uint64_t report_ns;    // metrics_now_ns() of the last report
+    double cpu_seconds;    // Process CPU time at the last report
+    uint64_t steals;       // Worker steals at the last report
+    _Atomic uint64_t wakes;        // Sessions woken since the last report
+    _Atomic uint64_t wake_max_ns;  // ... and the slowest of them
+} LatencyLog;
+
+static volatile sig_atomic_t stop_requested;
+static int active_sessions;
+static int peak_sessions;  // Most sessions at once since the last report
+static atomic_int resident_sessions;  // Connected and not hibernated
+static uint64_t next_seed;  // Dice seed for the next session
+static unsigned long next_id;
+static uint64_t idle_ns;    // Hibernate after this long without input (0 = never)
+static char hibernate_dir[256];
+static ConnList idle;
+static ConnList watchers;
+static uint64_t frame_ns;   // When spectators were last offered frames
+static WorldPool worlds;
+static WorkPool workers;
+static WorkPool viewers;    // Draws spectator frames
+static DoneList done = {.lock = PTHREAD_MUTEX_INITIALIZER, .fd = -1};
+static int data_watch;      // Its address marks the game data watch in epoll
+static LatencyLog latency;
+
+static void handle_stop(int sig) {
+    (void)sig;
+    stop_requested = 1;
+}
+
+static double cpu_seconds(void) {
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return (double)(ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) +
+           (double)(ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) / 1e6;
+}
+
+// Resident memory from /proc/self/statm (Linux), or -1
+static long resident_kb(void) {
+    FILE *f = fopen("/proc/self/statm", "r");
+    long size, pages = -1;
+    if (!f) return -1;
+    if (fscanf(f, "%ld %ld", &size, &pages) != 2) pages = -1;
+    fclose(f);
+    return pages < 0 ? -1 : pages * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+static int compare_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * Print sessions (connected and resident), throughput and latency
+ * percentiles for the commands since the last report (up to the last
+ * LATENCY_SAMPLES of them), and how many hibernated sessions woke.
+ * Sessions per core extrapolates from the CPU time the server used and
+ * the most sessions connected: at 5% of a core for 100 sessions, one
+ * core would hold about 2000 of them.
+ */
+static void report(void) {
+    uint64_t now = metrics_now_ns();
+    double cpu = cpu_seconds();
+    double wall = (double)(now - latency.report_ns) / 1e9;
+    double busy = wall > 0 ? (cpu - latency.cpu_seconds) / wall : 0;
+    uint64_t count = atomic_load(&latency.count);
+    uint64_t commands = count - latency.reported;
+
+    size_t n = commands < LATENCY_SAMPLES ? (size_t)commands : LATENCY_SAMPLES;
+    uint64_t p50 = 0, p99 = 0;
+    if (n > 0) {
+        uint64_t *sorted = malloc(n * sizeof(*sorted));
+        if (sorted) {
+            for (size_t i = 0; i < n; i++) {
+                sorted[i] = atomic_load_explicit(&latency.ns[(count - 1 - i) & (LATENCY_SAMPLES - 1)],
+                                                 memory_order_relaxed);
+            }
+            qsort(sorted, n, sizeof(*sorted), compare_u64);
+            p50 = sorted[n / 2];
+            p99 = sorted[n * 99 / 100];
+            free(sorted);
+        }
+    }
+    fprintf(stderr, "sessions %d (peak %d, resident %d)  commands %llu (%.0f/s)  p50 %.1f us  p99 %.1f us  cpu %.1f%%",
+            active_sessions, peak_sessions, atomic_load(&resident_sessions),
+            (unsigned long long)commands, wall > 0 ? (double)commands / wall : 0,
+            (double)p50 / 1e3, (double)p99 / 1e3, busy * 100);
+    if (peak_sessions > 0 && busy > 0) {
+        fprintf(stderr, "  sessions/core %.0f", peak_sessions / busy);
+    }
+    uint64_t wakes = atomic_exchange(&latency.wakes, 0);
+    uint64_t wake_max = atomic_exchange(&latency.wake_max_ns, 0);
+    if (wakes > 0) fprintf(stderr, "  wakes %llu (max %.1f us)", (unsigned long long)wakes, (double)wake_max / 1e3);
+    uint64_t steals = 0;
+    for (int i = 0; i < workers.size; i++) steals += atomic_load(&workers.workers[i].steals);
+    fprintf(stderr, "  steals %llu", (unsigned long long)(steals - latency.steals));
+    latency.steals = steals;
+    long resident = resident_kb();
+    if (resident > 0) fprintf(stderr, "  rss %ld KB", resident);
+    fprintf(stderr, "\n");
+
+    latency.reported = count;
+    latency.report_ns = now;
+    latency.cpu_seconds = cpu;
+    peak_sessions = active_sessions;
+}
+
+static void set_interest(int epfd, Connection *c, uint32_t events) {
+    if (events == c->events) return;
+    struct epoll_event ev = {.events = events, .data.ptr = c};
+    epoll_ctl(epfd, EPOLL_CTL_MOD, c->fd, &ev);
+    c->events = events;
+}
+
+static void hibernate_path(const Connection *c, char *path, size_t size) {
+    snprintf(path, size, "%s/session-%ld-%lu.hib", hibernate_dir, (long)getpid(), c->id);
+}
+
+static void unlist(Connection *c) {
+    ConnList *list = c->list;
+    if (!list) return;
+    if (c->older) c->older->newer = c->newer;
+    else list->oldest = c->newer;
+    if (c->newer) c->newer->older = c->older;
+    else list->newest = c->older;
+    c->older = c->newer = NULL;
+    c->list = NULL;
+}
+
+static void list_append(ConnList *list, Connection *c) {
+    unlist(c);
+    c->older = list->newest;
+    if (list->newest) list->newest->newer = c;
+    else list->oldest = c;
+    list->newest = c;
+    c->list = list;
+}
+
+// The player did something (or hibernating must wait): to the back of the
+// list. Spectators are never hibernated and stay off it.
+static void idle_touch(Connection *c) {
+    if (c->list == &watchers) return;
+    c->active_ns = metrics_now_ns();
+    list_append(&idle, c);
+}
+
+// Spectators' commands and frames run on their own pool
+static WorkPool *pool_for(const Connection *c) {
+    return c->list == &watchers ? &viewers : &workers;
+}
+
+static void set_resident(int delta) {
+    int now = atomic_fetch_add(&resident_sessions, delta) + delta;
+    metrics_set(METRIC_SESSIONS_RESIDENT, (uint64_t)now);
+}
+
+static void close_connection(int epfd, Connection *c) {
+    epoll_ctl(epfd, EPOLL_CTL_DEL, c->fd, NULL);
+    close(c->fd);
+    unlist(c);
+    if (c->session.hibernated) {
+        char path[512];
+        hibernate_path(c, path, sizeof(path));
+        unlink(path);
+    } else {
+        set_resident(-1);
+    }
+    session_free(&c->session);
+    pthread_mutex_destroy(&c->lock);
+    free(c);
+    active_sessions--;
+    metrics_set(METRIC_SESSIONS_ACTIVE, (uint64_t)active_sessions);
+}
+
+// Write as much pending output as the socket takes. Returns -1 if the
+// peer is gone.
+static int flush_output(Connection *c) {
+    UiBuffer *out = &c->session.out;
+    while (c->sent < out->len) {
+        ssize_t n = send(c->fd, out->data + c->sent, out->len - c->sent, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+            return -1;
+        }
+        c->sent += (size_t)n;
+        metrics_count(METRIC_BYTES_WRITTEN, (uint64_t)n);
+    }
+    if (c->sent == out->len) {
+        out->len = 0;
+        c->sent = 0;
+    }
+    return 0;
+}
+
+static size_t pending_output(const Connection *c) {
+    return c->session.out.len - c->sent;
+}
+
+// Whether the session should run another command now: not while too much
+// output is unsent (the rest stays buffered, and the socket unread, so
+// the kernel eventually pushes back on the client)
+static int can_run(const Connection *c) {
+    return !c->broken && c->session.phase != SESSION_CLOSED && pending_output(c) < OUTPUT_HIGH_WATER;
+}
+
+// A complete line is waiting (a full buffer without a newline counts)
+static int has_line(Connection *c) {
+    pthread_mutex_lock(&c->lock);
+    int found = c->in_len == sizeof(c->in) || memchr(c->in, '\n', c->in_len) != NULL;
+    pthread_mutex_unlock(&c->lock);
+    return found;
+}
+
+static int input_full(Connection *c) {
+    pthread_mutex_lock(&c->lock);
+    int full = c->in_len == sizeof(c->in);
+    pthread_mutex_unlock(&c->lock);
+    return full;
+}
+
+enum { LINE_NONE, LINE_READY, LINE_TOO_LONG };
+
+/**
+ * Move the first complete line out of the input buffer into `line`
+ * (NUL-terminated, without its line ending). A full buffer without a
+ * newline is a line too long to run: it is dropped, and so is the rest of
+ * it as it arrives (receive() skips to the next newline).
+ */
+static int take_line(Connection *c, char line[INPUT_BYTES]) {
+    pthread_mutex_lock(&c->lock);
+    const char *nl = memchr(c->in, '\n', c->in_len);
+    size_t used = 0;
+    int result = LINE_NONE;
+    if (nl) {
+        size_t end = (size_t)(nl - c->in);
+        used = end + 1;
+        if (end > 0 && c->in[end - 1] == '\r') end--;
+        memcpy(line, c->in, end);
+        line[end] = '\0';
+        result = LINE_READY;
+    } else if (c->in_len == sizeof(c->in)) {
+        used = c->in_len;
+        c->skipping = 1;
+        result = LINE_TOO_LONG;
+    }
+    memmove(c->in, c->in + used, c->in_len - used);
+    c->in_len -= used;
+    pthread_mutex_unlock(&c->lock);
+    return result;
+}
+
+// Answer a dropped over-long line with an error frame of its own
+static void reject_line(Connection *c) {
+    char reply[128];
+    int len = snprintf(reply, sizeof(reply), "\nCommand too long (over %d bytes), ignored.\n", INPUT_BYTES - 1);
+    ui_buffer_append(&c->session.out, reply, (size_t)len);
+    ui_buffer_append(&c->session.out, &(char){SESSION_FRAME_END}, 1);
+}
+
+static void run_command(Connection *c, const char *line) {
+    uint64_t t = metrics_now_ns();
+    MetricPhase phase = session_command(&c->session, line);
+    uint64_t ns = metrics_now_ns() - t;
+    metrics_observe(phase, ns);
+    metrics_observe(METRIC_SESSION_COMMAND, ns);
+    metrics_count(METRIC_COMMANDS, 1);
+    uint64_t slot = atomic_fetch_add_explicit(&latency.count, 1, memory_order_relaxed);
+    atomic_store_explicit(&latency.ns[slot & (LATENCY_SAMPLES - 1)], ns, memory_order_relaxed);
+}
+
+// Worker: give the connection back to the loop thread
+static void hand_back(Connection *c) {
+    pthread_mutex_lock(&done.lock);
+    c->next_done = done.head;
+    done.head = c;
+    pthread_mutex_unlock(&done.lock);
+    uint64_t one = 1;
+    if (write(done.fd, &one, sizeof(one)) < 0) {
+        // Only fails if the counter is saturated, in which case the loop is
+        // already due to wake up
+    }
+}
+
+// Worker: bring a hibernated session back before running its command
+static int wake_session(Connection *c) {
+    char path[512];
+    hibernate_path(c, path, sizeof(path));
+    uint64_t t = metrics_now_ns();
+    if (session_wake(&c->session, path) != 0) {
+        fprintf(stderr, "Cannot wake session %lu from %s\n", c->id, path);
+        return -1;
+    }
+    uint64_t ns = metrics_now_ns() - t;
+    metrics_observe(METRIC_SESSION_WAKE, ns);
+    set_resident(1);
+    atomic_fetch_add(&latency.wakes, 1);
+    uint64_t max = atomic_load(&latency.wake_max_ns);
+    while (ns > max && !atomic_compare_exchange_weak(&latency.wake_max_ns, &max, ns)) {
+    }
+    return 0;
+}
+
+// Worker task: write an idle session out and free its memory
+static void hibernate_session(void *arg) {
+    Connection *c = arg;
+    char path[512];
+    hibernate_path(c, path, sizeof(path));
+    uint64_t t = metrics_now_ns();
+    if (session_hibernate(&c->session, path) == 0) {
+        metrics_observe_since(METRIC_SESSION_HIBERNATE, t);
+        set_resident(-1);
+    } else {
+        fprintf(stderr, "Cannot hibernate session %lu to %s\n", c->id, path);
+    }
+    hand_back(c);
+}
+
+/**
+ * Worker task: run the session's waiting commands and send the output.
+ * After each command it checks whether other sessions are queued, and if
+ * so goes to the back of the queue itself rather than keep the worker.
+ */
+static void run_session(void *arg) {
+    Connection *c = arg;
+    char line[INPUT_BYTES];
+    metrics_observe_since(METRIC_SESSION_QUEUE, c->queued_ns);
+    if (c->session.hibernated && wake_session(c) != 0) {
+        c->broken = 1;  // Closed once handed back
+        hand_back(c);
+        return;
+    }
+    int got;
+    while (can_run(c) && (got = take_line(c, line)) != LINE_NONE) {
+        if (got == LINE_TOO_LONG) {
+            reject_line(c);
+        } else {
+            run_command(c, line);
+        }
+        if (work_pool_queued(pool_for(c)) > 0) break;
+    }
+    if (flush_output(c) != 0) c->broken = 1;
+    if (can_run(c) && has_line(c)) {
+        c->queued_ns = metrics_now_ns();
+        if (work_pool_submit(pool_for(c), run_session, c) == 0) return;
+    }
+    hand_back(c);
+}
+
+// Spectator pool task: draw the watched game's latest frame and send it
+static void run_spectator(void *arg) {
+    Connection *c = arg;
+    session_spectate(&c->session);
+    if (flush_output(c) != 0) c->broken = 1;
+    hand_back(c);
+}
+
+// Loop thread: hand an idle connection to a worker to run `task`
+static int dispatch(Connection *c, WorkFn task) {
+    c->busy = 1;
+    c->queued_ns = metrics_now_ns();
+    if (work_pool_submit(pool_for(c), task, c) != 0) {
+        c->busy = 0;
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Loop thread, connection idle: send what output there is, then either
+ * dispatch the session (a line is waiting), close it (the game is over
+ * and everything sent) or wait for the socket.
+ */
+static void settle(int epfd, Connection *c) {
+    if (c->broken || flush_output(c) != 0) {
+        close_connection(epfd, c);
+        return;
+    }
+    if (c->session.phase == SESSION_WATCHING && c->list != &watchers) {
+        list_append(&watchers, c);  // Became a spectator
+    }
+    size_t pending = pending_output(c);
+    int closed = c->session.phase == SESSION_CLOSED;
+    if (closed && pending == 0) {
+        close_connection(epfd, c);
+        return;
+    }
+    if (can_run(c) && has_line(c) && dispatch(c, run_session) != 0) {
+        fprintf(stderr, "Dropping a connection: out of memory\n");
+        close_connection(epfd, c);
+        return;
+    }
+    uint32_t want = 0;
+    if (c->busy) {
+        if (!input_full(c)) want = EPOLLIN;  // Keep reading; the worker owns the output
+    } else {
+        if (pending < OUTPUT_HIGH_WATER && !closed && !input_full(c)) want |= EPOLLIN;
+        if (pending > 0) want |= EPOLLOUT;
+    }
+    set_interest(epfd, c, want);
+}
+
+// Loop thread: take back the connections the workers are done with
+static void collect_done(int epfd) {
+    uint64_t count;
+    if (read(done.fd, &count, sizeof(count)) < 0) {
+        // EAGAIN: another wakeup already drained it
+    }
+    pthread_mutex_lock(&done.lock);
+    Connection *c = done.head;
+    done.head = NULL;
+    pthread_mutex_unlock(&done.lock);
+    while (c) {
+        Connection *next = c->next_done;
+        c->busy = 0;
+        if (c->session.hibernated) unlist(c);
+        if (c->hung_up || c->broken) {
+            close_connection(epfd, c);
+        } else {
+            settle(epfd, c);
+        }
+        c = next;
+    }
+}
+
+// Read what the client sent into the input buffer. Returns -1 when the
+// peer has gone.
+static int receive(Connection *c) {
+    int status = 0;
+    pthread_mutex_lock(&c->lock);
+    while (c->in_len < sizeof(c->in)) {
+        ssize_t n = recv(c->fd, c->in + c->in_len, sizeof(c->in) - c->in_len, 0);
+        if (n == 0) {
+            status = -1;
+            break;
+        }
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) status = -1;
+            break;
+        }
+        size_t start = c->in_len;
+        c->in_len += (size_t)n;
+        if (c->skipping) {
+            // Still inside an over-long line: drop it through its newline
+            const char *nl = memchr(c->in + start, '\n', c->in_len - start);
+            size_t keep = nl ? c->in_len - (size_t)(nl + 1 - c->in) : 0;
+            memmove(c->in + start, c->in + c->in_len - keep, keep);
+            c->in_len = start + keep;
+            c->skipping = !nl;
+        }
+    }
+    pthread_mutex_unlock(&c->lock);
+    return status;
+}
+
+// The peer is gone. A busy connection is closed when its worker hands it
+// back; until then it is out of epoll so its hangup does not fire again.
+static void hang_up(int epfd, Connection *c) {
+    if (!c->busy) {
+        close_connection(epfd, c);
+        return;
+    }
+    epoll_ctl(epfd, EPOLL_CTL_DEL, c->fd, NULL);
+    c->hung_up = 1;
+}
+
+static void accept_connections(int epfd, int listen_fd) {
+    for (;;) {
+        int fd = accept(listen_fd, NULL, NULL);
+        if (fd < 0) {
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) perror("accept");
+            return;
+        }
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));  // Fails harmlessly on Unix sockets
+        Connection *c = calloc(1, sizeof(*c));
+        if (!c || net_set_nonblocking(fd) != 0 || session_init(&c->session, &worlds, next_seed++) != 0) {
+            fprintf(stderr, "Dropping a connection: out of memory\n");
+            free(c);
+            close(fd);
+            continue;
+        }
+        pthread_mutex_init(&c->lock, NULL);
+        c->fd = fd;
+        c->id = next_id++;
+        if (session_share(&c->session, c->id) != 0) {
+            // Playable all the same; nobody can watch it
+            fprintf(stderr, "Session %lu cannot be watched: out of memory\n", c->id);
+        }
+        c->events = EPOLLIN | EPOLLOUT;  // The class menu is waiting to go out
+        struct epoll_event ev = {.events = c->events, .data.ptr = c};
+        if (epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev) != 0) {
+            perror("epoll_ctl");
+            session_free(&c->session);
+            pthread_mutex_destroy(&c->lock);
+            free(c);
+            close(fd);
+            continue;
+        }
+        idle_touch(c);
+        set_resident(1);
+        active_sessions++;
+        if (active_sessions > peak_sessions) peak_sessions = active_sessions;
+        metrics_set(METRIC_SESSIONS_ACTIVE, (uint64_t)active_sessions);
+    }
+}
+
+/**
+ * Hibernate the sessions that have been idle too long. The list is in
+ * order of last activity, so this stops at the first recent one. A
+ * session that cannot go now (running, output unsent or input waiting)
+ * goes to the back of the list and is tried again a period later.
+ */
+static void hibernate_idle(void) {
+    if (idle_ns == 0) return;
+    uint64_t now = metrics_now_ns();
+    Connection *c;
+    while ((c = idle.oldest) != NULL && c->active_ns + idle_ns <= now) {
+        idle_touch(c);
+        if (c->busy || c->hung_up || c->session.phase == SESSION_CLOSED || pending_output(c) > 0) continue;
+        pthread_mutex_lock(&c->lock);
+        int waiting = c->in_len > 0;
+        pthread_mutex_unlock(&c->lock);
+        if (!waiting) dispatch(c, hibernate_session);  // Out of memory: stays awake
+    }
+}
+
+/**
+ * Every FRAME_EVERY_MS, send each spectator whose game has moved on a new
+ * frame. A spectator still taking the last one skips to the latest state
+ * later instead of queueing frames.
+ */
+static void offer_frames(void) {
+    uint64_t now = metrics_now_ns();
+    if (!watchers.oldest || now - frame_ns < FRAME_EVERY_MS * 1000000ULL) return;
+    frame_ns = now;
+    for (Connection *c = watchers.oldest; c; c = c->newer) {
+        if (c->busy || c->hung_up || c->broken || pending_output(c) > 0) continue;
+        if (session_spectate_due(&c->session)) dispatch(c, run_spectator);  // Out of memory: next time
+    }
+}
+
+// Hibernation files of this process left by sessions still connected at exit
+static void remove_hibernated(void) {
+    char prefix[64];
+    snprintf(prefix, sizeof(prefix), "session-%ld-", (long)getpid());
+    DIR *dir = opendir(hibernate_dir);
+    if (!dir) return;
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (strncmp(entry->d_name, prefix, strlen(prefix)) != 0) continue;
+        char path[512];
+        snprintf(path, sizeof(path), "%s/%s", hibernate_dir, entry->d_name);
+        unlink(path);
+    }
+    closedir(dir);
+}
+
+/**
+ * Swap in an edited gamedata.bin. Workers pin the table for each command
+ * (gamedata_pin), so one in progress finishes on the old table.
+ */
+static void reload_gamedata(void) {
+    char err[256];
+    uint64_t t = metrics_now_ns();
+    int reloaded = gamedata_poll_reload(err, sizeof(err));
+    metrics_observe_since(METRIC_RELOAD, t);
+    if (reloaded > 0) {
+        fprintf(stderr, "Game data reloaded\n");
+    } else if (reloaded < 0) {
+        fprintf(stderr, "Game data rejected, keeping the old data: %s\n", err);
+    }
+}
+
+static void service(int epfd, Connection *c, uint32_t events) {
+    if (events & (EPOLLERR | EPOLLHUP)) {
+        hang_up(epfd, c);
+        return;
+    }
+    if ((events & EPOLLIN) && receive(c) != 0) {
+        hang_up(epfd, c);
+        return;
+    }
+    if (events & EPOLLIN) idle_touch(c);
+    if (c->busy) {
+        // The worker owns the session; just stop reading once the buffer is full
+        set_interest(epfd, c, input_full(c) ? 0 : EPOLLIN);
+        return;
+    }
+    settle(epfd, c);
+}
+
+int main(int argc, char **argv) {
+    const char *address = argc > 1 ? argv[1] : NET_DEFAULT_ADDRESS;
+    next_seed = (uint64_t)time(NULL) << 32;
+
+    char err[256];
+    if (gamedata_init(getenv("ADVENTURE_DATA"), err, sizeof(err)) != 0) {
+        fprintf(stderr, "Failed to load game data: %s\n", err);
+        return 1;
+    }
+    metrics_init(getenv("ADVENTURE_METRICS"));
+    const char *pool_size = getenv("ADVENTURE_WORLDS");
+    world_pool_init(&worlds, pool_size ? atoi(pool_size) : 8, getenv("ADVENTURE_WORLD_DIR"));
+    const char *idle_seconds = getenv("ADVENTURE_IDLE_SECONDS");
+    int idle_for = idle_seconds ? atoi(idle_seconds) : 600;
+    idle_ns = idle_for > 0 ? (uint64_t)idle_for * 1000000000ULL : 0;
+    const char *dir = getenv("ADVENTURE_HIBERNATE_DIR");
+    snprintf(hibernate_dir, sizeof(hibernate_dir), "%s", dir && dir[0] ? dir : ".");
+    const char *worker_count = getenv("ADVENTURE_WORKERS");
+    int threads = worker_count ? atoi(worker_count) : (int)sysconf(_SC_NPROCESSORS_ONLN);
+    const char *viewer_count = getenv("ADVENTURE_SPECTATOR_THREADS");
+    done.fd = eventfd(0, EFD_NONBLOCK);
+    if (done.fd < 0 || work_pool_init(&workers, threads) != 0 ||
+        work_pool_init(&viewers, viewer_count ? atoi(viewer_count) : 1) != 0) {
+        fprintf(stderr, "Cannot start worker threads\n");
+        gamedata_shutdown();
+        return 1;
+    }
+
+    int listen_fd = net_listen(address, err, sizeof(err));
+    if (listen_fd < 0) {
+        fprintf(stderr, "Cannot listen: %s\n", err);
+        gamedata_shutdown();
+        return 1;
+    }
+    int epfd = epoll_create1(0);
+    struct epoll_event ev = {.events = EPOLLIN, .data.ptr = NULL};  // NULL = the listener
+    struct epoll_event done_ev = {.events = EPOLLIN, .data.ptr = &done};
+    if (epfd < 0 || epoll_ctl(epfd, EPOLL_CTL_ADD, listen_fd, &ev) != 0 ||
+        epoll_ctl(epfd, EPOLL_CTL_ADD, done.fd, &done_ev) != 0) {
+        perror("epoll");
+        close(listen_fd);
+        work_pool_destroy(&workers);
+        work_pool_destroy(&viewers);
+        gamedata_shutdown();
+        return 1;
+    }
+    struct epoll_event watch_ev = {.events = EPOLLIN, .data.ptr = &data_watch};
+    if (gamedata_watch_fd() >= 0 && epoll_ctl(epfd, EPOLL_CTL_ADD, gamedata_watch_fd(), &watch_ev) != 0) {
+        perror("epoll_ctl: game data changes will be ignored");
+    }
+
+    // SIGINT/SIGTERM end the loop (no SA_RESTART, so epoll_wait returns)
+    struct sigaction sa = {0};
+    sa.sa_handler = handle_stop;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    fprintf(stderr, "Listening on %s with %d worker%s\n", address, workers.size, workers.size == 1 ? "" : "s");
+    latency.report_ns = metrics_now_ns();
+    latency.cpu_seconds = cpu_seconds();
+
+    struct epoll_event events[64];
+    while (!stop_requested) {
+        int n = epoll_wait(epfd, events, 64, watchers.oldest ? FRAME_EVERY_MS : 1000);
+        if (n < 0 && errno != EINTR) {
+            perror("epoll_wait");
+            break;
+        }
+        // Hand-backs are taken after the rest of the batch, as they can
+        // close connections that still have an event further down it
+        int handed_back = 0;
+        for (int i = 0; i < n; i++) {
+            if (events[i].data.ptr == NULL) {
+                accept_connections(epfd, listen_fd);
+            } else if (events[i].data.ptr == &done) {
+                handed_back = 1;
+            } else if (events[i].data.ptr == &data_watch) {
+                reload_gamedata();
+            } else {
+                service(epfd, events[i].data.ptr, events[i].events);
+            }
+        }
+        if (handed_back) collect_done(epfd);
+        hibernate_idle();
+        offer_frames();
+        if (metrics_now_ns() - latency.report_ns >= REPORT_EVERY_NS) report();
+    }
+
+    report();
+    work_pool_destroy(&workers);  // Finishes the commands already queued
+    work_pool_destroy(&viewers);
+    remove_hibernated();
+    close(listen_fd);
+    if (address[0] && !strchr(address, ':')) unlink(address);
+    close(epfd);  // Sessions still connected are left to process exit
+    close(done.fd);
+    metrics_dump();
+    world_pool_destroy(&worlds);  // Sessions still connected keep their worlds mapped
+    gamedata_shutdown();
+    return 0;
+}
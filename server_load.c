@@ -0,0 +1,189 @@
+/**
+ * server_load.c - Load test client for adventure_server.
+ *
+ * Usage: server_load [address] [sessions] [commands]
+ *   address   server address (default adventure.sock; host:port for TCP)
+ *   sessions  concurrent games (default 100)
+ *   commands  commands each game sends after choosing a class (default 200)
+ *
+ * Every session picks a class, then plays at random: moves while
+ * exploring, attacks in battle, and starts over when its character dies.
+ * Each session waits for the whole response (up to the NUL that ends it)
+ * before sending its next command, so the round trip measured is what a
+ * player would see. Prints throughput and round-trip percentiles.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+#include "net.h"
+
+typedef struct {
+    int fd;
+    int remaining;       // Commands still to send
+    uint64_t sent_ns;    // When the outstanding command went out
+    uint64_t rng;        // xorshift state for this session's choices
+    char *frame;         // Response received so far
+    size_t frame_len;
+    size_t frame_capacity;
+} Client;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static uint64_t next_random(uint64_t *state) {
+    uint64_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    return *state = x;
+}
+
+static int compare_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static int send_line(Client *c, const char *line) {
+    size_t len = strlen(line);
+    // Commands are a few bytes; a full socket buffer here means the
+    // server stopped reading, which is a failure for this test
+    if (send(c->fd, line, len, MSG_NOSIGNAL) != (ssize_t)len) return -1;
+    c->sent_ns = now_ns();
+    return 0;
+}
+
+// The next command, chosen from the screen the server just sent
+static const char *choose_command(Client *c) {
+    static const char *const moves[] = {"N\n", "S\n", "E\n", "W\n"};
+    c->frame[c->frame_len] = '\0';
+    if (strstr(c->frame, "new game?")) return "Y\n";
+    if (strstr(c->frame, "Enter your choice")) return "1\n";
+    if (strstr(c->frame, "BATTLE COMMANDS")) return "A\n";
+    return moves[next_random(&c->rng) % 4];
+}
+
+int main(int argc, char **argv) {
+    const char *address = argc > 1 ? argv[1] : NET_DEFAULT_ADDRESS;
+    int sessions = argc > 2 ? atoi(argv[2]) : 100;
+    int commands = argc > 3 ? atoi(argv[3]) : 200;
+    if (sessions < 1 || commands < 1) {
+        fprintf(stderr, "usage: %s [address] [sessions] [commands]\n", argv[0]);
+        return 1;
+    }
+
+    Client *clients = calloc((size_t)sessions, sizeof(*clients));
+    size_t max_samples = (size_t)sessions * (size_t)(commands + 1);
+    uint64_t *rtt = malloc(max_samples * sizeof(*rtt));
+    int epfd = epoll_create1(0);
+    if (!clients || !rtt || epfd < 0) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    uint64_t start = now_ns();
+    char err[256];
+    for (int i = 0; i < sessions; i++) {
+        Client *c = &clients[i];
+        c->fd = net_connect(address, err, sizeof(err));
+        if (c->fd < 0) {
+            fprintf(stderr, "Cannot connect session %d: %s\n", i, err);
+            return 1;
+        }
+        c->remaining = commands + 1;  // Plus the class choice
+        c->rng = 0x9E3779B97F4A7C15ULL * (uint64_t)(i + 1);
+        c->sent_ns = now_ns();        // The class menu counts as the first round trip
+        struct epoll_event ev = {.events = EPOLLIN, .data.ptr = c};
+        epoll_ctl(epfd, EPOLL_CTL_ADD, c->fd, &ev);
+    }
+    uint64_t connected = now_ns();
+
+    size_t samples = 0;
+    int open = sessions, failed = 0;
+    struct epoll_event events[64];
+    char buf[16384];
+    while (open > 0) {
+        int n = epoll_wait(epfd, events, 64, 10000);
+        if (n == 0) {
+            fprintf(stderr, "No response for 10 s with %d sessions open\n", open);
+            break;
+        }
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            perror("epoll_wait");
+            break;
+        }
+        for (int e = 0; e < n; e++) {
+            Client *c = events[e].data.ptr;
+            ssize_t got = recv(c->fd, buf, sizeof(buf), 0);
+            if (got < 0 && (errno == EAGAIN || errno == EINTR)) continue;
+            int done = got <= 0;
+            if (got <= 0) failed++;
+
+            for (ssize_t i = 0; i < got && !done; i++) {
+                if (buf[i] != '\0') {
+                    // Keep the screen text for choose_command()
+                    if (c->frame_len + 1 >= c->frame_capacity) {
+                        size_t capacity = c->frame_capacity ? c->frame_capacity * 2 : 8192;
+                        char *grown = realloc(c->frame, capacity);
+                        if (!grown) {
+                            fprintf(stderr, "out of memory\n");
+                            return 1;
+                        }
+                        c->frame = grown;
+                        c->frame_capacity = capacity;
+                    }
+                    c->frame[c->frame_len++] = buf[i];
+                    continue;
+                }
+                // End of a response
+                if (samples < max_samples) rtt[samples++] = now_ns() - c->sent_ns;
+                if (c->remaining-- == 0) {
+                    done = 1;
+                    break;
+                }
+                const char *command = c->remaining == commands ? "1\n" : choose_command(c);
+                c->frame_len = 0;
+                if (send_line(c, command) != 0) {
+                    failed++;
+                    done = 1;
+                }
+            }
+            if (done) {
+                epoll_ctl(epfd, EPOLL_CTL_DEL, c->fd, NULL);
+                close(c->fd);
+                open--;
+            }
+        }
+    }
+    uint64_t end = now_ns();
+
+    double secs = (double)(end - connected) / 1e9;
+    printf("%d sessions connected in %.1f ms, %d failed\n", sessions,
+           (double)(connected - start) / 1e6, failed);
+    printf("%zu round trips in %.2f s (%.0f commands/s)\n", samples, secs,
+           secs > 0 ? (double)samples / secs : 0);
+    if (samples > 0) {
+        qsort(rtt, samples, sizeof(*rtt), compare_u64);
+        printf("round trip: p50 %.1f us  p99 %.1f us  max %.1f us\n",
+               (double)rtt[samples / 2] / 1e3, (double)rtt[samples * 99 / 100] / 1e3,
+               (double)rtt[samples - 1] / 1e3);
+    }
+
+    for (int i = 0; i < sessions; i++) free(clients[i].frame);
+    free(clients);
+    free(rtt);
+    close(epfd);
+    return failed || open > 0 ? 1 : 0;
+}
@@ -0,0 +1,495 @@
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "gamedata.h"
+#include "session.h"
+
+// Same reservation as the terminal game: map, event log and undo history
+#define SESSION_ARENA_BYTES (MAP_ARENA_BYTES + sizeof(EventLog) + sizeof(History) + 4096)
+
+#define HIBERNATE_MAGIC "ADVHIB01"
+#define WATCH_LIST_MAX 32  // Games "watch" lists
+
+/*
+ * Hibernation file: this header, then `events` GameEvents (oldest first),
+ * then `slots` TileSlots of the map's overlay. Raw structs, and only read
+ * back by the process that wrote them: events point at names in its
+ * loaded game data, and the world stays in its memory.
+ */
+typedef struct {
+    char magic[8];
+    uint32_t phase;
+    uint32_t player_class;
+    uint32_t state;
+    uint32_t seed;        // Of the world kept while asleep (checked on wake)
+    uint32_t events;
+    uint32_t log_head;
+    uint32_t log_turn;
+    uint32_t slots;
+    uint64_t map_hash;    // The restored overlay must hash the same
+    Position pos;
+    BattleState battle;
+    Rng rng;
+    Player player;
+} HibernateHeader;
+
+// The arena and what is carved from it (map, event log, undo history)
+static int session_alloc(Session *s) {
+    if (arena_init(&s->arena, SESSION_ARENA_BYTES) != 0) {
+        return -1;
+    }
+    s->map = ARENA_NEW(&s->arena, Map);
+    map_init(s->map, &s->arena);
+    s->log = ARENA_NEW(&s->arena, EventLog);
+    eventlog_init(s->log);
+    s->history = ARENA_NEW(&s->arena, History);
+    history_init(s->history);
+    return 0;
+}
+
+static void session_release(Session *s) {
+    if (s->map) map_free(s->map);
+    arena_destroy(&s->arena);
+    s->map = NULL;
+    s->log = NULL;
+    s->history = NULL;
+}
+
+static void render_class_menu(void) {
+    int class_count;
+    const ClassDefinition *classes = get_all_class_definitions(&class_count);
+    ui_printf("\n╔════════════════════════════════════════════════════════════════════════════════╗\n");
+    ui_printf("║                        DUNGEON CRAWLER ADVENTURE                               ║\n");
+    ui_printf("╚════════════════════════════════════════════════════════════════════════════════╝\n\n");
+    ui_printf("Choose your character class:\n\n");
+    for (int i = 0; i < class_count; i++) {
+        ui_printf("  [%d] %s - %s\n", i + 1, classes[i].name, classes[i].description);
+        ui_printf("      • Max Health: %d\n", classes[i].max_health);
+        ui_printf("      • Base Damage: %d\n", classes[i].base_damage);
+        ui_printf("      • Base Defense: %d\n\n", classes[i].base_defense);
+    }
+    ui_printf("(Or enter \"watch\" to see the games in progress.)\n\n");
+    ui_printf("Enter your choice (1-%d): ", class_count);
+}
+
+// Draw the screen for the current state
+static void render_state(const Session *s) {
+    if (s->state == STATE_BATTLE) {
+        ui_render_battle(&s->player, &s->battle, s->log);
+    } else if (s->state == STATE_INVENTORY) {
+        ui_render_inventory(&s->player, s->log);
+    } else {
+        ui_render_game(&s->player, &s->pos, s->log, s->map);
+    }
+}
+
+/**
+ * Start the map on the next world of the pool (or a newly generated one)
+ * and put a new character of the chosen class at its centre.
+ * Returns 0, or -1 if no world could be had.
+ */
+static int start_game(Session *s, const char *intro) {
+    s->map->history = NULL;  // Starting a map is not a turn
+    uint64_t t = metrics_now_ns();
+    uint32_t seed = (uint32_t)rng_rand();
+    World *world = s->worlds ? world_pool_acquire(s->worlds, seed) : world_create(seed, NULL);
+    metrics_observe_since(METRIC_WORLDGEN_WAIT, t);
+    if (!world) {
+        ui_printf("\nNo dungeon could be generated (out of memory).\n");
+        s->phase = SESSION_CLOSED;
+        return -1;
+    }
+    map_attach(s->map, world);
+    world_release(world);  // The map holds its own reference
+    history_init(s->history);
+    s->map->history = s->history;
+
+    player_init(&s->player, s->player_class);
+    eventlog_init(s->log);
+    eventlog_note(s->log, intro);
+    s->pos = (Position){MAP_CENTER, MAP_CENTER};
+    s->state = STATE_EXPLORING;
+    s->battle = (BattleState){0};
+    s->phase = SESSION_PLAYING;
+    ui_render_game(&s->player, &s->pos, s->log, s->map);
+    return 0;
+}
+
+// Whether the game-over prompt offers R: the player died and there are
+// turns to take back
+static int can_rewind(const Session *s) {
+    return s->player.health <= 0 && history_depth(s->history) > 0;
+}
+
+static void prompt_new_game(const Session *s) {
+    ui_printf(can_rewind(s) ? "Start a new game? (Y/N, R = rewind to before the fight): "
+                            : "Start a new game? (Y/N): ");
+}
+
+static void render_game_over(const Session *s) {
+    if (s->player.health <= 0) {
+        ui_clear_screen();
+        ui_printf("\n╔════════════════════════════════════════╗\n");
+        ui_printf("║         GAME OVER                      ║\n");
+        ui_printf("╚════════════════════════════════════════╝\n\n");
+        ui_printf("You have perished in the dungeon.\n");
+        ui_printf("Final Level: %d\n", s->player.level);
+        ui_printf("Gold Collected: %d\n", s->player.gold);
+        ui_printf("Final Position: [%d, %d]\n\n", s->pos.x, s->pos.y);
+    }
+    prompt_new_game(s);
+}
+
+/**
+ * After a death, undo turns until back in the corridor the fatal fight
+ * started from (the terminal game's R at the new-game prompt)
+ */
+static void rewind_death(Session *s) {
+    int undone = 0;
+    do {
+        undone += history_rewind(s->history, s->map, 1, &s->player, &s->pos, &s->state, &s->battle);
+    } while ((s->state != STATE_EXPLORING || s->battle.is_active) && history_depth(s->history) > 0);
+    eventlog_begin_turn(s->log);
+    eventlog_push(s->log, EV_REWOUND, NULL, undone, 0, 0);
+    s->phase = SESSION_PLAYING;
+    render_state(s);
+}
+
+// Publish the game for its spectators, if it has any
+static void publish(Session *s) {
+    if (!s->feed || !spectate_watched(s->feed)) return;
+    SpectatorView view;
+    if (s->phase == SESSION_PLAYING || s->phase == SESSION_GAME_OVER) {
+        spectate_capture(&view, s->phase == SESSION_PLAYING ? SPECTATE_PLAYING : SPECTATE_GAME_OVER,
+                         &s->player, &s->pos, s->map, s->state, &s->battle);
+    } else {
+        memset(&view, 0, sizeof(view));
+        view.status = SPECTATE_CHOOSING;
+    }
+    spectate_publish(s->feed, &view);
+}
+
+// Spectator: draw the watched game as last published. Returns 0 if the
+// feed was mid-publish (nothing drawn).
+static int draw_watched(Session *s) {
+    // Read before the view: the player's last publish comes before its end
+    int ended = atomic_load(&s->watching->ended);
+    SpectatorView view;
+    unsigned version = spectate_read(s->watching, &view);
+    if (version & 1) return 0;
+    ui_render_spectator(&view, s->watching_id, ended);
+    s->shown = version;
+    s->shown_end = ended;
+    return 1;
+}
+
+static int is_watch(const char *line) {
+    const char *word = "watch";
+    for (int i = 0; word[i]; i++) {
+        if (tolower((unsigned char)line[i]) != word[i]) return 0;
+    }
+    return line[5] == '\0' || isspace((unsigned char)line[5]);
+}
+
+/**
+ * "watch": list the games in progress. "watch <id>": give up this session's
+ * own (not yet started) game and become a spectator of that one.
+ */
+static void start_watching(Session *s, const char *line, int class_count) {
+    const char *arg = line + 5;
+    while (isspace((unsigned char)*arg)) arg++;
+    unsigned long own = s->feed ? s->feed->id : (unsigned long)-1;
+    if (*arg == '\0') {
+        unsigned long ids[WATCH_LIST_MAX];
+        int n = spectate_list(ids, WATCH_LIST_MAX);
+        int shown = 0;
+        ui_printf("\nGames you can watch:");
+        for (int i = 0; i < n; i++) {
+            if (ids[i] == own) continue;
+            ui_printf(" %lu", ids[i]);
+            shown++;
+        }
+        ui_printf("%s\n", shown ? "" : " none");
+        ui_printf("Enter \"watch <id>\" to watch one, or your choice (1-%d): ", class_count);
+        return;
+    }
+
+    char *end;
+    unsigned long id = strtoul(arg, &end, 10);
+    SpectateFeed *feed = end != arg && id != own ? spectate_watch(id) : NULL;
+    if (!feed) {
+        ui_printf("There is no game %s to watch.\n", arg);
+        ui_printf("Enter your choice (1-%d): ", class_count);
+        return;
+    }
+    spectate_close(s->feed);
+    s->feed = NULL;
+    session_release(s);  // A spectator needs no map of its own
+    s->watching = feed;
+    s->watching_id = id;
+    s->phase = SESSION_WATCHING;
+    draw_watched(s);
+}
+
+int session_init(Session *s, WorldPool *worlds, uint64_t seed) {
+    memset(s, 0, sizeof(*s));
+    s->worlds = worlds;
+    rng_seed(&s->rng, seed);
+    if (session_alloc(s) != 0) {
+        return -1;
+    }
+    s->phase = SESSION_CHOOSE_CLASS;
+
+    ui_set_target(&s->out);
+    render_class_menu();
+    ui_buffer_append(&s->out, &(char){SESSION_FRAME_END}, 1);
+    ui_set_target(NULL);
+    return 0;
+}
+
+// One turn of play: the main loop of main.c without the stdin reads
+static MetricPhase play(Session *s, const char *line) {
+    char command = (char)toupper((unsigned char)line[0]);
+    MetricPhase phase = METRIC_COMMAND_OTHER;
+    eventlog_begin_turn(s->log);
+
+    // R takes back the last turn in any state, as in the terminal game
+    if (command == 'R') {
+        int undone = history_rewind(s->history, s->map, 1, &s->player, &s->pos, &s->state, &s->battle);
+        eventlog_push(s->log, EV_REWOUND, NULL, undone, 0, 0);
+        render_state(s);
+        return METRIC_REWIND;
+    }
+
+    if (s->state == STATE_INVENTORY) {
+        // The slot number is on the same line; nothing more to read
+        history_begin_turn(s->history, &s->player, s->pos, s->state, &s->battle);
+        handle_inventory_line(&s->player, s->log, &s->state, line);
+        history_end_turn(s->history, &s->player, s->pos, s->state, &s->battle);
+        render_state(s);
+        return METRIC_COMMAND_INVENTORY;
+    }
+
+    if (s->state == STATE_EXPLORING && command == 'M') {
+        // The terminal version waits for a key; here the next command does
+        ui_clear_screen();
+        print_explored_map(s->map, &s->pos, 12);
+        ui_printf("\nEnter a command to continue...");
+        return phase;
+    }
+    if (s->state == STATE_EXPLORING && command == 'L') {
+        ui_clear_screen();
+        ui_render_log(s->log, 20);
+        ui_printf("\nEnter a command to continue...");
+        return phase;
+    }
+
+    int running = 1;
+    if (s->state == STATE_BATTLE) {
+        phase = METRIC_COMMAND_BATTLE;
+    } else if (strchr("NSEW", command)) {
+        phase = METRIC_COMMAND_MOVE;
+    }
+    history_begin_turn(s->history, &s->player, s->pos, s->state, &s->battle);
+    handle_command(command, &running, &s->pos, &s->player, s->log, s->map, &s->state, &s->battle);
+    history_end_turn(s->history, &s->player, s->pos, s->state, &s->battle);
+
+    if (!running || s->player.health <= 0) {
+        s->phase = SESSION_GAME_OVER;
+        render_game_over(s);
+    } else {
+        render_state(s);
+    }
+    return phase;
+}
+
+MetricPhase session_command(Session *s, const char *line) {
+    MetricPhase phase = METRIC_COMMAND_OTHER;
+    while (isspace((unsigned char)*line)) line++;
+    ui_set_target(&s->out);
+    rng_set_current(&s->rng);
+    gamedata_pin();
+
+    switch (s->phase) {
+    case SESSION_CHOOSE_CLASS: {
+        int class_count;
+        const ClassDefinition *classes = get_all_class_definitions(&class_count);
+        int choice = atoi(line);
+        if (is_watch(line)) {
+            start_watching(s, line, class_count);
+        } else if (choice >= 1 && choice <= class_count) {
+            s->player_class = classes[choice - 1].class_type;
+            start_game(s, "Whoa! You trigger a magical portal and find yourself in a mysterious dungeon...");
+            phase = METRIC_FIRST_FRAME;
+        } else {
+            ui_printf("Invalid choice! Please enter a number between 1 and %d.\n", class_count);
+            ui_printf("Enter your choice (1-%d): ", class_count);
+        }
+        break;
+    }
+    case SESSION_PLAYING:
+        if (*line == '\0') {
+            render_state(s);  // Empty line: just redraw
+        } else {
+            phase = play(s, line);
+        }
+        break;
+    case SESSION_GAME_OVER:
+        if (toupper((unsigned char)*line) == 'Y') {
+            start_game(s, "The portal flares again - a new dungeon takes shape around you...");
+            phase = METRIC_RESTART;
+        } else if (toupper((unsigned char)*line) == 'N') {
+            ui_printf("\nThanks for playing!\n");
+            s->phase = SESSION_CLOSED;
+        } else if (toupper((unsigned char)*line) == 'R' && can_rewind(s)) {
+            rewind_death(s);
+            phase = METRIC_REWIND;
+        } else {
+            prompt_new_game(s);
+        }
+        break;
+    case SESSION_WATCHING:
+        if (toupper((unsigned char)*line) == 'Q') {
+            ui_printf("\nStopped watching.\n");
+            s->phase = SESSION_CLOSED;
+        } else {
+            draw_watched(s);  // Anything else: redraw now
+        }
+        break;
+    case SESSION_CLOSED:
+        break;
+    }
+
+    publish(s);
+    ui_buffer_append(&s->out, &(char){SESSION_FRAME_END}, 1);
+    ui_set_target(NULL);
+    rng_set_current(NULL);
+    gamedata_unpin();
+    return phase;
+}
+
+int session_hibernate(Session *s, const char *path) {
+    if (s->hibernated) return 0;
+    HibernateHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, HIBERNATE_MAGIC, sizeof(h.magic));
+    h.phase = (uint32_t)s->phase;
+    h.player_class = (uint32_t)s->player_class;
+    h.state = (uint32_t)s->state;
+    h.seed = s->map->seed;
+    h.events = (uint32_t)eventlog_count(s->log);
+    h.log_head = s->log->head;
+    h.log_turn = s->log->turn;
+    h.slots = s->map->content_count;
+    h.map_hash = s->map->hash;
+    h.pos = s->pos;
+    h.battle = s->battle;
+    h.rng = s->rng;
+    h.player = s->player;
+
+    FILE *f = fopen(path, "wb");
+    if (!f) return -1;
+    int ok = fwrite(&h, sizeof(h), 1, f) == 1;
+    for (int age = (int)h.events - 1; ok && age >= 0; age--) {
+        ok = fwrite(eventlog_get(s->log, age), sizeof(GameEvent), 1, f) == 1;
+    }
+    for (uint32_t i = 0; ok && i < s->map->content_capacity; i++) {
+        if (s->map->content[i].key != 0) ok = fwrite(&s->map->content[i], sizeof(TileSlot), 1, f) == 1;
+    }
+    if (fclose(f) != 0) ok = 0;
+    if (!ok) {
+        remove(path);
+        return -1;
+    }
+
+    // Keep the (shared) world; everything else goes
+    s->sleeping_world = s->map->world;
+    if (s->sleeping_world) world_retain(s->sleeping_world);
+    session_release(s);
+    ui_buffer_free(&s->out);
+    s->hibernated = 1;
+    return 0;
+}
+
+/**
+ * Whether a header is one session_hibernate() could have written. The
+ * phase, state, class and dice are used as read, so values no session
+ * can be in (or a zero xorshift state, which would roll 0 forever) are
+ * refused along with a wrong magic.
+ */
+static int header_valid(const HibernateHeader *h) {
+    return memcmp(h->magic, HIBERNATE_MAGIC, sizeof(h->magic)) == 0 &&
+           h->phase <= SESSION_GAME_OVER && h->state <= STATE_MAP_VIEW &&
+           h->player_class < CLASS_COUNT && h->rng.state != 0 &&
+           h->events <= EVENTLOG_CAPACITY && h->events <= h->log_head;
+}
+
+int session_wake(Session *s, const char *path) {
+    if (!s->hibernated) return 0;
+    FILE *f = fopen(path, "rb");
+    if (!f) return -1;
+    HibernateHeader h;
+    int ok = fread(&h, sizeof(h), 1, f) == 1 && header_valid(&h) && session_alloc(s) == 0;
+    if (ok && s->sleeping_world) {
+        ok = s->sleeping_world->base->seed == h.seed;
+        if (ok) map_attach(s->map, s->sleeping_world);
+    }
+    for (uint32_t i = 0; ok && i < h.events; i++) {
+        GameEvent *ev = &s->log->events[(h.log_head - h.events + i) & (EVENTLOG_CAPACITY - 1)];
+        ok = fread(ev, sizeof(*ev), 1, f) == 1 && ev->type <= EV_REWOUND;
+    }
+    for (uint32_t i = 0; ok && i < h.slots; i++) {
+        TileSlot slot;
+        ok = fread(&slot, sizeof(slot), 1, f) == 1 && map_restore_slot(s->map, &slot) == 0;
+    }
+    fclose(f);
+    if (!ok || s->map->hash != h.map_hash) {
+        session_release(s);
+        return -1;
+    }
+
+    s->log->head = h.log_head;
+    s->log->turn = h.log_turn;
+    if (s->map->world) s->map->history = s->history;  // Undo starts afresh
+    world_release(s->sleeping_world);
+    s->sleeping_world = NULL;
+    s->phase = (SessionPhase)h.phase;
+    s->player_class = (PlayerClass)h.player_class;
+    s->state = (GameState)h.state;
+    s->pos = h.pos;
+    s->battle = h.battle;
+    s->rng = h.rng;
+    s->player = h.player;
+    s->hibernated = 0;
+    remove(path);
+    return 0;
+}
+
+int session_share(Session *s, unsigned long id) {
+    s->feed = spectate_open(id);
+    return s->feed ? 0 : -1;
+}
+
+int session_spectate_due(Session *s) {
+    return s->phase == SESSION_WATCHING &&
+           (spectate_version(s->watching) != s->shown ||
+            atomic_load_explicit(&s->watching->ended, memory_order_relaxed) != s->shown_end);
+}
+
+int session_spectate(Session *s) {
+    if (!session_spectate_due(s)) return 0;
+    ui_set_target(&s->out);
+    int drawn = draw_watched(s);
+    if (drawn) ui_buffer_append(&s->out, &(char){SESSION_FRAME_END}, 1);
+    ui_set_target(NULL);
+    return drawn;
+}
+
+void session_free(Session *s) {
+    spectate_close(s->feed);
+    spectate_unwatch(s->watching);
+    session_release(s);
+    world_release(s->sleeping_world);
+    ui_buffer_free(&s->out);
+}
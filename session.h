@@ -0,0 +1,108 @@
+#ifndef SESSION_H
+#define SESSION_H
+
+#include "arena.h"
+#include "dungeon.h"
+#include "eventlog.h"
+#include "history.h"
+#include "metrics.h"
+#include "player.h"
+#include "rng.h"
+#include "spectate.h"
+#include "ui.h"
+#include "world.h"
+
+/*
+ * Session - one player's game, driven a line at a time instead of from
+ * stdin, for the multi-player server (server.c).
+ *
+ * A session owns everything main() keeps for a single game: its own arena
+ * (map, event log, undo history), player and position. The maze comes
+ * from a WorldPool shared by all sessions, so the map only holds this
+ * player's changes (a few KB). Each command line
+ * runs the same rules as the terminal game and renders the next screen
+ * into `out` rather than to stdout, followed by SESSION_FRAME_END so a
+ * client knows the response is complete.
+ *
+ * Sessions share nothing mutable (the world is read-only and each draws
+ * its dice from its own `rng`), so different sessions can run commands on
+ * different threads at once. One session's commands must run one at a
+ * time, in order.
+ *
+ * An idle session can be hibernated: its changes (player, overlay slots,
+ * event log) are written to a file of a few KB and its memory released,
+ * keeping only this struct and a reference to its world. session_wake()
+ * reads it back. The undo history does not survive, so R cannot rewind
+ * past a hibernation.
+ *
+ * A shared session (session_share) publishes its game to a SpectateFeed
+ * after each command while someone watches. Instead of choosing a class,
+ * a client can send "watch" to list the games it could watch and
+ * "watch <id>" to become a spectator: its own memory is released and it
+ * draws frames from the feed, without ever touching the player's session.
+ */
+
+#define SESSION_FRAME_END '\0'  // Last byte of every response
+
+typedef enum {
+    SESSION_CHOOSE_CLASS,  // Waiting for a class number
+    SESSION_PLAYING,
+    SESSION_GAME_OVER,     // Waiting for Y/N to "Start a new game?"
+    SESSION_WATCHING,      // A spectator of another session's game
+    SESSION_CLOSED         // Player said no; the connection can go
+} SessionPhase;
+
+typedef struct {
+    SessionPhase phase;
+    Arena arena;
+    Map *map;
+    EventLog *log;
+    History *history;
+    Player player;
+    WorldPool *worlds;  // Where new games get their world (NULL = generate a private one)
+    Rng rng;            // Every roll this session's game makes
+    PlayerClass player_class;
+    Position pos;
+    GameState state;
+    BattleState battle;
+    UiBuffer out;  // Rendered responses not yet sent
+    int hibernated;               // State is in a file; map, log and history are gone
+    struct World *sleeping_world; // The map's world, kept while hibernated
+    SpectateFeed *feed;           // Where this game is published (NULL = not shared)
+    SpectateFeed *watching;       // The game a spectator watches
+    unsigned long watching_id;
+    unsigned shown;               // Feed version of the last frame drawn (spectators)
+    int shown_end;                // ... and whether it said the player left
+} Session;
+
+// Reserve the session's memory, seed its dice with `seed` and render the
+// class menu into `out`. Returns 0, or -1 if the arena could not be reserved.
+int session_init(Session *s, WorldPool *worlds, uint64_t seed);
+
+// Run one command line (without its newline) and append the response to
+// `out`. Returns the metrics phase the command falls under.
+MetricPhase session_command(Session *s, const char *line);
+
+// Let spectators find this game as `id`. Returns 0, or -1 if out of memory.
+int session_share(Session *s, unsigned long id);
+
+// A spectator's feed has moved on since its last frame
+int session_spectate_due(Session *s);
+
+// Spectator: render a frame of the watched game into `out` if it changed.
+// Returns 1 if it drew one.
+int session_spectate(Session *s);
+
+// Write the session's state to `path` and release its memory. The output
+// buffer must be sent first (it is freed). Returns 0, or -1 if the file
+// could not be written (the session is unchanged).
+int session_hibernate(Session *s, const char *path);
+
+// Restore a session hibernated to `path` and delete the file. Returns 0,
+// or -1 if the file is missing or damaged (the session stays hibernated).
+int session_wake(Session *s, const char *path);
+
+// Release the session (hibernated or not); its file, if any, is the caller's
+void session_free(Session *s);
+
+#endif
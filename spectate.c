@@ -0,0 +1,140 @@
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "spectate.h"
+
+#define READ_TRIES 4
+
+// Feeds spectators can find, oldest first (only touched on open, close and find)
+static pthread_mutex_t registry_lock = PTHREAD_MUTEX_INITIALIZER;
+static SpectateFeed *registry;
+
+static void spectate_release(SpectateFeed *feed) {
+    if (atomic_fetch_sub(&feed->refs, 1) == 1) free(feed);
+}
+
+void spectate_capture(SpectatorView *view, SpectateStatus status, const Player *player,
+                      const Position *pos, const Map *map, GameState state, const BattleState *battle) {
+    memset(view, 0, sizeof(*view));
+    view->status = status;
+    view->state = state;
+    view->player_class = player->player_class;
+    view->pos = *pos;
+    view->level = player->level;
+    view->health = player->health;
+    view->max_health = player->max_health;
+    view->experience = player->experience;
+    view->exp_to_next_level = player->exp_to_next_level;
+    view->gold = player->gold;
+    view->damage = player->total_damage;
+    view->defense = player->total_defense;
+    if (state == STATE_BATTLE && battle->is_active) {
+        view->in_battle = 1;
+        snprintf(view->monster, sizeof(view->monster), "%s", battle->monster.name);
+        view->monster_level = battle->monster.level;
+        view->monster_hp = battle->monster_hp;
+        view->monster_max_hp = battle->monster.hp;
+    }
+    for (int dy = 0; dy < SPECTATE_SIDE; dy++) {
+        int y = pos->y - SPECTATE_RADIUS + dy;
+        for (int dx = 0; dx < SPECTATE_SIDE; dx++) {
+            int x = pos->x - SPECTATE_RADIUS + dx;
+            int on_map = x >= 0 && x < MAP_SIZE && y >= 0 && y < MAP_SIZE;
+            view->tiles[dy][dx] = on_map ? map_glyph(map, x, y) : ' ';
+        }
+    }
+}
+
+SpectateFeed *spectate_open(unsigned long id) {
+    SpectateFeed *feed = calloc(1, sizeof(*feed));
+    if (!feed) return NULL;
+    feed->id = id;
+    atomic_init(&feed->refs, 1);
+
+    pthread_mutex_lock(&registry_lock);
+    SpectateFeed **tail = &registry;
+    while (*tail) tail = &(*tail)->next;
+    *tail = feed;
+    pthread_mutex_unlock(&registry_lock);
+    return feed;
+}
+
+void spectate_close(SpectateFeed *feed) {
+    if (!feed) return;
+    pthread_mutex_lock(&registry_lock);
+    for (SpectateFeed **link = &registry; *link; link = &(*link)->next) {
+        if (*link == feed) {
+            *link = feed->next;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&registry_lock);
+    atomic_store(&feed->ended, 1);
+    spectate_release(feed);
+}
+
+SpectateFeed *spectate_watch(unsigned long id) {
+    pthread_mutex_lock(&registry_lock);
+    SpectateFeed *feed = registry;
+    while (feed && feed->id != id) feed = feed->next;
+    if (feed) {
+        atomic_fetch_add(&feed->refs, 1);
+        atomic_fetch_add(&feed->watchers, 1);
+    }
+    pthread_mutex_unlock(&registry_lock);
+    return feed;
+}
+
+void spectate_unwatch(SpectateFeed *feed) {
+    if (!feed) return;
+    atomic_fetch_sub(&feed->watchers, 1);
+    spectate_release(feed);
+}
+
+int spectate_list(unsigned long *ids, int max) {
+    int n = 0;
+    pthread_mutex_lock(&registry_lock);
+    for (SpectateFeed *feed = registry; feed && n < max; feed = feed->next) {
+        ids[n++] = feed->id;
+    }
+    pthread_mutex_unlock(&registry_lock);
+    return n;
+}
+
+/**
+ * Seqlock write: make the sequence odd, store the view, make it even
+ * again. Every word is stored atomically (relaxed), so a reader racing
+ * with this sees a torn copy at worst, never undefined behaviour, and the
+ * sequence check tells it to discard that copy.
+ */
+void spectate_publish(SpectateFeed *feed, SpectatorView *view) {
+    uint32_t words[SPECTATE_WORDS] = {0};
+    unsigned seq = atomic_load_explicit(&feed->seq, memory_order_relaxed);
+    view->turn = seq / 2 + 1;
+    memcpy(words, view, sizeof(*view));
+
+    atomic_store_explicit(&feed->seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);  // Odd before any word changes
+    for (size_t i = 0; i < SPECTATE_WORDS; i++) {
+        atomic_store_explicit(&feed->words[i], words[i], memory_order_relaxed);
+    }
+    atomic_store_explicit(&feed->seq, seq + 2, memory_order_release);
+}
+
+unsigned spectate_read(SpectateFeed *feed, SpectatorView *out) {
+    uint32_t words[SPECTATE_WORDS];
+    for (int attempt = 0; attempt < READ_TRIES; attempt++) {
+        unsigned before = atomic_load_explicit(&feed->seq, memory_order_acquire);
+        if (before & 1) continue;
+        for (size_t i = 0; i < SPECTATE_WORDS; i++) {
+            words[i] = atomic_load_explicit(&feed->words[i], memory_order_relaxed);
+        }
+        atomic_thread_fence(memory_order_acquire);  // Words read before the recheck
+        if (atomic_load_explicit(&feed->seq, memory_order_relaxed) == before) {
+            memcpy(out, words, sizeof(*out));
+            return before;
+        }
+    }
+    return 1;
+}
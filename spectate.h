@@ -0,0 +1,104 @@
+#ifndef SPECTATE_H
+#define SPECTATE_H
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include "dungeon.h"
+#include "enemies.h"
+#include "player.h"
+
+/*
+ * Spectate - a game's latest state, published for others to watch.
+ *
+ * After each command the session playing a game copies what a spectator
+ * shows (position, player stats, the explored tiles around the player,
+ * the battle) into a SpectatorView and publishes it through a seqlock:
+ * the sequence number is odd while a copy is being written, and a reader
+ * that sees it odd or changed after its copy throws the copy away. The
+ * player never waits for a spectator and spectators never wait for each
+ * other, so any number of them can watch one game from any thread.
+ *
+ * A game nobody watches publishes nothing, so its commands cost nothing
+ * extra; a new spectator sees the game from the player's next command.
+ *
+ * Feeds are registered by id so spectators can find them, and reference
+ * counted so a spectator can keep reading after the player has gone.
+ */
+
+#define SPECTATE_RADIUS 7
+#define SPECTATE_SIDE (2 * SPECTATE_RADIUS + 1)
+#define SPECTATE_NAME_LEN 32
+
+typedef enum {
+    SPECTATE_CHOOSING,  // No game yet (class menu)
+    SPECTATE_PLAYING,
+    SPECTATE_GAME_OVER
+} SpectateStatus;
+
+// What spectators are shown (plain data: no pointers into the game)
+typedef struct {
+    uint32_t turn;          // Publishes so far
+    int32_t status;         // SpectateStatus
+    int32_t state;          // GameState
+    int32_t player_class;
+    Position pos;
+    int32_t level, health, max_health, experience, exp_to_next_level, gold;
+    int32_t damage, defense;
+    int32_t in_battle;
+    char monster[SPECTATE_NAME_LEN];
+    int32_t monster_level, monster_hp, monster_max_hp;
+    char tiles[SPECTATE_SIDE][SPECTATE_SIDE];  // map_glyph() around pos; ' ' off the map
+} SpectatorView;
+
+#define SPECTATE_WORDS ((sizeof(SpectatorView) + sizeof(uint32_t) - 1) / sizeof(uint32_t))
+
+typedef struct SpectateFeed {
+    atomic_uint seq;                          // Odd while a publish is under way
+    _Atomic uint32_t words[SPECTATE_WORDS];   // The view, a word at a time
+    atomic_int watchers;                      // Spectators attached
+    atomic_int ended;                         // The player has gone
+    atomic_int refs;
+    unsigned long id;
+    struct SpectateFeed *next;                // Registry list
+} SpectateFeed;
+
+// Fill `view` from a game in progress (everything but `turn`)
+void spectate_capture(SpectatorView *view, SpectateStatus status, const Player *player,
+                      const Position *pos, const Map *map, GameState state, const BattleState *battle);
+
+// Register a feed for `id` (the caller's reference). Returns NULL if out of memory.
+SpectateFeed *spectate_open(unsigned long id);
+
+// The player is gone: unregister the feed and drop the player's reference
+void spectate_close(SpectateFeed *feed);
+
+// Start watching the feed registered for `id`: returns it with a
+// reference for the caller, counted as a watcher, or NULL if there is none
+SpectateFeed *spectate_watch(unsigned long id);
+
+// Stop watching and drop the reference spectate_watch() gave
+void spectate_unwatch(SpectateFeed *feed);
+
+// Up to `max` registered ids, oldest first; returns how many
+int spectate_list(unsigned long *ids, int max);
+
+// Whether anyone is watching (publishing can be skipped if not)
+static inline int spectate_watched(SpectateFeed *feed) {
+    return atomic_load_explicit(&feed->watchers, memory_order_relaxed) > 0;
+}
+
+// Publish a new view. Only one thread may publish to a feed at a time.
+void spectate_publish(SpectateFeed *feed, SpectatorView *view);
+
+// The current sequence number: a reader can compare it with the one its
+// last read returned before bothering to read again
+static inline unsigned spectate_version(SpectateFeed *feed) {
+    return atomic_load_explicit(&feed->seq, memory_order_acquire);
+}
+
+// Copy the latest view into `out`. Returns its sequence number (even, 0 =
+// never published), or 1 if a publish kept getting in the way: the reader
+// does not wait, and can try again later.
+unsigned spectate_read(SpectateFeed *feed, SpectatorView *out);
+
+#endif
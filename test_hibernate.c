@@ -0,0 +1,225 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "gamedata.h"
+#include "session.h"
+#include "zobrist.h"
+
+/*
+ * Session hibernation test - plays a server session into a fight,
+ * hibernates it and wakes it again, checking the woken game is the one
+ * that went to sleep (state hash, battle, dice, event log) and plays on
+ * exactly like a twin that never slept. Damaged files (truncated, wrong
+ * magic) must be refused and leave the session hibernated.
+ *
+ * Build and run with: make test
+ */
+
+#define HIB_PATH "test_hibernate.hib"
+
+enum { SESSION_SEED = 31337, MAX_COMMANDS = 5000 };
+
+static int failures = 0;
+
+static void check(int ok, const char *what) {
+    if (!ok) {
+        if (failures < 20) printf("\nFAIL %s\n", what);
+        failures++;
+    }
+}
+
+// Run a command on both sessions and drop their output
+static void command_both(Session *a, Session *b, const char *line) {
+    session_command(a, line);
+    session_command(b, line);
+    a->out.len = 0;
+    b->out.len = 0;
+}
+
+// Everything a woken session must get back, copied before it sleeps
+typedef struct {
+    uint64_t hash;
+    uint32_t slots;
+    BattleState battle;
+    Rng rng;
+    Player player;
+    Position pos;
+    GameState state;
+    SessionPhase phase;
+    int events;
+    uint32_t log_head, log_turn;
+    GameEvent log[EVENTLOG_CAPACITY];
+} Remembered;
+
+static void remember(const Session *s, Remembered *r) {
+    memset(r, 0, sizeof(*r));
+    r->hash = zobrist_state(s->map, &s->player, s->pos);
+    r->slots = s->map->content_count;
+    r->battle = s->battle;
+    r->rng = s->rng;
+    r->player = s->player;
+    r->pos = s->pos;
+    r->state = s->state;
+    r->phase = s->phase;
+    r->events = eventlog_count(s->log);
+    r->log_head = s->log->head;
+    r->log_turn = s->log->turn;
+    for (int age = 0; age < r->events; age++) r->log[age] = *eventlog_get(s->log, age);
+}
+
+static void check_restored(const Session *s, const Remembered *r) {
+    check(!s->hibernated && s->map != NULL, "session still hibernated");
+    if (s->hibernated || !s->map) return;
+    check(zobrist_state(s->map, &s->player, s->pos) == r->hash, "state hash differs");
+    check(s->map->content_count == r->slots, "overlay slot count differs");
+    check(memcmp(&s->battle, &r->battle, sizeof(r->battle)) == 0, "battle differs");
+    check(s->rng.state == r->rng.state, "dice differ");
+    check(memcmp(&s->player, &r->player, sizeof(r->player)) == 0, "player differs");
+    check(s->pos.x == r->pos.x && s->pos.y == r->pos.y, "position differs");
+    check(s->state == r->state && s->phase == r->phase, "game state or phase differs");
+    check(eventlog_count(s->log) == r->events && s->log->head == r->log_head &&
+          s->log->turn == r->log_turn, "event log length differs");
+    int same = 1;
+    for (int age = 0; age < r->events && same; age++) {
+        const GameEvent *ev = eventlog_get(s->log, age);
+        same = ev && memcmp(ev, &r->log[age], sizeof(*ev)) == 0;
+    }
+    check(same, "event log contents differ");
+}
+
+static long file_size(const char *path) {
+    FILE *f = fopen(path, "rb");
+    if (!f) return -1;
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fclose(f);
+    return size;
+}
+
+static int read_file(const char *path, unsigned char *buf, long size) {
+    FILE *f = fopen(path, "rb");
+    if (!f) return -1;
+    int ok = fread(buf, 1, (size_t)size, f) == (size_t)size;
+    fclose(f);
+    return ok ? 0 : -1;
+}
+
+static int write_file(const char *path, const unsigned char *buf, long size) {
+    FILE *f = fopen(path, "wb");
+    if (!f) return -1;
+    int ok = fwrite(buf, 1, (size_t)size, f) == (size_t)size;
+    if (fclose(f) != 0) ok = 0;
+    return ok ? 0 : -1;
+}
+
+// Waking from a damaged copy must fail and keep the session asleep
+static void check_refused(Session *s, const unsigned char *file, long size, const char *what) {
+    write_file(HIB_PATH, file, size);
+    int refused = session_wake(s, HIB_PATH) == -1 && s->hibernated && s->map == NULL &&
+                  s->sleeping_world != NULL;
+    check(refused, what);
+}
+
+int main() {
+    char err[256];
+    if (gamedata_init(getenv("ADVENTURE_DATA"), err, sizeof(err)) != 0) {
+        fprintf(stderr, "Failed to load game data: %s\n", err);
+        return 1;
+    }
+
+    printf("Session Hibernation Test\n");
+    printf("========================\n\n");
+
+    // Two sessions with the same dice play the same commands into a fight
+    Session sleeper, twin;
+    if (session_init(&sleeper, NULL, SESSION_SEED) != 0 || session_init(&twin, NULL, SESSION_SEED) != 0) {
+        fprintf(stderr, "Failed to start the sessions\n");
+        return 1;
+    }
+    command_both(&sleeper, &twin, "1");
+    Rng walk = {SESSION_SEED};
+    for (int i = 0; i < MAX_COMMANDS && sleeper.phase == SESSION_PLAYING; i++) {
+        if (sleeper.state == STATE_BATTLE && sleeper.battle.is_active) break;
+        char line[2] = {"NSEW"[rng_next(&walk) >> 62], '\0'};
+        command_both(&sleeper, &twin, line);
+    }
+    int failures_before = failures;
+    printf("%-30s", "mid-game session");
+    check(sleeper.phase == SESSION_PLAYING && sleeper.state == STATE_BATTLE && sleeper.battle.is_active,
+          "no fight reached");
+    check(eventlog_count(sleeper.log) > 0, "event log empty");
+    check(sleeper.map->content_count > 0, "no overlay slots");
+    printf(" %s\n", failures == failures_before ? "ok" : "FAILED");
+
+    failures_before = failures;
+    printf("%-30s", "hibernate and wake");
+    Remembered before;
+    remember(&sleeper, &before);
+    check(session_hibernate(&sleeper, HIB_PATH) == 0, "session_hibernate failed");
+    check(sleeper.hibernated && sleeper.map == NULL, "hibernated session kept its memory");
+    // Only the file may bring the game back: scrub what the struct still holds
+    memset(&sleeper.player, 0xA5, sizeof(sleeper.player));
+    memset(&sleeper.battle, 0xA5, sizeof(sleeper.battle));
+    memset(&sleeper.pos, 0xA5, sizeof(sleeper.pos));
+    sleeper.rng.state = 1;
+    sleeper.state = STATE_MAP_VIEW;
+    sleeper.phase = SESSION_CLOSED;
+
+    long size = file_size(HIB_PATH);
+    unsigned char *file = size > 0 ? malloc((size_t)size) : NULL;
+    if (!file || read_file(HIB_PATH, file, size) != 0) {
+        check(0, "hibernation file unreadable");
+        printf(" FAILED\n");
+        return 1;
+    }
+    printf(" %s\n", failures == failures_before ? "ok" : "FAILED");
+
+    failures_before = failures;
+    printf("%-30s", "damaged files refused");
+    check_refused(&sleeper, file, 4, "file cut inside the magic accepted");
+    check_refused(&sleeper, file, 64, "file cut inside the header accepted");
+    check_refused(&sleeper, file, size / 2, "file cut in half accepted");
+    check_refused(&sleeper, file, size - 1, "file one byte short accepted");
+    file[0] ^= 0x20;
+    check_refused(&sleeper, file, size, "wrong magic accepted");
+    file[0] ^= 0x20;
+    printf(" %s\n", failures == failures_before ? "ok" : "FAILED");
+
+    // The refusals did not spoil the session: the intact file still wakes it
+    failures_before = failures;
+    printf("%-30s", "woken session restored");
+    write_file(HIB_PATH, file, size);
+    check(session_wake(&sleeper, HIB_PATH) == 0, "session_wake refused an intact file");
+    check_restored(&sleeper, &before);
+    check(file_size(HIB_PATH) == -1, "hibernation file not deleted after waking");
+    int restored = failures == failures_before;
+    printf(" %s\n", restored ? "ok" : "FAILED");
+
+    // ... and it fights on exactly like the twin that stayed awake (a
+    // session restored wrongly may hold anything, so it isn't played)
+    failures_before = failures;
+    printf("%-30s", "plays on like its twin");
+    if (restored) {
+        for (int i = 0; i < 20 && sleeper.phase == SESSION_PLAYING && twin.phase == SESSION_PLAYING; i++) {
+            command_both(&sleeper, &twin, sleeper.state == STATE_BATTLE ? "A" : "N");
+        }
+        Remembered awake;
+        remember(&twin, &awake);
+        check_restored(&sleeper, &awake);
+    } else {
+        check(0, "not restored, not played");
+    }
+    printf(" %s\n", failures == failures_before ? "ok" : "FAILED");
+
+    remove(HIB_PATH);
+    free(file);
+    session_free(&sleeper);
+    session_free(&twin);
+    gamedata_shutdown();
+    if (failures) {
+        printf("\n%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("\nAll session hibernation checks passed.\n");
+    return 0;
+}
@@ -0,0 +1,232 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "dungeon.h"
+#include "enemies.h"
+#include "eventlog.h"
+#include "gamedata.h"
+#include "history.h"
+#include "player.h"
+#include "rng.h"
+#include "zobrist.h"
+
+/*
+ * Undo history test - plays turns the way the game loop does (begin turn,
+ * handle_command, end turn) with fixed dice, then rewinds them one at a
+ * time and checks each rewind lands on the state recorded before that
+ * turn: same state hash, same number of content slots. Also covers the
+ * image ring overflowing and marks that have been forgotten.
+ *
+ * Build and run with: make test
+ */
+
+enum { PLAY_TURNS = 300, CHUNKS_PER_TURN = 200 };
+
+static int failures = 0;
+
+// One game, as main() keeps it
+typedef struct {
+    Map map;
+    EventLog log;
+    History history;
+    Player player;
+    Position pos;
+    GameState state;
+    BattleState battle;
+} Game;
+
+// What a turn started from
+typedef struct {
+    uint64_t hash;
+    uint32_t slots;
+    Position pos;
+    GameState state;
+} Snapshot;
+
+static Game game;
+
+static void check(int ok, const char *what) {
+    if (!ok) {
+        if (failures < 20) printf("\nFAIL %s\n", what);
+        failures++;
+    }
+}
+
+static Snapshot snapshot(const Game *g) {
+    return (Snapshot){zobrist_state(&g->map, &g->player, g->pos), g->map.content_count, g->pos, g->state};
+}
+
+static int same_state(const Game *g, const Snapshot *want) {
+    Snapshot now = snapshot(g);
+    return now.hash == want->hash && now.slots == want->slots &&
+           now.pos.x == want->pos.x && now.pos.y == want->pos.y && now.state == want->state;
+}
+
+static void new_game(Game *g, uint32_t seed) {
+    if (g->map.seed == seed) {
+        map_attach(&g->map, g->map.world);
+    } else {
+        map_generate_seeded(&g->map, seed);
+    }
+    eventlog_init(&g->log);
+    history_init(&g->history);
+    g->map.history = &g->history;
+    player_init(&g->player, CLASS_WARRIOR);
+    // Never die: the test is about undoing turns, not about the fights
+    g->player.max_health = g->player.health = 1000000;
+    g->pos = (Position){MAP_CENTER, MAP_CENTER};
+    g->state = STATE_EXPLORING;
+    g->battle = (BattleState){0};
+}
+
+// One turn of the main loop
+static void play(Game *g, char command) {
+    int running = 1;
+    eventlog_begin_turn(&g->log);
+    history_begin_turn(&g->history, &g->player, g->pos, g->state, &g->battle);
+    handle_command(command, &running, &g->pos, &g->player, &g->log, &g->map, &g->state, &g->battle);
+    history_end_turn(&g->history, &g->player, g->pos, g->state, &g->battle);
+}
+
+static int rewind_one(Game *g) {
+    return history_rewind(&g->history, &g->map, 1, &g->player, &g->pos, &g->state, &g->battle);
+}
+
+// A turn that consumes one tile in each of `count` chunks from `first`
+static void consume_chunks(Game *g, int first, int count) {
+    history_begin_turn(&g->history, &g->player, g->pos, g->state, &g->battle);
+    for (int c = first; c < first + count; c++) {
+        int x = (c % HISTORY_CHUNK_ROW) << HISTORY_CHUNK_SHIFT;
+        int y = (c / HISTORY_CHUNK_ROW) << HISTORY_CHUNK_SHIFT;
+        map_consume(&g->map, x, y);
+    }
+    history_end_turn(&g->history, &g->player, g->pos, g->state, &g->battle);
+}
+
+/**
+ * Random moves (attacks while in a fight), recording the state each turn
+ * began from by the mark it starts at. Turns that change nothing (walking
+ * into a wall) are dropped by history_end_turn and must not be rewound.
+ */
+static void test_play_and_rewind(void) {
+    static Snapshot before[HISTORY_TURNS];
+    Rng rng = {2024};
+    int failures_before = failures;
+    printf("%-30s", "rewind turn by turn");
+
+    new_game(&game, 77);
+    rng_set_current(&rng);
+    int dropped = 0, battles = 0;
+    for (int turn = 0; turn < PLAY_TURNS; turn++) {
+        HistoryMark mark = history_mark(&game.history);
+        Snapshot s = snapshot(&game);
+        char command = game.state == STATE_BATTLE ? 'A' : "NSEW"[rng_rand() % 4];
+        battles += game.state == STATE_BATTLE;
+        play(&game, command);
+        if (history_mark(&game.history) == mark) {
+            dropped++;
+            check(same_state(&game, &s), "dropped turn changed the state");
+        } else {
+            before[mark % HISTORY_TURNS] = s;
+        }
+    }
+    rng_set_current(NULL);
+    check(dropped > 0, "no turn was dropped (walk never hit a wall)");
+    check(battles > 0, "no battle was fought");
+    check(history_depth(&game.history) == HISTORY_TURNS, "history not full after many turns");
+
+    while (history_depth(&game.history) > 0) {
+        check(rewind_one(&game) == 1, "rewind undid no turn");
+        const Snapshot *want = &before[history_mark(&game.history) % HISTORY_TURNS];
+        check(same_state(&game, want), "rewind did not restore the state the turn began from");
+    }
+    check(rewind_one(&game) == 0, "rewound past the oldest turn");
+    printf(" %s\n", failures == failures_before ? "ok" : "FAILED");
+}
+
+/**
+ * Turns of CHUNKS_PER_TURN images each: the third no longer fits beside
+ * the first, which is forgotten. A turn that needs more images than the
+ * whole ring clears the history and can't be undone.
+ */
+static void test_image_overflow(void) {
+    int failures_before = failures;
+    printf("%-30s", "image ring overflow");
+
+    new_game(&game, 78);
+    Snapshot start = snapshot(&game);
+    consume_chunks(&game, 0, CHUNKS_PER_TURN);
+    Snapshot after_first = snapshot(&game);
+    consume_chunks(&game, CHUNKS_PER_TURN, CHUNKS_PER_TURN);
+    Snapshot after_second = snapshot(&game);
+    consume_chunks(&game, 2 * CHUNKS_PER_TURN, CHUNKS_PER_TURN);
+    check(history_depth(&game.history) == 2, "oldest turn not forgotten when the images ran out");
+    check(rewind_one(&game) == 1 && same_state(&game, &after_second), "newest turn not restored");
+    check(rewind_one(&game) == 1 && same_state(&game, &after_first), "second turn not restored");
+    check(rewind_one(&game) == 0 && same_state(&game, &after_first), "forgotten turn was undone");
+    check(!same_state(&game, &start), "first turn changed nothing");
+
+    // One turn larger than the ring
+    consume_chunks(&game, 0, HISTORY_IMAGES + 10);
+    Snapshot after_big = snapshot(&game);
+    check(history_depth(&game.history) == 0, "oversized turn left history behind");
+    check(rewind_one(&game) == 0 && same_state(&game, &after_big), "oversized turn was undone");
+
+    // The history works again from the next turn
+    consume_chunks(&game, HISTORY_IMAGES + 10, 3);
+    check(history_depth(&game.history) == 1, "turn after an overflow not recorded");
+    check(rewind_one(&game) == 1 && same_state(&game, &after_big), "turn after an overflow not restored");
+    printf(" %s\n", failures == failures_before ? "ok" : "FAILED");
+}
+
+static void test_marks(void) {
+    int failures_before = failures;
+    printf("%-30s", "rewind to marks");
+
+    new_game(&game, 79);
+    HistoryMark old = history_mark(&game.history);
+    Snapshot at_old = snapshot(&game);
+    for (int turn = 0; turn < 5; turn++) consume_chunks(&game, turn, 1);
+    check(history_rewind_to(&game.history, &game.map, old, &game.player, &game.pos,
+                            &game.state, &game.battle) == 5, "rewind to a mark undid the wrong number of turns");
+    check(same_state(&game, &at_old), "rewind to a mark did not restore its state");
+
+    // Play the mark out of the turn ring
+    old = history_mark(&game.history);
+    for (int turn = 0; turn < HISTORY_TURNS + 5; turn++) consume_chunks(&game, turn, 1);
+    Snapshot now = snapshot(&game);
+    check(history_rewind_to(&game.history, &game.map, old, &game.player, &game.pos,
+                            &game.state, &game.battle) == -1, "forgotten mark not refused");
+    check(same_state(&game, &now), "refused rewind changed the state");
+    check(history_depth(&game.history) == HISTORY_TURNS, "refused rewind changed the history");
+    printf(" %s\n", failures == failures_before ? "ok" : "FAILED");
+}
+
+int main() {
+    char err[256];
+    if (gamedata_init(getenv("ADVENTURE_DATA"), err, sizeof(err)) != 0) {
+        fprintf(stderr, "Failed to load game data: %s\n", err);
+        return 1;
+    }
+    map_init(&game.map, NULL);
+    if (map_generate_seeded(&game.map, 77) != 0) {
+        fprintf(stderr, "Failed to generate the map\n");
+        return 1;
+    }
+
+    printf("Undo History Test\n");
+    printf("=================\n\n");
+
+    test_play_and_rewind();
+    test_image_overflow();
+    test_marks();
+
+    map_free(&game.map);
+    gamedata_shutdown();
+    if (failures) {
+        printf("\n%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("\nAll undo history checks passed.\n");
+    return 0;
+}
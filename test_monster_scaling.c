@@ -1,46 +1,97 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include "enemies.h"
+#include "gamedata.h"
+
+/*
+ * Monster scaling test - rolls every registry template through
+ * monster_generate() at a range of player levels and checks each result
+ * against the scaling formula (level window, +-20% stat variance).
+ *
+ * Build and run with: make test
+ */
+
+enum { SAMPLES = 500, MAX_PLAYER_LEVEL = 25 };
+
+static int failures = 0;
+
+static void check_stat(const char *monster, const char *stat, int player_lvl, int value, int base, int floor_value) {
+    int variance = base / 5;
+    int lo = base - variance;
+    int hi = base + variance;
+    if (lo < floor_value) lo = floor_value;
+    if (hi < floor_value) hi = floor_value;
+    if (value < lo || value > hi) {
+        if (failures < 20) {
+            printf("FAIL %s %s at player level %d: %d outside %d-%d\n",
+                   monster, stat, player_lvl, value, lo, hi);
+        }
+        failures++;
+    }
+}
 
-// Quick test to verify monster scaling calculations
 int main() {
+    char err[256];
+    if (gamedata_init(getenv("ADVENTURE_DATA"), err, sizeof(err)) != 0) {
+        fprintf(stderr, "Failed to load game data: %s\n", err);
+        return 1;
+    }
+    const GameData *gd = gamedata();
+    srand(1);
+
     printf("Monster Scaling Test\n");
     printf("====================\n\n");
-    
-    // Goblin template: base_hp=25, hp_per_level=8
-    printf("GOBLIN (base HP: 25, +8 per level)\n");
-    for (int player_lvl = 1; player_lvl <= 10; player_lvl++) {
-        int level_min = player_lvl - 2;
-        int level_max = player_lvl + 2;
-        if (level_min < 1) level_min = 1;
-        if (level_max < 1) level_max = 1;
-        
-        printf("Player Lvl %2d: Monster Lvl %d-%d | ", player_lvl, level_min, level_max);
-        
-        // Calculate at min and max level
-        int hp_min = 25 + (level_min - 1) * 8;
-        int hp_max = 25 + (level_max - 1) * 8;
-        
-        int attack_min = 5 + (level_min - 1) * 2;
-        int attack_max = 5 + (level_max - 1) * 2;
-        
-        printf("HP: %d-%d | Attack: %d-%d\n", hp_min, hp_max, attack_min, attack_max);
+
+    for (int i = 0; i < gd->monster_count; i++) {
+        const MonsterTemplate *t = &gd->monsters[i];
+        int failures_before = failures;
+        printf("%-16s", t->name);
+
+        for (int player_lvl = 1; player_lvl <= MAX_PLAYER_LEVEL; player_lvl++) {
+            int level_min = player_lvl + t->level_offset_min;
+            int level_max = player_lvl + t->level_offset_max;
+            if (level_min < t->min_level) level_min = t->min_level;
+            if (level_max < t->min_level) level_max = t->min_level;
+
+            int seen_min = 1 << 30, seen_max = 0;
+            for (int s = 0; s < SAMPLES; s++) {
+                Monster m = monster_generate(t, player_lvl);
+                if (m.level < level_min || m.level > level_max) {
+                    if (failures < 20) {
+                        printf("\nFAIL %s level %d outside %d-%d at player level %d\n",
+                               t->name, m.level, level_min, level_max, player_lvl);
+                    }
+                    failures++;
+                    continue;
+                }
+                if (m.level < seen_min) seen_min = m.level;
+                if (m.level > seen_max) seen_max = m.level;
+
+                check_stat(t->name, "hp", player_lvl, m.hp,
+                           t->base_hp + (m.level - 1) * t->hp_per_level, 1);
+                check_stat(t->name, "attack", player_lvl, m.attack,
+                           t->base_attack + (m.level - 1) * t->attack_per_level, 1);
+                check_stat(t->name, "defense", player_lvl, m.defense,
+                           t->base_defense + (m.level - 1) * t->defense_per_level, 0);
+            }
+
+            // Over many samples both ends of the level window should show up
+            if (seen_min != level_min || seen_max != level_max) {
+                if (failures < 20) {
+                    printf("\nFAIL %s at player level %d: levels seen %d-%d, expected %d-%d\n",
+                           t->name, player_lvl, seen_min, seen_max, level_min, level_max);
+                }
+                failures++;
+            }
+        }
+        printf(" %s\n", failures == failures_before ? "ok" : "FAILED");
     }
-    
-    printf("\nDRAGON (base HP: 120, +30 per level, offset +3 to +7)\n");
-    for (int player_lvl = 1; player_lvl <= 10; player_lvl++) {
-        int level_min = player_lvl + 3;
-        int level_max = player_lvl + 7;
-        
-        printf("Player Lvl %2d: Monster Lvl %d-%d | ", player_lvl, level_min, level_max);
-        
-        int hp_min = 120 + (level_min - 1) * 30;
-        int hp_max = 120 + (level_max - 1) * 30;
-        
-        int attack_min = 18 + (level_min - 1) * 6;
-        int attack_max = 18 + (level_max - 1) * 6;
-        
-        printf("HP: %d-%d | Attack: %d-%d\n", hp_min, hp_max, attack_min, attack_max);
+
+    gamedata_shutdown();
+    if (failures) {
+        printf("\n%d check(s) failed\n", failures);
+        return 1;
     }
-    
+    printf("\nAll monster scaling checks passed.\n");
     return 0;
 }
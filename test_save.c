@@ -0,0 +1,269 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "dungeon.h"
+#include "gamedata.h"
+#include "player.h"
+#include "rle.h"
+#include "rng.h"
+#include "save.h"
+#include "zobrist.h"
+
+/*
+ * Save format test - round-trips bit layers through the run-length codec
+ * (rle.h), feeds the decoder malformed input, and writes a game through
+ * the autosave thread to check that reading it back restores the same
+ * state hash.
+ *
+ * Build and run with: make test
+ */
+
+#define LAYER_BITS SAVE_LAYER_BITS
+#define SAVE_PATH "adventure.sav.test"
+
+enum { WALK_STEPS = 5000 };
+
+static int failures = 0;
+
+static uint8_t layer[(LAYER_BITS + 7) / 8];
+static uint8_t decoded[(LAYER_BITS + 7) / 8];
+static uint8_t from_runs[(LAYER_BITS + 7) / 8];
+static uint8_t encoded[RLE_MAX_BYTES(LAYER_BITS) + 16];
+
+static void check(int ok, const char *what) {
+    if (!ok) {
+        if (failures < 20) printf("\nFAIL %s\n", what);
+        failures++;
+    }
+}
+
+static int get_bit(const uint8_t *bits, size_t i) {
+    return (bits[i >> 3] >> (i & 7)) & 1;
+}
+
+static void set_bit(uint8_t *bits, size_t i) {
+    bits[i >> 3] |= (uint8_t)(1u << (i & 7));
+}
+
+static int same_bits(const uint8_t *a, const uint8_t *b, size_t nbits) {
+    for (size_t i = 0; i < nbits; i++) {
+        if (get_bit(a, i) != get_bit(b, i)) return 0;
+    }
+    return 1;
+}
+
+// Collect the runs of 1s rle_decode_runs() reports into `from_runs`
+static void collect_run(void *ctx, size_t start, size_t count) {
+    uint8_t *bits = ctx;
+    for (size_t i = start; i < start + count; i++) set_bit(bits, i);
+}
+
+typedef enum { LAYER_EMPTY, LAYER_FULL, LAYER_TRAIL, LAYER_NOISE } LayerKind;
+
+static const char *kind_names[] = {"empty", "full", "trail", "noise"};
+
+/**
+ * Fill the first `nbits` of `layer`. The padding bits after them are set
+ * on purpose: the encoder must not carry them into its output.
+ */
+static void fill_layer(LayerKind kind, size_t nbits, Rng *rng) {
+    memset(layer, 0xFF, sizeof(layer));
+    for (size_t i = 0; i < nbits; i++) layer[i >> 3] &= (uint8_t)~(1u << (i & 7));
+    switch (kind) {
+    case LAYER_EMPTY:
+        break;
+    case LAYER_FULL:
+        for (size_t i = 0; i < nbits; i++) set_bit(layer, i);
+        break;
+    case LAYER_TRAIL:
+        // Runs of every length class: single bits, byte and word crossings, long stretches
+        for (size_t i = 0; i < nbits; i += 1 + rng_next(rng) % 300) {
+            size_t run = 1 + rng_next(rng) % 90;
+            for (size_t j = i; j < i + run && j < nbits; j++) set_bit(layer, j);
+            i += run;
+        }
+        break;
+    case LAYER_NOISE:
+        for (size_t i = 0; i < nbits; i++) {
+            if (rng_next(rng) >> 63) set_bit(layer, i);
+        }
+        break;
+    }
+}
+
+static void check_round_trip(LayerKind kind, size_t nbits, Rng *rng) {
+    fill_layer(kind, nbits, rng);
+    size_t len = rle_encode(layer, nbits, encoded);
+    check(len >= 1 && len <= RLE_MAX_BYTES(nbits), "encoding longer than RLE_MAX_BYTES");
+    if (kind == LAYER_NOISE && nbits >= 64) check(encoded[0] == RLE_RAW, "noise not stored raw");
+    if (kind != LAYER_NOISE && nbits >= 1000) check(encoded[0] == RLE_RUNS, "uniform or trail layer stored raw");
+
+    memset(decoded, 0xAA, sizeof(decoded));
+    check(rle_decode(encoded, len, decoded, nbits) == 0, "rle_decode rejected its own encoding");
+    check(same_bits(layer, decoded, nbits), "rle_decode changed the layer");
+
+    memset(from_runs, 0, sizeof(from_runs));
+    check(rle_decode_runs(encoded, len, nbits, collect_run, from_runs) == 0,
+          "rle_decode_runs rejected its own encoding");
+    check(same_bits(layer, from_runs, nbits), "rle_decode_runs reported different runs");
+    check(rle_decode_runs(encoded, len, nbits, NULL, NULL) == 0, "validation-only decode failed");
+}
+
+static void test_round_trips(void) {
+    static const size_t sizes[] = {0, 1, 7, 8, 13, 63, 64, 65, 1001, 4099, LAYER_BITS};
+    Rng rng = {0x5EED};
+    for (int kind = LAYER_EMPTY; kind <= LAYER_NOISE; kind++) {
+        int failures_before = failures;
+        printf("round trip %-16s", kind_names[kind]);
+        for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+            check_round_trip((LayerKind)kind, sizes[i], &rng);
+        }
+        printf(" %s\n", failures == failures_before ? "ok" : "FAILED");
+    }
+}
+
+static void test_malformed(void) {
+    const size_t nbits = 4099;
+    Rng rng = {0xBAD};
+    int failures_before = failures;
+    printf("%-27s", "malformed input rejected");
+
+    check(rle_decode_runs(encoded, 0, nbits, NULL, NULL) == -1, "empty input accepted");
+    encoded[0] = 7;
+    check(rle_decode_runs(encoded, 1, nbits, NULL, NULL) == -1, "unknown format byte accepted");
+
+    // Run-coded: every cut short of the end, and one byte too many
+    fill_layer(LAYER_TRAIL, nbits, &rng);
+    size_t len = rle_encode(layer, nbits, encoded);
+    for (size_t cut = 1; cut < len; cut++) {
+        check(rle_decode_runs(encoded, cut, nbits, NULL, NULL) == -1, "truncated runs accepted");
+    }
+    encoded[len] = 0;
+    check(rle_decode_runs(encoded, len + 1, nbits, NULL, NULL) == -1, "trailing garbage accepted");
+    check(rle_decode(encoded, len + 1, decoded, nbits) == -1, "rle_decode accepted trailing garbage");
+
+    // Runs adding up to more than nbits, and a varint that never ends
+    uint8_t longer[] = {RLE_RUNS, 0x84, 0x20};  // 4100 zeros
+    check(rle_decode_runs(longer, sizeof(longer), nbits, NULL, NULL) == -1, "over-long run accepted");
+    uint8_t overshoot[] = {RLE_RUNS, 0x80, 0x20, 0x05};  // 4096 zeros, then 5 ones
+    check(rle_decode_runs(overshoot, sizeof(overshoot), nbits, NULL, NULL) == -1, "runs past nbits accepted");
+    uint8_t endless[12] = {RLE_RUNS};
+    memset(endless + 1, 0x80, sizeof(endless) - 1);
+    check(rle_decode_runs(endless, sizeof(endless), nbits, NULL, NULL) == -1, "unterminated varint accepted");
+
+    // Raw: the length must be exact
+    fill_layer(LAYER_NOISE, nbits, &rng);
+    len = rle_encode(layer, nbits, encoded);
+    check(encoded[0] == RLE_RAW, "noise not stored raw");
+    check(rle_decode_runs(encoded, len - 1, nbits, NULL, NULL) == -1, "truncated raw layer accepted");
+    encoded[len] = 0;
+    check(rle_decode_runs(encoded, len + 1, nbits, NULL, NULL) == -1, "raw layer with trailing garbage accepted");
+    check(rle_decode(encoded, len + 1, decoded, nbits) == -1, "rle_decode accepted a long raw layer");
+
+    printf(" %s\n", failures == failures_before ? "ok" : "FAILED");
+}
+
+/**
+ * Wander the map visiting tiles and consuming what is on them, autosave
+ * the result, then read it back onto a fresh map of the same seed.
+ */
+static void test_save_round_trip(void) {
+    const uint32_t seed = 424242;
+    int failures_before = failures;
+    printf("%-27s", "save read back");
+
+    Map map;
+    map_init(&map, NULL);
+    if (map_generate_seeded(&map, seed) != 0) {
+        check(0, "world generation failed");
+        printf(" FAILED\n");
+        return;
+    }
+    Player player;
+    player_init(&player, CLASS_WARRIOR);
+    Position pos = {MAP_CENTER, MAP_CENTER};
+    Rng rng = {seed};
+    map_set_visited(&map, pos.x, pos.y, 1);
+    for (int step = 0; step < WALK_STEPS; step++) {
+        static const int dx[] = {0, 0, 1, -1}, dy[] = {-1, 1, 0, 0};
+        int dir = (int)(rng_next(&rng) >> 62);
+        if (!map_can_move(&map, pos.x + dx[dir], pos.y + dy[dir])) continue;
+        pos.x += dx[dir];
+        pos.y += dy[dir];
+        map_set_visited(&map, pos.x, pos.y, 1);
+        TileData tile;
+        map_tile_content(&map, pos.x, pos.y, &tile);
+        if (tile.content != CONTENT_EMPTY && !tile.is_looted) {
+            map_consume(&map, pos.x, pos.y);
+            player.gold += tile.treasure_value;
+        }
+    }
+    uint64_t played = zobrist_state(&map, &player, pos);
+
+    remove(SAVE_PATH);
+    Autosave as;
+    check(autosave_init(&as, SAVE_PATH, 1) == 0, "autosave_init failed");
+    autosave_tick(&as, 1, 1, &player, &pos, &map);
+    autosave_shutdown(&as);
+
+    SaveGame saved;
+    char err[256];
+    if (save_read(SAVE_PATH, &saved, err, sizeof(err)) != 0) {
+        if (failures < 20) printf("\nFAIL save_read: %s\n", err);
+        failures++;
+    } else {
+        check(saved.seed == seed, "seed not saved");
+        check(saved.state_hash == played, "saved state hash differs");
+
+        Map loaded;
+        map_init(&loaded, NULL);
+        check(map_generate_seeded(&loaded, saved.seed) == 0, "world generation failed");
+        check(save_apply(&saved, &loaded) == 0, "save_apply refused a good save");
+        check(zobrist_state(&loaded, &saved.player, saved.pos) == played, "restored state hash differs");
+        check(loaded.content_count == map.content_count, "restored slot count differs");
+        int same = 1;
+        for (int y = 0; y < MAP_SIZE && same; y++) {
+            for (int x = 0; x < MAP_SIZE; x++) {
+                if (map_is_visited(&loaded, x, y) != map_is_visited(&map, x, y) ||
+                    map_is_looted(&loaded, x, y) != map_is_looted(&map, x, y)) {
+                    same = 0;
+                    break;
+                }
+            }
+        }
+        check(same, "restored tile flags differ");
+
+        // A save that does not hash to its own state is refused
+        saved.state_hash ^= 1;
+        map_attach(&loaded, loaded.world);
+        check(save_apply(&saved, &loaded) == -1, "save_apply accepted a wrong state hash");
+        map_free(&loaded);
+        save_release(&saved);
+    }
+    remove(SAVE_PATH);
+    map_free(&map);
+    printf(" %s\n", failures == failures_before ? "ok" : "FAILED");
+}
+
+int main() {
+    char err[256];
+    if (gamedata_init(getenv("ADVENTURE_DATA"), err, sizeof(err)) != 0) {
+        fprintf(stderr, "Failed to load game data: %s\n", err);
+        return 1;
+    }
+
+    printf("Save Format Test\n");
+    printf("================\n\n");
+
+    test_round_trips();
+    test_malformed();
+    test_save_round_trip();
+
+    gamedata_shutdown();
+    if (failures) {
+        printf("\n%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("\nAll save format checks passed.\n");
+    return 0;
+}
@@ -0,0 +1,98 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "trace.h"
+
+#ifndef TRACE_BUFFER_EVENTS
+#define TRACE_BUFFER_EVENTS (1 << 16)  // Per thread; later events are dropped
+#endif
+
+typedef struct {
+    const char *name;
+    uint64_t ts_ns;
+    char phase;  // 'B' or 'E'
+} TraceEvent;
+
+typedef struct TraceBuffer {
+    struct TraceBuffer *next;   // Registry link (set once, before publishing)
+    int tid;
+    atomic_uint count;          // Published events
+    unsigned int dropped;
+    TraceEvent events[TRACE_BUFFER_EVENTS];
+} TraceBuffer;
+
+static _Atomic(TraceBuffer *) registry = NULL;
+static atomic_int next_tid = 1;
+static _Thread_local TraceBuffer *local = NULL;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * This thread's buffer, created and pushed onto the registry (lock-free
+ * CAS) on first use
+ */
+static TraceBuffer *thread_buffer(void) {
+    if (local) return local;
+
+    TraceBuffer *b = calloc(1, sizeof(*b));
+    if (!b) return NULL;
+    b->tid = atomic_fetch_add(&next_tid, 1);
+    TraceBuffer *head = atomic_load(&registry);
+    do {
+        b->next = head;
+    } while (!atomic_compare_exchange_weak(&registry, &head, b));
+    local = b;
+    return b;
+}
+
+static void record(const char *name, char phase) {
+    TraceBuffer *b = thread_buffer();
+    if (!b) return;
+    unsigned int n = atomic_load_explicit(&b->count, memory_order_relaxed);
+    if (n >= TRACE_BUFFER_EVENTS) {
+        b->dropped++;
+        return;
+    }
+    b->events[n] = (TraceEvent){name, now_ns(), phase};
+    // Release: a reader that sees the new count also sees the event
+    atomic_store_explicit(&b->count, n + 1, memory_order_release);
+}
+
+void trace_begin(const char *name) {
+    record(name, 'B');
+}
+
+void trace_end(const char *name) {
+    record(name, 'E');
+}
+
+int trace_write(const char *path) {
+    if (!path) path = "trace.json";
+    FILE *f = fopen(path, "w");
+    if (!f) return -1;
+
+    fprintf(f, "{\"traceEvents\":[\n");
+    int first = 1;
+    for (TraceBuffer *b = atomic_load(&registry); b; b = b->next) {
+        unsigned int n = atomic_load_explicit(&b->count, memory_order_acquire);
+        for (unsigned int i = 0; i < n; i++) {
+            const TraceEvent *e = &b->events[i];
+            fprintf(f, "%s{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":1,\"tid\":%d}",
+                    first ? "" : ",\n", e->name, e->phase, (double)e->ts_ns / 1000.0, b->tid);
+            first = 0;
+        }
+        if (b->dropped) {
+            fprintf(stderr, "trace: thread %d dropped %u events (buffer full)\n", b->tid, b->dropped);
+        }
+    }
+    fprintf(f, "\n],\"displayTimeUnit\":\"ms\"}\n");
+    return fclose(f) == 0 ? 0 : -1;
+}
@@ -0,0 +1,44 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+/*
+ * Optional trace spans (build with `make TRACE=1`).
+ *
+ * Each thread appends begin/end records to its own buffer with no locking;
+ * TRACE_WRITE() turns all buffers into Chrome trace-event JSON that
+ * Perfetto (ui.perfetto.dev) or chrome://tracing can open.
+ *
+ * Without TRACE defined every macro expands to nothing, so instrumented
+ * code compiles exactly as if the macros were not there.
+ */
+
+#ifdef TRACE
+
+void trace_begin(const char *name);
+void trace_end(const char *name);
+
+// Write every thread's spans as JSON. NULL path selects "trace.json".
+// Call once the other threads are idle. Returns 0 on success, -1 on error.
+int trace_write(const char *path);
+
+static inline void trace_scope_end(const char **name) {
+    trace_end(*name);
+}
+
+#define TRACE_BEGIN(name) trace_begin(name)
+#define TRACE_END(name)   trace_end(name)
+// Span from here to the end of the enclosing block (any return path)
+#define TRACE_SCOPE(name) \
+    const char *trace_scope_ __attribute__((cleanup(trace_scope_end))) = (trace_begin(name), (name))
+#define TRACE_WRITE(path) trace_write(path)
+
+#else
+
+#define TRACE_BEGIN(name) ((void)0)
+#define TRACE_END(name)   ((void)0)
+#define TRACE_SCOPE(name) ((void)0)
+#define TRACE_WRITE(path) ((void)0)
+
+#endif
+
+#endif
@@ -1,29 +1,102 @@
+#include <stdarg.h>
+#include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <math.h>
 #include "ui.h"
 #include "dungeon.h"
+#include "items.h"
+#include "trace.h"
+
+static uint64_t bytes_written;  // Everything the renderer has sent to stdout
+static _Thread_local UiBuffer *target;  // Where this thread renders (NULL = stdout)
+
+void ui_set_target(UiBuffer *buf) {
+    target = buf;
+}
+
+// Make room for `extra` more bytes plus a terminating NUL
+static int buffer_reserve(UiBuffer *buf, size_t extra) {
+    if (buf->len + extra + 1 <= buf->capacity) return 0;
+    size_t capacity = buf->capacity ? buf->capacity : 4096;
+    while (capacity < buf->len + extra + 1) capacity *= 2;
+    char *grown = realloc(buf->data, capacity);
+    if (!grown) return -1;
+    buf->data = grown;
+    buf->capacity = capacity;
+    return 0;
+}
+
+int ui_buffer_append(UiBuffer *buf, const char *data, size_t len) {
+    if (buffer_reserve(buf, len) != 0) return -1;
+    memcpy(buf->data + buf->len, data, len);
+    buf->len += len;
+    return 0;
+}
+
+void ui_buffer_free(UiBuffer *buf) {
+    free(buf->data);
+    *buf = (UiBuffer){0};
+}
+
+// printf to the current target that keeps count of the bytes written
+int ui_printf(const char *fmt, ...) {
+    va_list ap;
+    int n;
+    if (target) {
+        // Format straight into the buffer; retry once if it had to grow
+        va_start(ap, fmt);
+        size_t room = target->capacity > target->len ? target->capacity - target->len : 0;
+        n = vsnprintf(room ? target->data + target->len : NULL, room, fmt, ap);
+        va_end(ap);
+        if (n < 0) return n;
+        if ((size_t)n >= room) {
+            if (buffer_reserve(target, (size_t)n) != 0) return -1;
+            va_start(ap, fmt);
+            vsnprintf(target->data + target->len, (size_t)n + 1, fmt, ap);
+            va_end(ap);
+        }
+        target->len += (size_t)n;
+        return n;
+    }
+    va_start(ap, fmt);
+    n = vprintf(fmt, ap);
+    va_end(ap);
+    if (n > 0) bytes_written += (uint64_t)n;
+    return n;
+}
+
+// Push stdout output to the terminal now. Buffer targets have nothing to
+// flush, and skipping it keeps worker threads off the process-wide stdout lock.
+static void ui_flush(void) {
+    if (!target) fflush(stdout);
+}
+
+uint64_t ui_bytes_written(void) {
+    return bytes_written;
+}
 
 // ANSI escape codes for terminal control
 void ui_clear_screen(void) {
-    printf("\033[2J");  // Clear entire screen
-    printf("\033[H");   // Move cursor to home position
-    fflush(stdout);
+    ui_printf("\033[2J");  // Clear entire screen
+    ui_printf("\033[H");   // Move cursor to home position
+    ui_flush();
 }
 
 void ui_move_cursor(int row, int col) { // Move the terminal cursor to the specified row and column
-    printf("\033[%d;%dH", row, col); // Print ANSI escape sequence to position cursor at row;col
-    fflush(stdout); // Flush stdout so the escape sequence is sent immediately
+    ui_printf("\033[%d;%dH", row, col); // Print ANSI escape sequence to position cursor at row;col
+    ui_flush(); // Flush stdout so the escape sequence is sent immediately
 } // End of ui_move_cursor function
 
 void ui_hide_cursor(void) { // Hide the cursor (function start)
-    printf("\033[?25l"); // Send ANSI escape sequence to hide the cursor
-    fflush(stdout); // Flush stdout to ensure the sequence is output immediately
+    ui_printf("\033[?25l"); // Send ANSI escape sequence to hide the cursor
+    ui_flush(); // Flush stdout to ensure the sequence is output immediately
 } // End of ui_hide_cursor function
 
 void ui_show_cursor(void) { // Enable the terminal cursor (function start)
-    printf("\033[?25h"); // Send ANSI escape sequence to show the cursor
-    fflush(stdout); // Flush stdout to ensure the sequence is output immediately
+    ui_printf("\033[?25h"); // Send ANSI escape sequence to show the cursor
+    ui_flush(); // Flush stdout to ensure the sequence is output immediately
 } // End of ui_show_cursor function
 
 // Check if position is a special location (copied from dungeon.c)
@@ -46,7 +119,10 @@ static int is_special_location(const Position *pos) {
 }
 
 // Render the complete game interface
-void ui_render_game(const Player *player, const Position *pos, const char *message, const Map *map) {
+void ui_render_game(const Player *player, const Position *pos, const EventLog *log, const Map *map) {
+    TRACE_SCOPE("ui_render_game");
+    char message[3 * 76 + 1];  // Panel holds three wrapped lines; 'L' shows the rest
+    eventlog_format_turn(log, message, sizeof(message));
     ui_clear_screen(); // clear terminal screen
     ui_hide_cursor();  // hide cursor while rendering
     
@@ -56,33 +132,33 @@ void ui_render_game(const Player *player, const Position *pos, const char *messa
     row = 1;
     col = 1;
     ui_move_cursor(row, col); // move to top-left
-    printf("╔════════════════════════════════════════════════════════════════════════════════╗"); // top border
+    ui_printf("╔════════════════════════════════════════════════════════════════════════════════╗"); // top border
     row++;
     ui_move_cursor(row, col);
-    printf("║                        DUNGEON CRAWLER ADVENTURE                               ║"); // title
+    ui_printf("║                        DUNGEON CRAWLER ADVENTURE                               ║"); // title
     row++;
     ui_move_cursor(row, col);
-    printf("╚════════════════════════════════════════════════════════════════════════════════╝"); // bottom border
+    ui_printf("╚════════════════════════════════════════════════════════════════════════════════╝"); // bottom border
     
     // Message/log area
     row = 5;
     col = 2;
     ui_move_cursor(row, col);
-    printf("┌─ MESSAGE LOG "); // message panel header
+    ui_printf("┌─ MESSAGE LOG "); // message panel header
     // Total width should be 80 characters (to match the bottom border)
     // "┌─ MESSAGE LOG " is 15 characters, "┐" is 1 character
     // So we need 80 - 15 - 1 = 64 more "─" characters
     for (int i = 0; i < 64; i++) {
-        printf("─"); // extend header line to full width
+        ui_printf("─"); // extend header line to full width
     }
-    printf("┐\n");
+    ui_printf("┐\n");
     col = 2;
     row++;
     ui_move_cursor(row, col);
-    printf("│ "); // left border for message content
+    ui_printf("│ "); // left border for message content
     
     // Word wrap the message across multiple lines
-    if (message && strlen(message) > 0) {
+    if (message[0] != '\0') {
         int msg_len = strlen(message); // length of provided message
         int max_width = 76;  // Maximum characters per line (80 - border chars)
         int start = 0;       // Current position in message string
@@ -91,10 +167,10 @@ void ui_render_game(const Player *player, const Position *pos, const char *messa
         while (start < msg_len) {
             // If not first line, close previous line and start new one
             if (start > 0) {
-                printf(" │"); // right border of previous line
+                ui_printf(" │"); // right border of previous line
                 row++;
                 ui_move_cursor(row, col);
-                printf("│ "); // left border for next line
+                ui_printf("│ "); // left border for next line
             }
             
             // Calculate how many characters to print on this line
@@ -102,82 +178,84 @@ void ui_render_game(const Player *player, const Position *pos, const char *messa
             int line_len = (remaining > max_width) ? max_width : remaining; // clamp to max_width
             
             // Print this line's content, padded to max_width
-            printf("%-*.*s", max_width, line_len, message + start); // print substring, left-padded
+            ui_printf("%-*.*s", max_width, line_len, message + start); // print substring, left-padded
              
             // Move to next chunk
             start += line_len; // advance cursor in message
         }
     } else {
         // No message - print empty line
-        printf("%-76s", ""); // blank padded message area
+        ui_printf("%-76s", ""); // blank padded message area
     }
     
-    printf(" │"); // close the last message line with right border
+    ui_printf(" │"); // close the last message line with right border
     
     row++;
     ui_move_cursor(row, col);
-    printf("└"); // bottom-left corner of message box
+    ui_printf("└"); // bottom-left corner of message box
     for (int i = 0; i < 78; i++)
     {
-        printf("─"); // bottom border of message box
+        ui_printf("─"); // bottom border of message box
     }
 
-    printf("┘"); // bottom-right corner
+    ui_printf("┘"); // bottom-right corner
 
     // Player stats section (left side)
     row = 10;
     col = 2;
     ui_move_cursor(row, col);
-    printf("┌─ PLAYER STATUS ─────────────────────┐"); // player status box header
+    ui_printf("┌─ PLAYER STATUS ─────────────────────┐"); // player status box header
     row++;
     ui_move_cursor(row, col);
-    printf("│ Class: %-10s                 │", player_class_name(player->player_class)); // player class
+    ui_printf("│ Class: %-10s                 │", player_class_name(player->player_class)); // player class
     row++;
     ui_move_cursor(row, col);
-    printf("│ Level: %-2d     HP: %3d/%-3d         │", player->level, player->health, player->max_health); // level and hp
+    ui_printf("│ Level: %-2d     HP: %3d/%-3d         │", player->level, player->health, player->max_health); // level and hp
     row++;
     ui_move_cursor(row, col);
-    printf("│ XP: %4d/%4d                     │", player->experience, player->exp_to_next_level); // xp progress
+    ui_printf("│ XP: %4d/%4d                     │", player->experience, player->exp_to_next_level); // xp progress
     row++;
     ui_move_cursor(row, col);
-    printf("│ Gold: %-6d                       │", player->gold); // gold amount
+    ui_printf("│ Gold: %-6d                       │", player->gold); // gold amount
     row++;
     ui_move_cursor(row, col);
-    printf("│                                      │"); // spacer line
+    ui_printf("│                                      │"); // spacer line
     row++;
     ui_move_cursor(row, col);
-    printf("│ Attack:  %-3d  (base %-2d)          │", player->total_damage, player->base_damage); // attack stats
+    ui_printf("│ Attack:  %-3d  (base %-2d)          │", player->total_damage, player->base_damage); // attack stats
     row++;
     ui_move_cursor(row, col);
-    printf("│ Defense: %-3d  (base %-2d)          │", player->total_defense, player->base_defense); // defense stats
+    ui_printf("│ Defense: %-3d  (base %-2d)          │", player->total_defense, player->base_defense); // defense stats
     row++;
     ui_move_cursor(row, col);
-    printf("└──────────────────────────────────────┘"); // close player status box
+    ui_printf("└──────────────────────────────────────┘"); // close player status box
     
     // Equipment section
     row = 19;
     col = 2;
     ui_move_cursor(row, col);
-    printf("┌─ EQUIPMENT ─────────────────────────┐"); // equipment header
+    ui_printf("┌─ EQUIPMENT ─────────────────────────┐"); // equipment header
     row++;
     ui_move_cursor(row, col);
-    if (player->equipped.weapon_slot != INVALID_SLOT) {
-        const Item *w = &player->inventory[player->equipped.weapon_slot];
-        printf("│ Weapon: %-28s │", w->name); // display weapon name if equipped
+    int weapon_slot = inventory_lookup(&player->inventory, player->equipped.weapon);
+    if (weapon_slot != INVALID_SLOT) {
+        const char *w = item_name(player->inventory.entries[weapon_slot].item_id);
+        ui_printf("│ Weapon: %-28s │", w); // display weapon name if equipped
     } else {
-        printf("│ Weapon: (none)                       │"); // no weapon
+        ui_printf("│ Weapon: (none)                       │"); // no weapon
     }
     row++;
     ui_move_cursor(row, col);
-    if (player->equipped.armor_slot != INVALID_SLOT) {
-        const Item *a = &player->inventory[player->equipped.armor_slot];
-        printf("│ Armor:  %-28s │", a->name); // display armor name if equipped
+    int armor_slot = inventory_lookup(&player->inventory, player->equipped.armor);
+    if (armor_slot != INVALID_SLOT) {
+        const char *a = item_name(player->inventory.entries[armor_slot].item_id);
+        ui_printf("│ Armor:  %-28s │", a); // display armor name if equipped
     } else {
-        printf("│ Armor:  (none)                       │"); // no armor
+        ui_printf("│ Armor:  (none)                       │"); // no armor
     }
     row++;
     ui_move_cursor(row, col);
-    printf("└──────────────────────────────────────┘"); // close equipment box
+    ui_printf("└──────────────────────────────────────┘"); // close equipment box
     
     // Map section (right side)
     int map_start_col = 45; // column where map box starts
@@ -195,88 +273,91 @@ void ui_render_game(const Player *player, const Position *pos, const char *messa
     row = 10;
     col = map_start_col;
     ui_move_cursor(row, col);
-    printf("┌─ MAP (Position: %2d, %2d) ─────┐", pos->x, pos->y); // map header showing player pos
+    ui_printf("┌─ MAP (Position: %2d, %2d) ─────┐", pos->x, pos->y); // map header showing player pos
     
     row++;
     // Map section (right side) - update the rendering loop
     row = 11;  // starting row for map rows
     for (int y = min_y; y <= max_y; y++) {
         ui_move_cursor(row, col);
-        printf("│ "); // left border for map row
+        ui_printf("│ "); // left border for map row
         for (int x = min_x; x <= max_x; x++) {
             if (x == pos->x && y == pos->y) {
-                printf(" @");  // Player marker
+                ui_printf(" @");  // Player marker
             } else if (x == MAP_CENTER && y == MAP_CENTER) {
-                printf(" +");  // Spawn marker
+                ui_printf(" +");  // Spawn marker
             } else {
                 Position check = {x, y};
                 int special = is_special_location(&check); // check for boss/shrine corners
                 TileType tile = map_get_tile(map, x, y); // get tile type
                 
                 if (special == 1) {
-                    printf(" B");  // Boss location
+                    ui_printf(" B");  // Boss location
                 } else if (special == 2) {
-                    printf(" S");  // Shrine location
+                    ui_printf(" S");  // Shrine location
                 } else if (tile == TILE_WALL) {
-                    printf(" #");  // Wall tile
+                    ui_printf(" #");  // Wall tile
                 } else {
-                    printf(" ·");  // Floor/corridor
+                    ui_printf(" ·");  // Floor/corridor
                 }
             }
         }
-        printf(" │"); // right border for map row
+        ui_printf(" │"); // right border for map row
         row++;
     }
     
     ui_move_cursor(row, col);
-    printf("└────────────────────────────────────┘"); // close map box
+    ui_printf("└────────────────────────────────────┘"); // close map box
     
     // Legend
     row++;
     ui_move_cursor(row, col);
-    printf("  @ = You  + = Spawn  B = Boss"); // legend line 1
+    ui_printf("  @ = You  + = Spawn  B = Boss"); // legend line 1
     row++;
     ui_move_cursor(row, col);
-    printf("  S = Shrine  · = Empty  # = Wall"); // legend line 2
+    ui_printf("  S = Shrine  · = Empty  # = Wall"); // legend line 2
     
     // Controls
     row = 30;
     col = 2;
     ui_move_cursor(row, col);
-    printf("┌─ CONTROLS ");
+    ui_printf("┌─ CONTROLS ");
     for (int i = 0; i < 67; i++)
     {
-        printf("─"); // controls header extension
+        ui_printf("─"); // controls header extension
     }
-    printf("┐");
+    ui_printf("┐");
     row++;
     ui_move_cursor(row, col);
-    printf("│ N/S/E/W = Move   I = Inventory   M = Full Map   Q = Quit"); // control descriptions
+    ui_printf("│ N/S/E/W = Move  I = Inventory  M = Full Map  L = Log  R = Rewind  Q = Quit"); // control descriptions
     col = 80;
     ui_move_cursor(row, col);
-    printf(" │"); // right border padding (keeps layout consistent)
+    ui_printf(" │"); // right border padding (keeps layout consistent)
     col = 2;
     row++;
     ui_move_cursor(row, col);
-    printf("└");
+    ui_printf("└");
     for (int i = 0; i < 78; i++)
     {
-        printf("─"); // bottom border of controls
+        ui_printf("─"); // bottom border of controls
     }
 
-    printf("┘");
+    ui_printf("┘");
 
     // Command prompt
     row = 35;
     col = 2;
     ui_move_cursor(row, col);
-    printf("Command: "); // prompt for user input
+    ui_printf("Command: "); // prompt for user input
     ui_show_cursor(); // re-enable cursor for input
-    fflush(stdout); // flush output so the UI appears immediately
+    ui_flush(); // flush output so the UI appears immediately
 }
 
 // Render battle interface
-void ui_render_battle(const Player *player, const BattleState *battle, const char *message) {
+void ui_render_battle(const Player *player, const BattleState *battle, const EventLog *log) {
+    TRACE_SCOPE("ui_render_battle");
+    char message[256];
+    eventlog_format_turn(log, message, sizeof(message));
     ui_clear_screen();
     ui_hide_cursor();
     
@@ -286,116 +367,108 @@ void ui_render_battle(const Player *player, const BattleState *battle, const cha
     row = 1;
     col = 1;
     ui_move_cursor(row, col);
-    printf("╔════════════════════════════════════════════════════════════════════════════════╗");
+    ui_printf("╔════════════════════════════════════════════════════════════════════════════════╗");
     row++;
     ui_move_cursor(row, col);
-    printf("║                              ⚔  BATTLE  ⚔                                      ║");
+    ui_printf("║                              ⚔  BATTLE  ⚔                                      ║");
     row++;
     ui_move_cursor(row, col);
-    printf("╚════════════════════════════════════════════════════════════════════════════════╝");
+    ui_printf("╚════════════════════════════════════════════════════════════════════════════════╝");
     
     // Monster display
     row = 7;
     col = 25;
     ui_move_cursor(row, col);
-    printf("┌──────────────────────────────┐");
+    ui_printf("┌──────────────────────────────┐");
     row++;
     ui_move_cursor(row, col);
-    printf("│    %s", battle->monster.name);
+    ui_printf("│    %s", battle->monster.name);
     // Pad to 30 chars
     int name_len = strlen(battle->monster.name);
-    for (int i = name_len; i < 25; i++) printf(" ");
-    printf("│");
+    for (int i = name_len; i < 25; i++) ui_printf(" ");
+    ui_printf("│");
     row++;
     ui_move_cursor(row, col);
-    printf("│                              │");
+    ui_printf("│                              │");
     row++;
     ui_move_cursor(row, col);
-    printf("│  HP: %3d / %3d              │", battle->monster_hp, battle->monster.hp);
+    ui_printf("│  HP: %3d / %3d              │", battle->monster_hp, battle->monster.hp);
     row++;
     ui_move_cursor(row, col);
-    printf("│  ATK: %-3d  DEF: %-3d        │", battle->monster.attack, battle->monster.defense);
+    ui_printf("│  ATK: %-3d  DEF: %-3d        │", battle->monster.attack, battle->monster.defense);
     row++;
     ui_move_cursor(row, col);
-    printf("└──────────────────────────────┘");
+    ui_printf("└──────────────────────────────┘");
     
     // Player stats
     row = 15;
     col = 25;
     ui_move_cursor(row, col);
-    printf("┌──────────────────────────────┐");
+    ui_printf("┌──────────────────────────────┐");
     row++;
     ui_move_cursor(row, col);
-    printf("│         YOUR STATUS          │");
+    ui_printf("│         YOUR STATUS          │");
     row++;
     ui_move_cursor(row, col);
-    printf("│  Class: %-20s│", player_class_name(player->player_class));
+    ui_printf("│  Class: %-20s│", player_class_name(player->player_class));
     row++;
     ui_move_cursor(row, col);
-    printf("│  HP: %3d / %3d              │", player->health, player->max_health);
+    ui_printf("│  HP: %3d / %3d              │", player->health, player->max_health);
     row++;
     ui_move_cursor(row, col);
-    printf("│  ATK: %-3d  DEF: %-3d        │", player->total_damage, player->total_defense);
+    ui_printf("│  ATK: %-3d  DEF: %-3d        │", player->total_damage, player->total_defense);
     row++;
     ui_move_cursor(row, col);
-    printf("└──────────────────────────────┘");
+    ui_printf("└──────────────────────────────┘");
     
     // Battle log
     row = 24;
     col = 2;
     ui_move_cursor(row, col);
-    printf("┌─ BATTLE LOG ");
-    for (int i = 0; i < 64; i++) printf("─");
-    printf("┐");
+    ui_printf("┌─ BATTLE LOG ");
+    for (int i = 0; i < 64; i++) ui_printf("─");
+    ui_printf("┐");
     row++;
     ui_move_cursor(row, col);
-    printf("│ %-76s │", message);
+    ui_printf("│ %-76s │", message);
     row++;
     ui_move_cursor(row, col);
-    printf("└");
-    for (int i = 0; i < 78; i++) printf("─");
-    printf("┘");
+    ui_printf("└");
+    for (int i = 0; i < 78; i++) ui_printf("─");
+    ui_printf("┘");
     
     // Controls
     row = 30;
     col = 2;
     ui_move_cursor(row, col);
-    printf("┌─ BATTLE COMMANDS ");
-    for (int i = 0; i < 60; i++) printf("─");
-    printf("┐");
+    ui_printf("┌─ BATTLE COMMANDS ");
+    for (int i = 0; i < 60; i++) ui_printf("─");
+    ui_printf("┐");
     row++;
     ui_move_cursor(row, col);
-    printf("│ A = Attack   I = Use Item   Q = Attempt to Flee");
-    for (int i = 0; i < 29; i++) printf(" ");
-    printf("│");
+    ui_printf("│ A = Attack   I = Use Item   Q = Attempt to Flee");
+    for (int i = 0; i < 29; i++) ui_printf(" ");
+    ui_printf("│");
     row++;
     ui_move_cursor(row, col);
-    printf("└");
-    for (int i = 0; i < 78; i++) printf("─");
-    printf("┘");
+    ui_printf("└");
+    for (int i = 0; i < 78; i++) ui_printf("─");
+    ui_printf("┘");
     
     // Command prompt
     row = 35;
     col = 2;
     ui_move_cursor(row, col);
-    printf("Command: ");
+    ui_printf("Command: ");
     ui_show_cursor();
-    fflush(stdout);
-}
-
-// Helper: Convert item type to string for display
-static const char* ui_item_type_name(ItemType t) {
-    switch (t) {
-        case ITEM_CONSUMABLE: return "Consumable";
-        case ITEM_WEAPON:     return "Weapon";
-        case ITEM_ARMOR:      return "Armor";
-        case ITEM_MISC:       return "Misc";
-        default:              return "Unknown";
-    }
+    ui_flush();
 }
 
 // Render inventory interface
-void ui_render_inventory(const Player *player, const char *message) {
+void ui_render_inventory(const Player *player, const EventLog *log) {
+    TRACE_SCOPE("ui_render_inventory");
+    char message[256];
+    eventlog_format_turn(log, message, sizeof(message));
     ui_clear_screen();
     ui_hide_cursor();
     
@@ -405,79 +478,89 @@ void ui_render_inventory(const Player *player, const char *message) {
     row = 1;
     col = 1;
     ui_move_cursor(row, col);
-    printf("╔════════════════════════════════════════════════════════════════════════════════╗");
+    ui_printf("╔════════════════════════════════════════════════════════════════════════════════╗");
     row++;
     ui_move_cursor(row, col);
-    printf("║                              💼 INVENTORY 💼                                   ║");
+    ui_printf("║                              💼 INVENTORY 💼                                   ║");
     row++;
     ui_move_cursor(row, col);
-    printf("╚════════════════════════════════════════════════════════════════════════════════╝");
+    ui_printf("╚════════════════════════════════════════════════════════════════════════════════╝");
     
     // Player stats section (top)
     row = 5;
     col = 2;
     ui_move_cursor(row, col);
-    printf("┌─ PLAYER STATUS ─────────────────────────────────────────────────────────────────┐");
+    ui_printf("┌─ PLAYER STATUS ─────────────────────────────────────────────────────────────────┐");
     row++;
     ui_move_cursor(row, col);
-    printf("│ Class: %-15s   Level: %-2d   HP: %3d/%-3d   Gold: %-6d              │", 
+    ui_printf("│ Class: %-15s   Level: %-2d   HP: %3d/%-3d   Gold: %-6d              │", 
            player_class_name(player->player_class), player->level, 
            player->health, player->max_health, player->gold);
     row++;
     ui_move_cursor(row, col);
-    printf("│ Attack: %-3d (base %-2d)      Defense: %-3d (base %-2d)                          │",
+    ui_printf("│ Attack: %-3d (base %-2d)      Defense: %-3d (base %-2d)                          │",
            player->total_damage, player->base_damage, player->total_defense, player->base_defense);
     row++;
     ui_move_cursor(row, col);
-    printf("└──────────────────────────────────────────────────────────────────────────────────┘");
+    ui_printf("└──────────────────────────────────────────────────────────────────────────────────┘");
     
     // Equipment section
     row = 10;
     col = 2;
     ui_move_cursor(row, col);
-    printf("┌─ EQUIPPED ITEMS ────────────────────────────────────────────────────────────────┐");
+    ui_printf("┌─ EQUIPPED ITEMS ────────────────────────────────────────────────────────────────┐");
     row++;
     ui_move_cursor(row, col);
-    if (player->equipped.weapon_slot != INVALID_SLOT) {
-        const Item *w = &player->inventory[player->equipped.weapon_slot];
-        printf("│ Weapon: %-30s [Slot %2d]  (+%d dmg, +%d def)         │", 
-               w->name, player->equipped.weapon_slot, w->stats.damage, w->stats.defense);
+    int weapon_slot = inventory_lookup(&player->inventory, player->equipped.weapon);
+    if (weapon_slot != INVALID_SLOT) {
+        Item w;
+        item_resolve(&player->inventory.entries[weapon_slot], &w);
+        ui_printf("│ Weapon: %-30s [Slot %2d]  (+%d dmg, +%d def)         │", 
+               w.name, weapon_slot, w.stats.damage, w.stats.defense);
     } else {
-        printf("│ Weapon: (none)                                                                 │");
+        ui_printf("│ Weapon: (none)                                                                 │");
     }
     row++;
     ui_move_cursor(row, col);
-    if (player->equipped.armor_slot != INVALID_SLOT) {
-        const Item *a = &player->inventory[player->equipped.armor_slot];
-        printf("│ Armor:  %-30s [Slot %2d]  (+%d dmg, +%d def)         │", 
-               a->name, player->equipped.armor_slot, a->stats.damage, a->stats.defense);
+    int armor_slot = inventory_lookup(&player->inventory, player->equipped.armor);
+    if (armor_slot != INVALID_SLOT) {
+        Item a;
+        item_resolve(&player->inventory.entries[armor_slot], &a);
+        ui_printf("│ Armor:  %-30s [Slot %2d]  (+%d dmg, +%d def)         │", 
+               a.name, armor_slot, a.stats.damage, a.stats.defense);
     } else {
-        printf("│ Armor:  (none)                                                                 │");
+        ui_printf("│ Armor:  (none)                                                                 │");
     }
     row++;
     ui_move_cursor(row, col);
-    printf("└──────────────────────────────────────────────────────────────────────────────────┘");
+    ui_printf("└──────────────────────────────────────────────────────────────────────────────────┘");
     
     // Inventory items section
     row = 15;
     col = 2;
     ui_move_cursor(row, col);
-    printf("┌─ INVENTORY ITEMS (%d/%d) ───────────────────────────────────────────────────────┐", 
-           player->inv_count, MAX_INVENTORY);
+    ui_printf("┌─ INVENTORY ITEMS (%d/%d) ───────────────────────────────────────────────────────┐", 
+           player->inventory.count, MAX_INVENTORY);
     
     row++;
     ui_move_cursor(row, col);
-    printf("│ Slot  Name             Qty  Type         Stats             Value   Equipped     │");
+    ui_printf("│ Slot  Name             Qty  Type         Stats             Value   Equipped     │");
     row++;
     ui_move_cursor(row, col);
-    printf("│──────────────────────────────────────────────────────────────────────────────────│");
+    ui_printf("│──────────────────────────────────────────────────────────────────────────────────│");
     
-    // Display each item
-    for (int i = 0; i < player->inv_count && i < 10; i++) {
+    // Display each item (slots are stable, so freed slots leave gaps)
+    int shown = 0;
+    for (int i = 0; i < MAX_INVENTORY && shown < 10; i++) {
+        const InventoryEntry *entry = inventory_slot(&player->inventory, i);
+        if (!entry) continue;
+        shown++;
         row++;
         ui_move_cursor(row, col);
-        const Item *it = &player->inventory[i];
-        int is_equipped = (player->equipped.weapon_slot == i) || (player->equipped.armor_slot == i);
+        Item item;
+        item_resolve(entry, &item);  // Name and stats resolved at render time
+        const Item *it = &item;
+        int is_equipped = (i == weapon_slot) || (i == armor_slot);
         
         char stats_str[20];
         if (it->stats.damage || it->stats.defense) {
@@ -487,51 +570,149 @@ void ui_render_inventory(const Player *player, const char *message) {
             snprintf(stats_str, sizeof(stats_str), "—");
         }
         
-        printf("│ [%2d]  %-16s %-4d %-12s %-18s %-6d  %-3s          │",
-               i, it->name, it->quantity, ui_item_type_name(it->type), 
+        ui_printf("│ [%2d]  %-16s %-4d %-12s %-18s %-6d  %-3s          │",
+               i, it->name, it->quantity, item_type_name(it->type), 
                stats_str, it->value, is_equipped ? "[E]" : "");
     }
     
-    // Fill remaining slots
-    for (int i = player->inv_count; i < 10; i++) {
+    // Fill remaining rows with free slots
+    for (int i = 0; i < MAX_INVENTORY && shown < 10; i++) {
+        if (inventory_slot(&player->inventory, i)) continue;
+        shown++;
         row++;
         ui_move_cursor(row, col);
-        printf("│ [%2d]  (empty)                                                                  │", i);
+        ui_printf("│ [%2d]  (empty)                                                                  │", i);
     }
     
     row++;
     ui_move_cursor(row, col);
-    printf("└──────────────────────────────────────────────────────────────────────────────────┘");
+    ui_printf("└──────────────────────────────────────────────────────────────────────────────────┘");
     
     // Message area
     row = 28;
     col = 2;
     ui_move_cursor(row, col);
-    printf("┌─ MESSAGE ────────────────────────────────────────────────────────────────────────┐");
+    ui_printf("┌─ MESSAGE ────────────────────────────────────────────────────────────────────────┐");
     row++;
     ui_move_cursor(row, col);
-    printf("│ %-78s │", message ? message : "");
+    ui_printf("│ %-78s │", message);
     row++;
     ui_move_cursor(row, col);
-    printf("└──────────────────────────────────────────────────────────────────────────────────┘");
+    ui_printf("└──────────────────────────────────────────────────────────────────────────────────┘");
     
     // Controls
     row = 32;
     col = 2;
     ui_move_cursor(row, col);
-    printf("┌─ COMMANDS ───────────────────────────────────────────────────────────────────────┐");
+    ui_printf("┌─ COMMANDS ───────────────────────────────────────────────────────────────────────┐");
     row++;
     ui_move_cursor(row, col);
-    printf("│ U <slot> = Use consumable     E <slot> = Equip weapon/armor     Q = Exit         │");
+    ui_printf("│ U <slot> = Use consumable     E <slot> = Equip weapon/armor     Q = Exit         │");
     row++;
     ui_move_cursor(row, col);
-    printf("└──────────────────────────────────────────────────────────────────────────────────┘");
+    ui_printf("└──────────────────────────────────────────────────────────────────────────────────┘");
     
     // Command prompt
     row = 36;
     col = 2;
     ui_move_cursor(row, col);
-    printf("Inventory Command: ");
+    ui_printf("Inventory Command: ");
     ui_show_cursor();
-    fflush(stdout);
-}
\ No newline at end of file
+    ui_flush();
+}
+
+// Print the most recent events, oldest first (scrollback view)
+void ui_render_log(const EventLog *log, int lines) {
+    TRACE_SCOPE("ui_render_log");
+    ui_printf("\n╔══════════════════════════════════════════════════════════════╗\n");
+    ui_printf("║                        EVENT LOG                             ║\n");
+    ui_printf("╚══════════════════════════════════════════════════════════════╝\n\n");
+
+    int count = eventlog_count(log);
+    if (lines > count) lines = count;
+
+    // Only the lines shown here are ever formatted
+    char line[256];
+    for (int age = lines - 1; age >= 0; age--) {
+        const GameEvent *ev = eventlog_get(log, age);
+        eventlog_format(ev, line, sizeof(line));
+        ui_printf("  [turn %4u] %s\n", (unsigned)ev->turn, line);
+    }
+}
+
+void ui_render_spectator(const SpectatorView *view, unsigned long id, int ended) {
+    TRACE_SCOPE("ui_render_spectator");
+    ui_clear_screen();
+    ui_printf("\n╔══════════════════════════════════════════════════════════════╗\n");
+    ui_printf("║                   WATCHING SESSION %-8lu                  ║\n", id);
+    ui_printf("╚══════════════════════════════════════════════════════════════╝\n\n");
+
+    if (view->turn == 0 || view->status == SPECTATE_CHOOSING) {
+        ui_printf("Waiting for the player's next move...\n");
+    } else {
+        ui_printf("Class: %-10s  Level: %-2d  HP: %3d/%-3d  XP: %d/%d  Gold: %d\n",
+                  player_class_name((PlayerClass)view->player_class), view->level,
+                  view->health, view->max_health, view->experience, view->exp_to_next_level, view->gold);
+        ui_printf("Attack: %-3d  Defense: %-3d  Position: (%d, %d)\n\n",
+                  view->damage, view->defense, view->pos.x, view->pos.y);
+        for (int dy = 0; dy < SPECTATE_SIDE; dy++) {
+            ui_printf("    ");
+            for (int dx = 0; dx < SPECTATE_SIDE; dx++) {
+                int here = dx == SPECTATE_RADIUS && dy == SPECTATE_RADIUS;
+                ui_printf("%c ", here ? '@' : view->tiles[dy][dx]);
+            }
+            ui_printf("\n");
+        }
+        ui_printf("\n");
+        if (view->status == SPECTATE_GAME_OVER) {
+            ui_printf("GAME OVER - %s\n", view->health <= 0 ? "the player has perished" : "the player quit");
+        } else if (view->in_battle) {
+            ui_printf("In battle: %s (level %d)  HP: %d/%d\n",
+                      view->monster, view->monster_level, view->monster_hp, view->monster_max_hp);
+        } else if (view->state == STATE_INVENTORY) {
+            ui_printf("Looking through the inventory\n");
+        } else {
+            ui_printf("Exploring\n");
+        }
+    }
+    if (ended) ui_printf("\nThe player has left.\n");
+    ui_printf("\nQ = Stop watching  (Enter = redraw)\n");
+}
+
+/**
+ * Display current player status (HP, gold, stats, level)
+ */
+void ui_print_player_status(const Player *p) {
+    ui_printf("HP: %d/%d, Gold: %d, Dmg: %d, Def: %d | Level: %d, XP: %d/%d\n",
+           p->health, p->max_health, p->gold, p->total_damage, p->total_defense,
+           p->level, p->experience, p->exp_to_next_level);
+}
+
+/**
+ * Display all items in inventory with equipment markers
+ */
+void ui_print_player_inventory(const Player *p) {
+    ui_printf("\nInventory (E = equipped):\n");
+    for (int i = 0; i < MAX_INVENTORY; ++i) {
+        const InventoryEntry *entry = inventory_slot(&p->inventory, i);
+        if (!entry) continue;  // Free slot
+        ItemHandle h = inventory_handle(&p->inventory, i);
+        int is_equipped = (p->equipped.weapon == h) || (p->equipped.armor == h);
+        Item it;
+        item_resolve(entry, &it);
+        
+        ui_printf("  [%2d]%s %-14s x%-2d  %-10s",
+               i,
+               is_equipped ? " [E]" : "    ",
+               it.name,
+               it.quantity,
+               item_type_name(it.type));
+               
+        // Show stat bonuses for weapons/armor
+        if (it.stats.damage || it.stats.defense) {
+            ui_printf("  (dmg:%d def:%d)", it.stats.damage, it.stats.defense);
+        }
+        ui_printf("  value:%d\n", it.value);
+    }
+    ui_printf("\n");
+}
@@ -1,8 +1,30 @@
 #ifndef UI_H
 #define UI_H
 
+#include <stddef.h>
+#include <stdint.h>
 #include "player.h"
 #include "dungeon.h"
+#include "eventlog.h"
+#include "spectate.h"
+
+// Growable output buffer - a render target other than stdout (server sessions)
+typedef struct {
+    char *data;
+    size_t len;
+    size_t capacity;
+} UiBuffer;
+
+// Send this thread's ui_* output to `buf` instead of stdout (NULL = stdout).
+void ui_set_target(UiBuffer *buf);
+
+// Formatted output to the current target; returns the bytes written.
+__attribute__((format(printf, 1, 2)))
+int ui_printf(const char *fmt, ...);
+
+// Append raw bytes to a buffer. Returns 0, or -1 if out of memory.
+int ui_buffer_append(UiBuffer *buf, const char *data, size_t len);
+void ui_buffer_free(UiBuffer *buf);
 
 // Terminal control
 void ui_clear_screen(void);
@@ -11,8 +33,18 @@ void ui_hide_cursor(void);
 void ui_show_cursor(void);
 
 // Full screen rendering
-void ui_render_game(const Player *player, const Position *pos, const char *message, const Map *map);
-void ui_render_battle(const Player *player, const BattleState *battle, const char *message);
-void ui_render_inventory(const Player *player, const char *message);
+void ui_render_game(const Player *player, const Position *pos, const EventLog *log, const Map *map);
+void ui_render_battle(const Player *player, const BattleState *battle, const EventLog *log);
+void ui_render_inventory(const Player *player, const EventLog *log);
+void ui_render_log(const EventLog *log, int lines);
+// A spectator's screen for session `id` (`ended`: the player has left)
+void ui_render_spectator(const SpectatorView *view, unsigned long id, int ended);
+
+// Total bytes written to stdout by the ui_* functions (for metrics)
+uint64_t ui_bytes_written(void);
+
+// Plain-text player summaries (no cursor control)
+void ui_print_player_status(const Player *p);
+void ui_print_player_inventory(const Player *p);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,154 @@
+#include <stdlib.h>
+#include <string.h>
+#include "workpool.h"
+
+#define QUEUE_INITIAL 64
+
+static _Thread_local Worker *self;  // The worker running on this thread (NULL elsewhere)
+
+static int queue_init(WorkQueue *q) {
+    q->items = malloc(QUEUE_INITIAL * sizeof(*q->items));
+    if (!q->items) return -1;
+    pthread_mutex_init(&q->lock, NULL);
+    q->capacity = QUEUE_INITIAL;
+    q->head = 0;
+    q->count = 0;
+    return 0;
+}
+
+static void queue_destroy(WorkQueue *q) {
+    pthread_mutex_destroy(&q->lock);
+    free(q->items);
+}
+
+static int queue_push(WorkQueue *q, WorkItem item) {
+    pthread_mutex_lock(&q->lock);
+    if (q->count == q->capacity) {
+        // Unwrap into a buffer twice the size
+        WorkItem *grown = malloc(2 * q->capacity * sizeof(*grown));
+        if (!grown) {
+            pthread_mutex_unlock(&q->lock);
+            return -1;
+        }
+        for (unsigned i = 0; i < q->count; i++) {
+            grown[i] = q->items[(q->head + i) & (q->capacity - 1)];
+        }
+        free(q->items);
+        q->items = grown;
+        q->capacity *= 2;
+        q->head = 0;
+    }
+    q->items[(q->head + q->count) & (q->capacity - 1)] = item;
+    q->count++;
+    pthread_mutex_unlock(&q->lock);
+    return 0;
+}
+
+static int queue_pop(WorkQueue *q, WorkItem *out) {
+    pthread_mutex_lock(&q->lock);
+    int got = q->count > 0;
+    if (got) {
+        *out = q->items[q->head];
+        q->head = (q->head + 1) & (q->capacity - 1);
+        q->count--;
+    }
+    pthread_mutex_unlock(&q->lock);
+    return got;
+}
+
+// Own queue first, then the others starting with the next worker along
+static int take(WorkPool *pool, Worker *w, WorkItem *out) {
+    int got = queue_pop(&w->queue, out);
+    for (int i = 1; !got && i < pool->size; i++) {
+        Worker *victim = &pool->workers[(w->index + i) % pool->size];
+        got = queue_pop(&victim->queue, out);
+        if (got) atomic_fetch_add_explicit(&w->steals, 1, memory_order_relaxed);
+    }
+    if (got) atomic_fetch_sub_explicit(&pool->queued, 1, memory_order_relaxed);
+    return got;
+}
+
+static void *worker_main(void *arg) {
+    Worker *w = arg;
+    WorkPool *pool = w->pool;
+    self = w;
+    for (;;) {
+        WorkItem item;
+        if (take(pool, w, &item)) {
+            item.fn(item.arg);
+            continue;
+        }
+        // Submitters bump `queued` before signalling under idle_lock, so
+        // checking it under the lock cannot miss a wakeup. (It can dip
+        // below zero for a moment when a task is taken before its submit
+        // has counted it.)
+        pthread_mutex_lock(&pool->idle_lock);
+        while (atomic_load(&pool->queued) <= 0 && !pool->stopping) {
+            pthread_cond_wait(&pool->idle, &pool->idle_lock);
+        }
+        int done = pool->stopping && atomic_load(&pool->queued) <= 0;
+        pthread_mutex_unlock(&pool->idle_lock);
+        if (done) break;
+    }
+    return NULL;
+}
+
+int work_pool_init(WorkPool *pool, int threads) {
+    memset(pool, 0, sizeof(*pool));
+    if (threads < 1) threads = 1;
+    pool->workers = calloc((size_t)threads, sizeof(*pool->workers));
+    if (!pool->workers) return -1;
+    pthread_mutex_init(&pool->idle_lock, NULL);
+    pthread_cond_init(&pool->idle, NULL);
+    atomic_init(&pool->next, 0);
+    atomic_init(&pool->queued, 0);
+
+    // Every queue exists before any worker starts looking for work to steal
+    for (int i = 0; i < threads; i++) {
+        Worker *w = &pool->workers[i];
+        w->pool = pool;
+        w->index = i;
+        atomic_init(&w->steals, 0);
+        if (queue_init(&w->queue) != 0) break;
+        pool->size++;
+    }
+    while (pool->size == threads && pool->running < threads &&
+           pthread_create(&pool->workers[pool->running].thread, NULL, worker_main,
+                          &pool->workers[pool->running]) == 0) {
+        pool->running++;
+    }
+    if (pool->running < threads) {
+        work_pool_destroy(pool);
+        return -1;
+    }
+    return 0;
+}
+
+int work_pool_submit(WorkPool *pool, WorkFn fn, void *arg) {
+    Worker *w = self && self->pool == pool
+        ? self
+        : &pool->workers[atomic_fetch_add_explicit(&pool->next, 1, memory_order_relaxed) % (unsigned)pool->size];
+    if (queue_push(&w->queue, (WorkItem){fn, arg}) != 0) return -1;
+    atomic_fetch_add(&pool->queued, 1);
+
+    pthread_mutex_lock(&pool->idle_lock);
+    pthread_cond_signal(&pool->idle);
+    pthread_mutex_unlock(&pool->idle_lock);
+    return 0;
+}
+
+void work_pool_destroy(WorkPool *pool) {
+    pthread_mutex_lock(&pool->idle_lock);
+    pool->stopping = 1;
+    pthread_cond_broadcast(&pool->idle);
+    pthread_mutex_unlock(&pool->idle_lock);
+
+    for (int i = 0; i < pool->running; i++) pthread_join(pool->workers[i].thread, NULL);
+    for (int i = 0; i < pool->size; i++) queue_destroy(&pool->workers[i].queue);
+    pthread_mutex_destroy(&pool->idle_lock);
+    pthread_cond_destroy(&pool->idle);
+    free(pool->workers);
+    pool->workers = NULL;
+    pool->size = 0;
+    pool->running = 0;
+}
@@ -0,0 +1,73 @@
+#ifndef WORKPOOL_H
+#define WORKPOOL_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+
+/*
+ * WorkPool - a fixed set of worker threads that share work by stealing.
+ *
+ * Every worker has its own queue. A task submitted from outside the pool
+ * goes to the queues in rotation; a task submitted by a worker goes on
+ * that worker's own queue. A worker runs its queue oldest first, and when
+ * it is empty takes the oldest task from another worker's queue, so tasks
+ * stuck behind one long-running task are picked up by whoever is free.
+ *
+ * Tasks are run in no particular order relative to each other. Work that
+ * must stay in order (one session's commands) keeps at most one task in
+ * the pool at a time.
+ */
+
+typedef void (*WorkFn)(void *arg);
+
+typedef struct {
+    WorkFn fn;
+    void *arg;
+} WorkItem;
+
+typedef struct {
+    pthread_mutex_t lock;
+    WorkItem *items;     // Ring buffer
+    unsigned capacity;   // Power of two; doubles when full
+    unsigned head;       // Oldest task
+    unsigned count;
+} WorkQueue;
+
+struct WorkPool;
+
+typedef struct {
+    struct WorkPool *pool;
+    int index;
+    pthread_t thread;
+    WorkQueue queue;
+    atomic_ulong steals;   // Tasks this worker took from other queues
+} Worker;
+
+typedef struct WorkPool {
+    Worker *workers;
+    int size;                 // Workers (and queues)
+    int running;              // Threads started
+    atomic_uint next;         // Queue the next outside submit goes to
+    atomic_int queued;        // Tasks waiting in all queues
+    pthread_mutex_t idle_lock;
+    pthread_cond_t idle;      // Signalled when work arrives or the pool stops
+    int stopping;
+} WorkPool;
+
+// Start `threads` workers (at least one). Returns 0, or -1 if threads or
+// memory could not be had (nothing is left running).
+int work_pool_init(WorkPool *pool, int threads);
+
+// Queue fn(arg) to run on some worker. Returns 0, or -1 if out of memory.
+int work_pool_submit(WorkPool *pool, WorkFn fn, void *arg);
+
+// Tasks queued and not yet started: a task that could go on can check
+// this and resubmit itself instead, to let others run
+static inline int work_pool_queued(WorkPool *pool) {
+    return atomic_load_explicit(&pool->queued, memory_order_relaxed);
+}
+
+// Run everything still queued, then stop and join the workers
+void work_pool_destroy(WorkPool *pool);
+
+#endif
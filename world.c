@@ -0,0 +1,381 @@
+#define _DEFAULT_SOURCE  // MAP_ANONYMOUS
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "rng.h"
+#include "trace.h"
+#include "world.h"
+
+// Direction arrays for maze generation
+static const int dx[] = {0, 1, 0, -1};
+static const int dy[] = {-1, 0, 1, 0};
+
+// A private generator, so a world depends only on its seed and can be
+// generated on any thread without touching the game's dice
+static uint32_t world_rand(Rng *rng) {
+    return (uint32_t)(rng_next(rng) >> 32);
+}
+
+// A maze cell being carved: its position, shuffled directions and how
+// many of them have been tried
+typedef struct {
+    int x, y;
+    uint8_t dirs[4];
+    int tried;
+} CarveFrame;
+
+// Enter a cell: mark it, floor it and shuffle the directions to try
+static void carve_enter(WorldBase *base, uint8_t *seen, CarveFrame *frame, int x, int y, Rng *rng) {
+    seen[map_index(x, y)] = 1;
+    base->tiles[map_index(x, y)] = TILE_FLOOR;
+    frame->x = x;
+    frame->y = y;
+    frame->tried = 0;
+    for (int i = 0; i < 4; i++) frame->dirs[i] = (uint8_t)i;
+    for (int i = 3; i > 0; i--) {
+        int j = (int)(world_rand(rng) % (uint32_t)(i + 1));
+        uint8_t temp = frame->dirs[i];
+        frame->dirs[i] = frame->dirs[j];
+        frame->dirs[j] = temp;
+    }
+}
+
+/**
+ * Recursive backtracking maze generation, with the recursion kept on an
+ * explicit stack: a deep maze needs one frame per cell, far more than a
+ * thread's default stack. Cells are visited and the generator advanced
+ * in exactly the order the recursive version used, so seeds still give
+ * the same mazes.
+ */
+static int carve_maze(WorldBase *base, int x, int y, Rng *rng) {
+    size_t side = (size_t)MAP_SIZE / 2 + 1;  // Cells per row (every other tile)
+    uint8_t *seen = calloc(MAP_CELLS, 1);
+    CarveFrame *stack = malloc(side * side * sizeof(*stack));
+    if (!seen || !stack) {
+        free(seen);
+        free(stack);
+        return -1;
+    }
+
+    size_t depth = 1;
+    carve_enter(base, seen, &stack[0], x, y, rng);
+    while (depth > 0) {
+        CarveFrame *frame = &stack[depth - 1];
+        if (frame->tried == 4) {
+            depth--;
+            continue;
+        }
+        int dir = frame->dirs[frame->tried++];
+        int nx = frame->x + dx[dir] * 2;  // Move 2 cells at a time
+        int ny = frame->y + dy[dir] * 2;
+
+        // Check if valid and unvisited
+        if (nx >= 0 && nx < MAP_SIZE && ny >= 0 && ny < MAP_SIZE && !seen[map_index(nx, ny)]) {
+            // Carve the corridor between current and next cell, then go on from there
+            base->tiles[map_index(frame->x + dx[dir], frame->y + dy[dir])] = TILE_CORRIDOR;
+            carve_enter(base, seen, &stack[depth++], nx, ny, rng);
+        }
+    }
+    free(seen);
+    free(stack);
+    return 0;
+}
+
+// Mix the world seed and a tile index into 64 well-spread bits
+static uint64_t tile_hash(uint32_t seed, int x, int y) {
+    return splitmix64((uint64_t)seed << 32 | (uint32_t)(y * MAP_SIZE + x));
+}
+
+/**
+ * Derive what sits on a walkable tile from the world seed alone. The low
+ * bits pick the content, the high bits its difficulty or gold amount, so
+ * the same (seed, x, y) always gives the same tile.
+ */
+static void derive_content(uint32_t seed, int x, int y, TileData *out) {
+    uint64_t h = tile_hash(seed, x, y);
+    int roll = (int)(h % 100);
+    unsigned int sub = (unsigned int)(h >> 32);
+
+    // Compare squared distance against the squared band edges (no sqrt needed)
+    int dx = x - MAP_CENTER;
+    int dy = y - MAP_CENTER;
+    int dist_sq = dx * dx + dy * dy;
+
+    // Close to center: safer, more healing and treasure
+    if (dist_sq < 10 * 10) {
+        if (roll < 15) {  // 15% monster
+            out->content = CONTENT_MONSTER;
+            out->difficulty = DIFFICULTY_EASY;
+        } else if (roll < 30) {  // 15% treasure
+            out->content = CONTENT_TREASURE;
+            out->treasure_value = 20 + (int)(sub % 40);
+        } else if (roll < 40) {  // 10% healing fountain
+            out->content = CONTENT_HEALING_FOUNTAIN;
+        } else if (roll < 45) {  // 5% trap
+            out->content = CONTENT_TRAP;
+        }
+    }
+    // Mid range: balanced danger
+    else if (dist_sq < 20 * 20) {
+        if (roll < 30) {  // 30% monster
+            out->content = CONTENT_MONSTER;
+            out->difficulty = (sub % 2) ? DIFFICULTY_EASY : DIFFICULTY_MEDIUM;
+        } else if (roll < 45) {  // 15% treasure
+            out->content = CONTENT_TREASURE;
+            out->treasure_value = 40 + (int)(sub % 60);
+        } else if (roll < 53) {  // 8% healing fountain
+            out->content = CONTENT_HEALING_FOUNTAIN;
+        } else if (roll < 63) {  // 10% trap
+            out->content = CONTENT_TRAP;
+        }
+    }
+    // Far from center: dangerous
+    else {
+        if (roll < 40) {  // 40% monster
+            out->content = CONTENT_MONSTER;
+            int diff_roll = (int)(sub % 100);
+            if (diff_roll < 40) {
+                out->difficulty = DIFFICULTY_MEDIUM;
+            } else if (diff_roll < 80) {
+                out->difficulty = DIFFICULTY_HARD;
+            } else {
+                out->difficulty = DIFFICULTY_EASY;  // Still some easy ones
+            }
+        } else if (roll < 55) {  // 15% treasure
+            out->content = CONTENT_TREASURE;
+            out->treasure_value = 60 + (int)(sub % 100);
+        } else if (roll < 60) {  // 5% healing fountain
+            out->content = CONTENT_HEALING_FOUNTAIN;
+        } else if (roll < 75) {  // 15% trap
+            out->content = CONTENT_TRAP;
+        }
+    }
+}
+
+// Bosses at the corners (1), shrines at the cardinal points (2), else 0
+static int special_location(int x, int y) {
+    if ((x == 0 || x == MAP_SIZE - 1) && (y == 0 || y == MAP_SIZE - 1)) {
+        return 1;
+    }
+    if ((x == MAP_CENTER && (y == 0 || y == MAP_SIZE - 1)) ||
+        (y == MAP_CENTER && (x == 0 || x == MAP_SIZE - 1))) {
+        return 2;
+    }
+    return 0;
+}
+
+void world_tile_content(const WorldBase *base, int x, int y, TileData *out) {
+    *out = (TileData){CONTENT_EMPTY, DIFFICULTY_EASY, 0, 0};
+    if (x < 0 || x >= MAP_SIZE || y < 0 || y >= MAP_SIZE) {
+        return;
+    }
+    switch (special_location(x, y)) {
+    case 1:
+        *out = (TileData){CONTENT_BOSS, DIFFICULTY_BOSS, 0, 0};
+        return;
+    case 2:
+        *out = (TileData){CONTENT_SHRINE, DIFFICULTY_EASY, 0, 0};
+        return;
+    }
+    if (base->tiles[map_index(x, y)] == TILE_WALL) return;
+    if (x == MAP_CENTER && y == MAP_CENTER) return;  // Starting position stays safe
+    derive_content(base->seed, x, y, out);
+}
+
+// Carve the maze for `seed` into a zeroed WorldBase and count its content
+static int build(WorldBase *base, uint32_t seed) {
+    TRACE_SCOPE("map_generate");
+    memcpy(base->magic, WORLD_MAGIC, sizeof(base->magic));
+    base->version = WORLD_VERSION;
+    base->map_size = MAP_SIZE;
+    base->cells = MAP_CELLS;
+    base->seed = seed;
+    Rng rng = {((uint64_t)seed << 32 | seed) ^ SPLITMIX64_GAMMA};  // Never 0 for xorshift
+
+    // Every tile starts as a wall (TILE_WALL is 0); carve from the center
+    TRACE_BEGIN("carve_maze");
+    int carved = carve_maze(base, MAP_CENTER, MAP_CENTER, &rng);
+    TRACE_END("carve_maze");
+    if (carved != 0) return -1;
+
+    // Ensure special locations are accessible
+    base->tiles[map_index(0, 0)] = TILE_FLOOR;  // Top-left boss
+    base->tiles[map_index(MAP_SIZE - 1, 0)] = TILE_FLOOR;  // Bottom-left boss
+    base->tiles[map_index(0, MAP_SIZE - 1)] = TILE_FLOOR;  // Top-right boss
+    base->tiles[map_index(MAP_SIZE - 1, MAP_SIZE - 1)] = TILE_FLOOR;  // Bottom-right boss
+
+    base->tiles[map_index(MAP_CENTER, 0)] = TILE_FLOOR;  // Left shrine
+    base->tiles[map_index(MAP_CENTER, MAP_SIZE - 1)] = TILE_FLOOR;  // Right shrine
+    base->tiles[map_index(0, MAP_CENTER)] = TILE_FLOOR;  // Top shrine
+    base->tiles[map_index(MAP_SIZE - 1, MAP_CENTER)] = TILE_FLOOR;  // Bottom shrine
+
+    // Add some random connections to make maze less linear (20% chance)
+    for (int y = 1; y < MAP_SIZE - 1; y++) {
+        for (int x = 1; x < MAP_SIZE - 1; x++) {
+            if (base->tiles[map_index(x, y)] == TILE_WALL && world_rand(&rng) % 100 < 20) {
+                base->tiles[map_index(x, y)] = TILE_CORRIDOR;
+            }
+        }
+    }
+
+    // Totals for map_explore_stats(), which then only has to look at the
+    // tiles a player has changed
+    for (int y = 0; y < MAP_SIZE; y++) {
+        for (int x = 0; x < MAP_SIZE; x++) {
+            if (base->tiles[map_index(x, y)] == TILE_WALL) continue;
+            base->walkable++;
+            TileData tile;
+            world_tile_content(base, x, y, &tile);
+            if (tile.content == CONTENT_MONSTER || tile.content == CONTENT_BOSS) base->monsters++;
+            if (tile.content == CONTENT_TREASURE) base->treasures++;
+        }
+    }
+    return 0;
+}
+
+// ---------------------------------------------------------------------------
+// Cache files
+// ---------------------------------------------------------------------------
+
+static void cache_path(char *path, size_t size, const char *dir, uint32_t seed) {
+#ifdef MAP_LAYOUT_TILED
+    snprintf(path, size, "%s/world-%dt-%u.map", dir, MAP_SIZE, seed);
+#else
+    snprintf(path, size, "%s/world-%d-%u.map", dir, MAP_SIZE, seed);
+#endif
+}
+
+// Map a cache file read-only, or NULL if it is missing or doesn't match
+static const WorldBase *map_cache(const char *path, uint32_t seed) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return NULL;
+    struct stat st;
+    void *p = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && st.st_size == (off_t)sizeof(WorldBase)) {
+        p = mmap(NULL, sizeof(WorldBase), PROT_READ, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+    if (p == MAP_FAILED) return NULL;
+    const WorldBase *base = p;
+    if (memcmp(base->magic, WORLD_MAGIC, sizeof(base->magic)) != 0 ||
+        base->version != WORLD_VERSION || base->map_size != MAP_SIZE ||
+        base->cells != MAP_CELLS || base->seed != seed) {
+        munmap(p, sizeof(WorldBase));
+        return NULL;
+    }
+    return base;
+}
+
+// Write a cache file under a temporary name and rename it into place, so
+// other processes never map a half-written world
+static int write_cache(const char *path, const WorldBase *base) {
+    char tmp[544];
+    snprintf(tmp, sizeof(tmp), "%s.%ld.tmp", path, (long)getpid());
+    int fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return -1;
+    const unsigned char *p = (const unsigned char *)base;
+    size_t len = sizeof(*base);
+    while (len > 0) {
+        ssize_t n = write(fd, p, len);
+        if (n <= 0) break;
+        p += n;
+        len -= (size_t)n;
+    }
+    if (close(fd) != 0 || len > 0 || rename(tmp, path) != 0) {
+        unlink(tmp);
+        return -1;
+    }
+    return 0;
+}
+
+// ---------------------------------------------------------------------------
+// Worlds
+// ---------------------------------------------------------------------------
+
+World *world_create(uint32_t seed, const char *dir) {
+    World *world = malloc(sizeof(*world));
+    if (!world) return NULL;
+    world->bytes = sizeof(WorldBase);
+    atomic_init(&world->refs, 1);
+
+    char path[512] = "";
+    if (dir && *dir) {
+        cache_path(path, sizeof(path), dir, seed);
+        world->base = map_cache(path, seed);
+        if (world->base) return world;
+    }
+
+    // Anonymous pages come zeroed: every tile a wall, every count 0
+    WorldBase *base = mmap(NULL, sizeof(WorldBase), PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) {
+        free(world);
+        return NULL;
+    }
+    if (build(base, seed) != 0) {
+        munmap(base, sizeof(WorldBase));
+        free(world);
+        return NULL;
+    }
+    if (*path && write_cache(path, base) == 0) {
+        const WorldBase *shared = map_cache(path, seed);
+        if (shared) {
+            munmap(base, sizeof(WorldBase));
+            world->base = shared;
+            return world;
+        }
+    }
+    mprotect(base, sizeof(WorldBase), PROT_READ);  // Shared from here on: no writes
+    world->base = base;
+    return world;
+}
+
+void world_retain(World *world) {
+    atomic_fetch_add_explicit(&world->refs, 1, memory_order_relaxed);
+}
+
+void world_release(World *world) {
+    if (!world) return;
+    if (atomic_fetch_sub_explicit(&world->refs, 1, memory_order_acq_rel) == 1) {
+        munmap((void *)world->base, world->bytes);
+        free(world);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Pool
+// ---------------------------------------------------------------------------
+
+void world_pool_init(WorldPool *pool, int size, const char *dir) {
+    pthread_mutex_init(&pool->lock, NULL);
+    memset(pool->worlds, 0, sizeof(pool->worlds));
+    pool->size = size < 1 ? 1 : (size > WORLD_POOL_MAX ? WORLD_POOL_MAX : size);
+    pool->next = 0;
+    snprintf(pool->dir, sizeof(pool->dir), "%s", dir ? dir : "");
+}
+
+World *world_pool_acquire(WorldPool *pool, uint32_t seed) {
+    pthread_mutex_lock(&pool->lock);
+    int slot = pool->next;
+    pool->next = (pool->next + 1) % pool->size;
+    World *world = pool->worlds[slot];
+    if (!world) {
+        world = pool->worlds[slot] = world_create(seed, pool->dir);
+    }
+    if (world) world_retain(world);
+    pthread_mutex_unlock(&pool->lock);
+    return world;
+}
+
+void world_pool_destroy(WorldPool *pool) {
+    for (int i = 0; i < pool->size; i++) {
+        world_release(pool->worlds[i]);
+        pool->worlds[i] = NULL;
+    }
+    pthread_mutex_destroy(&pool->lock);
+}
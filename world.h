@@ -0,0 +1,90 @@
+#ifndef WORLD_H
+#define WORLD_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "dungeon.h"
+
+/*
+ * World - the part of a map that follows from its seed alone and never
+ * changes during play: the maze, and what every tile holds before anyone
+ * touches it (bosses, shrines and the content derived from the seed).
+ *
+ * It is generated once into a read-only mapping and shared: every Map
+ * playing that seed points at the same World and keeps only its own
+ * sparse overlay of visited, consumed and placed tiles (dungeon.h). A
+ * second player on a 500x500 world costs a few KB, not megabytes.
+ *
+ * With a directory, worlds are also cached as files (world-<size>-<seed>.map)
+ * and mapped from there, so several processes serving the same seed share
+ * one copy in the page cache. The file is the WorldBase struct as is, and
+ * only valid for the build that wrote it (same MAP_SIZE and layout).
+ */
+
+#define WORLD_MAGIC "ADVWORLD"
+#define WORLD_VERSION 1
+#define WORLD_POOL_MAX 64
+
+// The shared, read-only layer (the mapping, and the cache file's layout)
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t map_size;
+    uint32_t cells;          // MAP_CELLS (the tiled layout pads)
+    uint32_t seed;
+    uint32_t walkable;       // Non-wall tiles
+    uint32_t monsters;       // Monsters and bosses on an untouched map
+    uint32_t treasures;      // Treasure chests on an untouched map
+    uint32_t reserved[7];
+    uint8_t tiles[MAP_CELLS];  // TileType, indexed by map_index(x, y)
+} WorldBase;
+
+// Reference-counted handle to a mapped WorldBase
+typedef struct World {
+    const WorldBase *base;
+    size_t bytes;     // Length of the mapping
+    atomic_int refs;
+} World;
+
+/**
+ * Generate the world for `seed` (or map it from `dir`'s cache file, writing
+ * the file first if there is none; NULL dir = in memory only). Returns a
+ * World holding one reference, or NULL if memory or the mapping failed.
+ * Safe on any thread; uses no global state.
+ */
+World *world_create(uint32_t seed, const char *dir);
+
+void world_retain(World *world);
+
+// Drop a reference; the last one unmaps the world
+void world_release(World *world);
+
+// What an untouched tile holds: placed bosses and shrines, otherwise the
+// content derived from the seed. Walls, the start and off-map tiles are empty.
+void world_tile_content(const WorldBase *base, int x, int y, TileData *out);
+
+/*
+ * A fixed set of worlds handed out in rotation, so that many sessions
+ * share a few worlds instead of each generating its own. Worlds are made
+ * on first use and kept until world_pool_destroy().
+ */
+typedef struct {
+    pthread_mutex_t lock;
+    World *worlds[WORLD_POOL_MAX];
+    int size;
+    int next;        // Slot the next world_pool_acquire() hands out
+    char dir[256];   // Cache directory ("" = none)
+} WorldPool;
+
+// `size` worlds (clamped to 1..WORLD_POOL_MAX), cached in `dir` if not NULL
+void world_pool_init(WorldPool *pool, int size, const char *dir);
+
+// The next world in rotation with a reference for the caller, or NULL if
+// it could not be created. `seed` is used if that slot has no world yet.
+World *world_pool_acquire(WorldPool *pool, uint32_t seed);
+
+void world_pool_destroy(WorldPool *pool);
+
+#endif
@@ -0,0 +1,33 @@
+#include "metrics.h"
+#include "worldgen.h"
+
+static void *worldgen_main(void *arg) {
+    WorldGen *gen = arg;
+    gen->status = map_generate_seeded(gen->map, gen->seed);
+    gen->done_ns = metrics_now_ns();
+    return NULL;
+}
+
+int worldgen_start(WorldGen *gen, Map *map, uint32_t seed) {
+    gen->map = map;
+    gen->seed = seed;
+    gen->running = 0;
+    gen->start_ns = metrics_now_ns();
+    gen->done_ns = 0;
+    gen->status = 0;
+
+    if (pthread_create(&gen->thread, NULL, worldgen_main, gen) != 0) {
+        worldgen_main(gen);
+        return -1;
+    }
+    gen->running = 1;
+    return 0;
+}
+
+uint64_t worldgen_join(WorldGen *gen) {
+    if (!gen->running) return 0;
+    uint64_t start = metrics_now_ns();
+    pthread_join(gen->thread, NULL);
+    gen->running = 0;
+    return metrics_now_ns() - start;
+}
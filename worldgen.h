@@ -0,0 +1,34 @@
+#ifndef WORLDGEN_H
+#define WORLDGEN_H
+
+#include <stdint.h>
+#include <pthread.h>
+#include "dungeon.h"
+
+/*
+ * Background world generation - runs map_generate_seeded() on a worker
+ * thread so it overlaps with something the player is doing anyway (the
+ * class menu, the "new game?" prompt). The map must not be touched until
+ * worldgen_join() returns.
+ */
+
+typedef struct {
+    pthread_t thread;
+    Map *map;
+    uint32_t seed;
+    int running;          // A worker was started and not yet joined
+    uint64_t start_ns;    // metrics_now_ns() when generation began
+    uint64_t done_ns;     // ... and when it finished (set by the worker)
+    int status;           // map_generate_seeded() result, once joined
+} WorldGen;
+
+// Start generating `map` from `seed` in the background. If no thread can
+// be created the map is generated right here instead. Returns 0 if a
+// worker is running, -1 if the map was generated synchronously.
+int worldgen_start(WorldGen *gen, Map *map, uint32_t seed);
+
+// Wait for the generator to finish (returns at once if nothing is running).
+// Returns the nanoseconds spent waiting.
+uint64_t worldgen_join(WorldGen *gen);
+
+#endif
@@ -0,0 +1,59 @@
+#include "rng.h"
+#include "zobrist.h"
+
+// Feature id spaces (top byte), so keys of different kinds never coincide
+enum {
+    FEATURE_TILE = 1,  // zobrist_tile() in zobrist.h
+    FEATURE_SEED = 2,
+    FEATURE_FIELD = 3,
+    FEATURE_ENTRY = 4,
+    FEATURE_ROLL = 5
+};
+
+// Player fields that take part in the hash
+enum {
+    FIELD_CLASS, FIELD_MAX_HEALTH, FIELD_HEALTH, FIELD_GOLD, FIELD_LEVEL,
+    FIELD_EXPERIENCE, FIELD_EXP_TO_NEXT, FIELD_BASE_DAMAGE, FIELD_BASE_DEFENSE,
+    FIELD_TOTAL_DAMAGE, FIELD_TOTAL_DEFENSE, FIELD_WEAPON, FIELD_ARMOR,
+    FIELD_POS_X, FIELD_POS_Y
+};
+
+uint64_t zobrist_key(uint64_t feature) {
+    return splitmix64(feature + SPLITMIX64_GAMMA);
+}
+
+uint64_t zobrist_world(uint32_t seed) {
+    return zobrist_key((uint64_t)FEATURE_SEED << 56 | seed);
+}
+
+static uint64_t field_key(int field, uint32_t value) {
+    return zobrist_key((uint64_t)FEATURE_FIELD << 56 | (uint64_t)field << 32 | value);
+}
+
+uint64_t zobrist_player(const Player *player, Position pos) {
+    uint64_t h = field_key(FIELD_CLASS, (uint32_t)player->player_class)
+               ^ field_key(FIELD_MAX_HEALTH, (uint32_t)player->max_health)
+               ^ field_key(FIELD_HEALTH, (uint32_t)player->health)
+               ^ field_key(FIELD_GOLD, (uint32_t)player->gold)
+               ^ field_key(FIELD_LEVEL, (uint32_t)player->level)
+               ^ field_key(FIELD_EXPERIENCE, (uint32_t)player->experience)
+               ^ field_key(FIELD_EXP_TO_NEXT, (uint32_t)player->exp_to_next_level)
+               ^ field_key(FIELD_BASE_DAMAGE, (uint32_t)player->base_damage)
+               ^ field_key(FIELD_BASE_DEFENSE, (uint32_t)player->base_defense)
+               ^ field_key(FIELD_TOTAL_DAMAGE, (uint32_t)player->total_damage)
+               ^ field_key(FIELD_TOTAL_DEFENSE, (uint32_t)player->total_defense)
+               ^ field_key(FIELD_WEAPON, player->equipped.weapon)
+               ^ field_key(FIELD_ARMOR, player->equipped.armor)
+               ^ field_key(FIELD_POS_X, (uint32_t)pos.x)
+               ^ field_key(FIELD_POS_Y, (uint32_t)pos.y);
+
+    // Occupied inventory slots: (slot, id, quantity) and (slot, roll)
+    for (int slot = 0; slot < MAX_INVENTORY; slot++) {
+        const InventoryEntry *e = inventory_slot(&player->inventory, slot);
+        if (!e) continue;
+        h ^= zobrist_key((uint64_t)FEATURE_ENTRY << 56 | (uint64_t)slot << 40 |
+                         (uint64_t)e->quantity << 16 | e->item_id);
+        h ^= zobrist_key((uint64_t)FEATURE_ROLL << 56 | (uint64_t)slot << 40 | e->roll);
+    }
+    return h;
+}
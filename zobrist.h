@@ -0,0 +1,44 @@
+#ifndef ZOBRIST_H
+#define ZOBRIST_H
+
+#include <stdint.h>
+#include "dungeon.h"
+#include "player.h"
+
+/*
+ * Zobrist hashing - a 64-bit fingerprint of the game state.
+ *
+ * Every feature of the state (a tile's visited or consumed flag, a Player
+ * field holding a value, an inventory entry) has a pseudo-random key, and
+ * the fingerprint is the XOR of the keys of everything present. Flipping
+ * a tile flag is one XOR, so the map keeps its part up to date as it
+ * changes (Map.hash) and two states compare in O(1) instead of byte by
+ * byte over megabytes of map.
+ *
+ * Keys are computed from the feature id by a 64-bit mixer rather than
+ * looked up: a table for two layers of a 500x500 map would be 4 MB.
+ */
+
+enum { ZOBRIST_VISITED = 1, ZOBRIST_LOOTED = 2 };  // Tile layers
+
+// Key of an arbitrary 64-bit feature id
+uint64_t zobrist_key(uint64_t feature);
+
+// Key of one tile layer flag (row-major tile index)
+static inline uint64_t zobrist_tile(uint32_t index, int layer) {
+    return zobrist_key((1ULL << 56) | (uint64_t)index << 2 | (uint64_t)layer);
+}
+
+// Map hash of a freshly generated world: nothing visited or consumed yet
+uint64_t zobrist_world(uint32_t seed);
+
+// Hash of the player's stats, inventory, equipment and position. Constant
+// cost (a few dozen keys), independent of the map size.
+uint64_t zobrist_player(const Player *player, Position pos);
+
+// Fingerprint of the whole state: the map's running hash plus the player
+static inline uint64_t zobrist_state(const Map *map, const Player *player, Position pos) {
+    return map->hash ^ zobrist_player(player, pos);
+}
+
+#endif